@@ -16,8 +16,26 @@
 --
 ----------------------------------------------------------------
 
+COMPRESS_OUTPUT = { }
+
+function COMPRESS_OUTPUT.setup(self)
+
+  module_param_up(self)
+
+end
+
+COMPRESS_OUTPUT.COMPRESSION_CHOICES =
+{
+  "store",  _("Store"),
+  "fast",   _("Fast"),
+  "normal", _("Normal"),
+  "best",   _("Best"),
+}
+
 OB_MODULES["compress_output"] =
 {
+  name = "compress_output",
+
   label = _("PK3 Output"),
 
   side = "left",
@@ -27,5 +45,21 @@ OB_MODULES["compress_output"] =
 
   port = "advanced",
   tooltip= _("Automatically compress output to PK3 to save space."),
+
+  hooks =
+  {
+    pre_setup = COMPRESS_OUTPUT.setup,
+  },
+
+  options =
+  {
+    {
+      name = "zip_compression",
+      label = _("Compression"),
+      choices = COMPRESS_OUTPUT.COMPRESSION_CHOICES,
+      default = "normal",
+      tooltip = _("How hard to compress the PK3. Store does not compress at all, which is quickest but makes the largest file."),
+    }
+  }
 }
 
@@ -33,6 +33,13 @@ function raw_add_brush(brush)
     assert(not C.y_offset)
   end
 
+  -- without an export hook the brush does not need to be modified,
+  -- gui.add_brushes() handles a missing mode and the ambient light.
+  if not GAME.add_brush_func then
+    gui.add_brushes({ brush }, AMBIENT_LIGHT[1])
+    return
+  end
+
   if brush[1].m == nil then
     brush = table.copy(brush)
     table.insert(brush, 1, { m="solid" })
@@ -42,9 +49,20 @@ function raw_add_brush(brush)
 
   gui.add_brush(brush)
 
+  GAME.add_brush_func(brush)
+end
+
+
+function raw_add_brushes(list)
+  -- the export hook wants each brush in the usual form
   if GAME.add_brush_func then
-     GAME.add_brush_func(brush)
+    for _,B in ipairs(list) do
+      raw_add_brush(B)
+    end
+    return
   end
+
+  gui.add_brushes(list, AMBIENT_LIGHT[1])
 end
 
 
@@ -522,6 +522,70 @@ function Grower_preprocess_grammar(test_grammar)
   end
 
 
+  local function compile_transforms()
+    --
+    -- Computes where each element and focal point of the rule ends up
+    -- under all eight transforms (see calc_transform in the grammatical
+    -- pass), relative to the position being tried.  The matching code
+    -- uses these flat lists instead of transforming every coordinate
+    -- at every position.  The order of elements is the same as looping
+    -- over px then py, and focal points are in pairs() order.
+    --
+    def.transforms = {}
+
+    for index = 0, 7 do
+      local transpose = (index >= 4)
+      local flip_x    = (index % 4) >= 2
+      local flip_y    = (index % 2) == 1
+
+      local function offset(px, py)
+        px = px - 1
+        py = py - 1
+
+        if flip_x then px = -px end
+        if flip_y then py = -py end
+
+        if transpose then px, py = py, px end
+
+        return px, py
+      end
+
+      local CT =
+      {
+        count  = 0,
+        dx     = {},
+        dy     = {},
+        input  = {},
+        output = {},
+
+        focal_area = {},
+        focal_dx   = {},
+        focal_dy   = {}
+      }
+
+      for px = 1, def.input.w do
+      for py = 1, def.input.h do
+        CT.count = CT.count + 1
+
+        CT.dx[CT.count], CT.dy[CT.count] = offset(px, py)
+
+        CT.input [CT.count] = def.input [px][py]
+        CT.output[CT.count] = def.output[px][py]
+      end
+      end
+
+      for area_num, loc in pairs(def.focal_points) do
+        local k = #CT.focal_area + 1
+
+        CT.focal_area[k] = area_num
+        CT.focal_dx[k], CT.focal_dy[k] = offset(loc.gx, loc.gy)
+      end
+
+      def.transforms[index + 1] = CT
+    end
+  end
+
+
   -- NOTE: this code not used at the moment
   local function visit_contiguous_elem(x, y, kind, locs, seen)
     table.insert(locs, { x=x, y=y })
@@ -757,6 +821,7 @@ function Grower_preprocess_grammar(test_grammar)
 
         find_focal_points()
         find_connections()
+        compile_transforms()
 
         locate_all_contiguous_parts("stair")
         locate_all_contiguous_parts("joiner")
@@ -1912,6 +1977,19 @@ function Grower_grammatical_pass(SEEDS, LEVEL, R, pass, apply_num, stop_prob,
   end
 
 
+  local function compiled_transform(T)
+    -- get the precomputed offsets for this transform of the current
+    -- rule, see compile_transforms() in Grower_preprocess_grammar.
+    local index = 1
+
+    if T.transpose then index = index + 4 end
+    if T.flip_x    then index = index + 2 end
+    if T.flip_y    then index = index + 1 end
+
+    return cur_rule.transforms[index]
+  end
+
+
   local function transform_dir(T, dir)
     if T.flip_x then dir = geom.MIRROR_X[dir] end
     if T.flip_y then dir = geom.MIRROR_Y[dir] end
@@ -2397,9 +2475,7 @@ stderrf("prelim_conn %s --> %s : S=%s dir=%d\n", c_out.R1.name, c_out.R2.name, S
   end
 
 
-  local function match_a_focal_point(area_num, T, px, py)
-    local sx, sy = transform_coord(T, px, py)
-
+  local function match_a_focal_point(area_num, sx, sy)
     if sx <= 1 or sx >= SEED_W or
        sy <= 1 or sy >= SEED_H
     then
@@ -2552,9 +2628,7 @@ stderrf("prelim_conn %s --> %s : S=%s dir=%d\n", c_out.R1.name, c_out.R2.name, S
   end
 
 
-  local function match_or_install_element(what, E1, E2, T, px, py)
-    local sx, sy = transform_coord(T, px, py)
-
+  local function match_or_install_element(what, E1, E2, T, sx, sy)
     -- never allow patterns to touch edge of map
     if sx <= 1 or sx >= SEED_W or
        sy <= 1 or sy >= SEED_H
@@ -3092,12 +3166,14 @@ stderrf("Link pieces: %s dir:%d <--> %s dir:%d\n",
   local function match_or_install_pat_raw(what, T)
     if what == "INSTALL" then pre_install(T) end
 
-    for px = 1, cur_rule.input.w do
-    for py = 1, cur_rule.input.h do
-      local E1 = cur_rule.input [px][py]
-      local E2 = cur_rule.output[px][py]
+    local CT = compiled_transform(T)
+
+    for k = 1, CT.count do
+      local E1 = CT.input [k]
+      local E2 = CT.output[k]
 
-      local res = match_or_install_element(what, E1, E2, T, px, py)
+      local res = match_or_install_element(what, E1, E2, T,
+                                           T.x + CT.dx[k], T.y + CT.dy[k])
 
       if what == "TEST" and not res then
         -- cannot place this shape here (something in the way)
@@ -3109,8 +3185,7 @@ end
 --]]
         return false
       end
-    end -- px, py
-    end
+    end -- k
 
 --[[ DEBUG
 if what == "INSTALL" then
@@ -3229,14 +3304,16 @@ end
   end
 
 
-  local function match_all_focal_points(T)
+  local function match_all_focal_points(T, CT)
     area_map[1] = nil
     area_map[2] = nil
     area_map[3] = nil
     link_chunk  = nil
 
-    for area_num, loc in pairs(cur_rule.focal_points) do
-      if not match_a_focal_point(area_num, T, loc.gx, loc.gy) then
+    for k = 1, #CT.focal_area do
+      if not match_a_focal_point(CT.focal_area[k],
+                                 T.x + CT.focal_dx[k], T.y + CT.focal_dy[k])
+      then
         return false
       end
     end
@@ -3271,6 +3348,8 @@ end
     if cur_rule.no_rotate then
       T = calc_transform(0, 0, 0)
       x1,y1, x2,y2 = get_iteration_range(T)
+
+      local CT = compiled_transform(T)
   
       for x = x1, x2 do
         for y = y1, y2 do
@@ -3278,7 +3357,7 @@ end
           T.x = x
           T.y = y
   
-          if not match_all_focal_points(T) then goto continue end
+          if not match_all_focal_points(T, CT) then goto continue end
   
           if match_or_install_pattern("TEST", T) then
             best.T = table.copy(T)
@@ -3302,6 +3381,8 @@ end
       for _,transform in pairs(LEVEL.shape_transform_possiblities) do
         T = calc_transform(transform[1], transform[2], transform[3])
         x1,y1, x2,y2 = get_iteration_range(T)
+
+        local CT = compiled_transform(T)
   
         for x = x1, x2 do
           for y = y1, y2 do
@@ -3309,7 +3390,7 @@ end
             T.x = x
             T.y = y
     
-            if not match_all_focal_points(T) then goto continue end
+            if not match_all_focal_points(T, CT) then goto continue end
     
             if match_or_install_pattern("TEST", T) then
               best.T = table.copy(T)
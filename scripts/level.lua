@@ -2817,11 +2817,11 @@ function Level_make_all()
       local numwords = rand.irange(1, 3)
 
       if numwords == 1 then
-        GAME.title = case_randomizer(rand.pick(RANDOM_WORDS_EN))
+        GAME.title = case_randomizer(gui.random_word("en"))
       elseif numwords == 2 then
-        GAME.title = case_randomizer(rand.pick(RANDOM_WORDS_EN)) .. " " .. case_randomizer(rand.pick(RANDOM_WORDS_EN))
+        GAME.title = case_randomizer(gui.random_word("en")) .. " " .. case_randomizer(gui.random_word("en"))
       else
-        GAME.title = case_randomizer(rand.pick(RANDOM_WORDS_EN)) .. " " .. case_randomizer(rand.pick(RANDOM_WORDS_EN)) .. " " .. case_randomizer(rand.pick(RANDOM_WORDS_EN))
+        GAME.title = case_randomizer(gui.random_word("en")) .. " " .. case_randomizer(gui.random_word("en")) .. " " .. case_randomizer(gui.random_word("en"))
       end
     end
   end
@@ -47,9 +47,6 @@ gui.import("level")
 
 gui.import("script_manager")
 
-gui.import("random_words_en.lua")
-gui.import("random_words_en_m.lua")
-
 gui.import("094/oblige_v094.lua")
 
 function ob_ref_table(op, t)
@@ -1744,12 +1741,11 @@ end
 
 function ob_get_random_words()
   
-  RANDOM_WORDS = {}
+  -- word lists live in data/words, loaded when first used
+  local word_list = "en"
 
   if OB_CONFIG.mature_words == "yes" then
-    RANDOM_WORDS = RANDOM_WORDS_EN_M
-  else 
-    RANDOM_WORDS = RANDOM_WORDS_EN
+    word_list = "en_m"
   end
 
   local function case_randomizer(random_word)
@@ -1787,11 +1783,11 @@ function ob_get_random_words()
   local numwords = rand.irange(1, 3)
 
   if numwords == 1 then
-    return case_randomizer(rand.pick(RANDOM_WORDS))
+    return case_randomizer(gui.random_word(word_list))
   elseif numwords == 2 then
-    return case_randomizer(rand.pick(RANDOM_WORDS)) .. " " .. case_randomizer(rand.pick(RANDOM_WORDS))
+    return case_randomizer(gui.random_word(word_list)) .. " " .. case_randomizer(gui.random_word(word_list))
   else
-    return case_randomizer(rand.pick(RANDOM_WORDS)) .. " " .. case_randomizer(rand.pick(RANDOM_WORDS)) .. " " .. case_randomizer(rand.pick(RANDOM_WORDS))
+    return case_randomizer(gui.random_word(word_list)) .. " " .. case_randomizer(gui.random_word(word_list)) .. " " .. case_randomizer(gui.random_word(word_list))
   end
 end
 
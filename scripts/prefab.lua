@@ -816,12 +816,16 @@ function Fab_render(fab)
     fab_map = "object"
   end
 
+  local brushes = {}
+
   for _,B in pairs(fab.brushes) do
     if B[1].m ~= "spot" then
-      raw_add_brush(B)
+      table.insert(brushes, B)
     end
   end
 
+  raw_add_brushes(brushes)
+
   for _,M in pairs(fab.models) do
     raw_add_model(M)
   end
@@ -657,10 +657,25 @@ table.INHERIT_META =
   end
 }
 
+-- each class gets its own copy of INHERIT_META where __index is the
+-- class table itself, so looking up a field which is not present (like
+-- S.diagonal) is done by the VM instead of calling a Lua function.
+table.CLASS_METAS = {}
+
 function table.set_class(child, parent)
   assert(parent)
   child.__parent = parent
-  setmetatable(child, table.INHERIT_META)
+
+  local meta = table.CLASS_METAS[parent]
+
+  if not meta then
+    meta = table.copy(table.INHERIT_META)
+    meta.__index = parent
+
+    table.CLASS_METAS[parent] = meta
+  end
+
+  setmetatable(child, meta)
 end
 
 
@@ -30,15 +30,19 @@
 #endif
 #include "hdr_lua.h"
 #include "headers.h"
+#include "lib_pool.h"
 #include "lib_util.h"
 #include "m_lua.h"
 #include "main.h"
 
-double QUANTIZE_GRID;
+// the BSP state is per-thread, so that the Quake clipping hulls can
+// be built at the same time (see csg_clip.cc).
 
-static bool csg_is_clip_hull;
+static thread_local double QUANTIZE_GRID;
 
-static std::vector<region_c *> dead_regions;
+static thread_local bool csg_is_clip_hull;
+
+static thread_local std::vector<region_c *> dead_regions;
 
 class partition_c {
    public:
@@ -52,6 +56,10 @@ class partition_c {
     partition_c(const snag_c *S) : x1(S->x1), y1(S->y1), x2(S->x2), y2(S->y2) {}
 
     ~partition_c() {}
+
+    // these come from a pool, see CSG_end_level()
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
 };
 
 class group_c {
@@ -90,6 +98,49 @@ class group_c {
 
 //------------------------------------------------------------------------
 
+// the BSP objects are created and destroyed in huge numbers, so they
+// come from pools which are released in one go at the end of a level.
+
+static thread_local object_pool_c<snag_c> snag_pool("snags");
+static thread_local object_pool_c<region_c> region_pool("regions");
+static thread_local object_pool_c<gap_c> gap_pool("gaps");
+static thread_local object_pool_c<partition_c> partition_pool("partitions");
+static thread_local object_pool_c<bsp_node_c> bsp_node_pool("bsp nodes");
+
+void *snag_c::operator new(size_t size) { return snag_pool.New(size); }
+
+void snag_c::operator delete(void *ptr, size_t size) {
+    snag_pool.Delete(ptr, size);
+}
+
+void *region_c::operator new(size_t size) { return region_pool.New(size); }
+
+void region_c::operator delete(void *ptr, size_t size) {
+    region_pool.Delete(ptr, size);
+}
+
+void *gap_c::operator new(size_t size) { return gap_pool.New(size); }
+
+void gap_c::operator delete(void *ptr, size_t size) {
+    gap_pool.Delete(ptr, size);
+}
+
+void *partition_c::operator new(size_t size) {
+    return partition_pool.New(size);
+}
+
+void partition_c::operator delete(void *ptr, size_t size) {
+    partition_pool.Delete(ptr, size);
+}
+
+void *bsp_node_c::operator new(size_t size) { return bsp_node_pool.New(size); }
+
+void bsp_node_c::operator delete(void *ptr, size_t size) {
+    bsp_node_pool.Delete(ptr, size);
+}
+
+//------------------------------------------------------------------------
+
 snag_c::snag_c(brush_vert_c *side, double _x1, double _y1, double _x2,
                double _y2)
     : x1(_x1),
@@ -644,11 +695,11 @@ void bsp_node_c::AddBBox(region_c *leaf) {
 
 /***** VARIABLES ******************/
 
-static std::vector<partition_c *> all_partitions;
+static thread_local std::vector<partition_c *> all_partitions;
 
-std::vector<region_c *> all_regions;
+thread_local std::vector<region_c *> all_regions;
 
-bsp_node_c *bsp_root;
+thread_local bsp_node_c *bsp_root;
 
 //------------------------------------------------------------------------
 
@@ -1607,7 +1658,10 @@ static gap_c *GapForEntity(const region_c *R, csg_entity_c *E) {
         double z2 = (G->top->b.z + G->top->t.z) / 2.0;
 
         if (z1 < E->z && E->z < z2) {
-            E->ex_floor = (int)i;
+            // the entities are shared by the clipping hulls
+            if (!csg_is_clip_hull) {
+                E->ex_floor = (int)i;
+            }
 
             return G;
         }
@@ -1919,7 +1973,8 @@ void CSG_DiscoverGaps() {
     MarkGapsWithEntities();
 }
 
-void CSG_BSP(double grid, bool is_clip_hull) {
+void CSG_BSP(double grid, bool is_clip_hull,
+             const std::vector<csg_brush_c *> &brushes) {
     CSG_BSP_Free();
 
     QUANTIZE_GRID = grid;
@@ -1929,8 +1984,8 @@ void CSG_BSP(double grid, bool is_clip_hull) {
     group_c root;
 
     // create a region for every brush
-    for (unsigned int i = 0; i < all_brushes.size(); i++) {
-        CreateRegion(root, all_brushes[i]);
+    for (unsigned int i = 0; i < brushes.size(); i++) {
+        CreateRegion(root, brushes[i]);
     }
 
     for (unsigned int i = 0; i < all_entities.size(); i++) {
@@ -30,6 +30,8 @@
 #include "hdr_lua.h"
 #include "headers.h"
 #include "lib_file.h"
+#include "lib_pool.h"
+#include "lib_thread.h"
 #include "lib_util.h"
 #include "m_lua.h"
 #include "main.h"
@@ -394,27 +396,44 @@ class clip_node_c {
     }
 };
 
-static std::vector<csg_brush_c *> saved_all_brushes;
+class clip_hull_c {
+    // The work for one clipping hull.  The hulls only depend on the
+    // original brushes, so they are built at the same time by worker
+    // threads, each having its own CSG regions (they are thread_local).
+    // Writing the clipnodes adds planes, which must happen in the same
+    // order as a serial build, so that is done afterwards.
 
-static std::vector<clip_side_c *> all_clip_sides;
+   public:
+    int hull;
+
+    const double *pads;
+
+    // the fattened copies of the solid brushes
+    std::vector<csg_brush_c *> brushes;
+
+    clip_node_c *root;
+
+   public:
+    clip_hull_c(int _hull, const double *_pads)
+        : hull(_hull), pads(_pads), brushes(), root(NULL) {}
+
+    ~clip_hull_c() { delete root; }
+};
 
 //------------------------------------------------------------------------
 
-static void SaveBrushes() {
-    saved_all_brushes.clear();
+static void FreeFatBrushes(clip_hull_c *H) {
+    for (unsigned int i = 0; i < H->brushes.size(); i++) {
+        csg_brush_c *P2 = H->brushes[i];
 
-    std::swap(all_brushes, saved_all_brushes);
-}
+        // these were copied from the original brush, not cloned
+        P2->b.slope = P2->t.slope = NULL;
+        P2->b.uv_mat = P2->t.uv_mat = NULL;
 
-static void RestoreBrushes() {
-    // free our modified ones
-    for (unsigned int i = 0; i < all_brushes.size(); i++) {
-        delete all_brushes[i];
+        delete P2;
     }
 
-    all_brushes.clear();
-
-    std::swap(all_brushes, saved_all_brushes);
+    H->brushes.clear();
 }
 
 static void CalcNormal(double x1, double y1, double x2, double y2, double *nx,
@@ -590,11 +609,11 @@ static void FattenVertex3(const csg_brush_c *P, unsigned int k, csg_brush_c *P2,
     }
 }
 
-static void AddFatBrush(csg_brush_c *P2) {
+static void AddFatBrush(clip_hull_c *H, csg_brush_c *P2) {
     P2->ComputeBBox();
     P2->Validate();
 
-    all_brushes.push_back(P2);
+    H->brushes.push_back(P2);
 }
 
 #if 0  // TODO
@@ -621,9 +640,13 @@ static void AdjustSlope(slope_info_c *slope, double pad_w, bool is_ceil)
 }
 #endif
 
-static void FattenBrushes(double pad_w, double pad_t, double pad_b) {
-    for (unsigned int i = 0; i < saved_all_brushes.size(); i++) {
-        csg_brush_c *P = saved_all_brushes[i];
+static void FattenBrushes(clip_hull_c *H) {
+    double pad_w = H->pads[0];
+    double pad_t = H->pads[1];
+    double pad_b = H->pads[2];
+
+    for (unsigned int i = 0; i < all_brushes.size(); i++) {
+        csg_brush_c *P = all_brushes[i];
 
         if (P->bkind != BKIND_Solid) {
             continue;
@@ -664,7 +687,7 @@ static void FattenBrushes(double pad_w, double pad_t, double pad_b) {
         }
 #endif
 
-        AddFatBrush(P2);
+        AddFatBrush(H, P2);
     }
 }
 
@@ -1069,28 +1092,12 @@ static void CreateClipSides(clip_group_c &group) {
     }
 }
 
-#if 0  // debugging stuff
-void CLIP_BEGIN()
-{
-    SaveBrushes();
-
-    FattenBrushes(16, 24, 32);
-}
-
-void CLIP_END()
-{
-    RestoreBrushes();
-}
-#endif
+static void Q1_BuildClipWorld(clip_hull_c *H) {
+    // this may run in a worker thread
 
-static void Q1_ClipWorld(int hull, const double *pads) {
-    qk_world_model->nodes[hull] = q1_total_clip;
+    FattenBrushes(H);
 
-    SaveBrushes();
-
-    FattenBrushes(pads[0], pads[1], pads[2]);
-
-    CSG_BSP(0.5, true /* is_clip_hull */);
+    CSG_BSP(0.5, true /* is_clip_hull */, H->brushes);
 
     CoalesceClipRegions();
 
@@ -1098,18 +1105,26 @@ static void Q1_ClipWorld(int hull, const double *pads) {
 
     CreateClipSides(GROUP);
 
-    clip_node_c *ROOT = PartitionGroup(GROUP);
+    H->root = PartitionGroup(GROUP);
+
+    // the clip tree does not refer to the regions or brushes
+    CSG_BSP_Free();
+
+    FreeFatBrushes(H);
+}
+
+static void Q1_WriteClipWorld(clip_hull_c *H) {
+    qk_world_model->nodes[H->hull] = q1_total_clip;
 
     int cur_index = q1_total_clip;
 
-    AssignIndexes(ROOT, &cur_index);
+    AssignIndexes(H->root, &cur_index);
 
-    WriteClipNodes(ROOT);
+    WriteClipNodes(H->root);
 
     // this deletes the entire BSP tree (nodes and leafs)
-    delete ROOT;
-
-    RestoreBrushes();
+    delete H->root;
+    H->root = NULL;
 }
 
 static void Q1_ClipMapModel(quake_mapmodel_c *model, int hull, double pad_w,
@@ -1149,7 +1164,7 @@ static void Q1_ClipMapModel(quake_mapmodel_c *model, int hull, double pad_w,
     }
 }
 
-void Q1_ClippingHull(int hull) {
+void Q1_ClippingHulls() {
     int clip_hulls = 2;
 
     if (qk_sub_format == SUBFMT_HalfLife) {
@@ -1159,17 +1174,11 @@ void Q1_ClippingHull(int hull) {
         clip_hulls = 5;
     }
 
-    SYS_ASSERT(hull >= 1);
-
-    if (hull > clip_hulls) {
-        return;
-    }
-
     if (main_action >= MAIN_CANCEL) {
         return;
     }
 
-    LogPrintf("\nClipping Hull {}...\n", hull);
+    LogPrintf("\nClipping Hulls (1 to {})...\n", clip_hulls);
 
 #ifndef CONSOLE_ONLY
     if (main_win) {
@@ -1177,30 +1186,60 @@ void Q1_ClippingHull(int hull) {
     }
 #endif
 
-    ///???  FreeAll();
+    std::vector<clip_hull_c *> hulls;
 
-    const double *pads;
+    for (int hull = 1; hull <= clip_hulls; hull++) {
+        const double *pads;
 
-    if (qk_sub_format == SUBFMT_Hexen2) {
-        pads = H2_hull_sizes[hull - 1].data();
-    } else if (qk_sub_format == SUBFMT_HalfLife) {
-        pads = HL_hull_sizes[hull - 1].data();
-    } else {
-        pads = Q1_hull_sizes[hull - 1].data();
+        if (qk_sub_format == SUBFMT_Hexen2) {
+            pads = H2_hull_sizes[hull - 1].data();
+        } else if (qk_sub_format == SUBFMT_HalfLife) {
+            pads = HL_hull_sizes[hull - 1].data();
+        } else {
+            pads = Q1_hull_sizes[hull - 1].data();
+        }
+
+        hulls.push_back(new clip_hull_c(hull, pads));
     }
 
-    // first clip the world, then the map-models
+    bool finished = Thread_ParallelFor(
+        (int)hulls.size(),
+        [&](int index, int /*worker*/) {
+            Q1_BuildClipWorld(hulls[index]);
+
+            // a worker has nothing left in its pools now
+            if (Thread_IsWorker()) {
+                Pool_ReleaseAll(false);
+            }
+        },
+        []() {
+#ifndef CONSOLE_ONLY
+            Main::Ticker();
+#endif
+            return main_action < MAIN_CANCEL;
+        });
 
-    Q1_ClipWorld(hull, pads);
+    // write each hull in turn: first the world, then the map-models
 
-    for (auto *qk_all_mapmodel : qk_all_mapmodels) {
-        Q1_ClipMapModel(qk_all_mapmodel, hull, pads[0], pads[1], pads[2]);
+    for (unsigned int i = 0; i < hulls.size() && finished; i++) {
+        clip_hull_c *H = hulls[i];
+
+        Q1_WriteClipWorld(H);
+
+        for (auto *qk_all_mapmodel : qk_all_mapmodels) {
+            Q1_ClipMapModel(qk_all_mapmodel, H->hull, H->pads[0],
+                            H->pads[1], H->pads[2]);
+        }
+
+        if (q1_total_clip >= MAX_MAP_CLIPNODES) {
+            Main::FatalError(
+                "Quake build failure: exceeded limit of {} CLIPNODES\n",
+                MAX_MAP_CLIPNODES);
+        }
     }
 
-    if (q1_total_clip >= MAX_MAP_CLIPNODES) {
-        Main::FatalError(
-            "Quake build failure: exceeded limit of {} CLIPNODES\n",
-            MAX_MAP_CLIPNODES);
+    for (clip_hull_c *H : hulls) {
+        delete H;
     }
 }
 
@@ -66,6 +66,10 @@ class snag_c {
 
     ~snag_c();
 
+    // these come from a pool, see CSG_end_level()
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
     double Length() const;
 
     snag_c *Cut(double ix, double iy);
@@ -119,6 +123,10 @@ class region_c {
 
     ~region_c();
 
+    // these come from a pool, see CSG_end_level()
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
     void AddSnag(snag_c *S);
     bool HasSnag(snag_c *S) const;
     bool RemoveSnag(snag_c *S);
@@ -178,6 +186,10 @@ class gap_c {
 
     ~gap_c();
 
+    // these come from a pool, see CSG_end_level()
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
     void AddNeighbor(gap_c *N);
     bool HasNeighbor(gap_c *N) const;
 };
@@ -205,6 +217,10 @@ class bsp_node_c {
     // destructor deletes child nodes (but not leafs)
     ~bsp_node_c();
 
+    // these come from a pool, see CSG_end_level()
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
     void ComputeBBox();
 
    private:
@@ -214,13 +230,15 @@ class bsp_node_c {
 
 /***** VARIABLES ****************/
 
-extern std::vector<region_c *> all_regions;
+// these belong to the calling thread
+extern thread_local std::vector<region_c *> all_regions;
 
-extern bsp_node_c *bsp_root;
+extern thread_local bsp_node_c *bsp_root;
 
 /***** FUNCTIONS ****************/
 
-void CSG_BSP(double grid, bool is_clip_hull = false);
+void CSG_BSP(double grid, bool is_clip_hull = false,
+             const std::vector<csg_brush_c *> &brushes = all_brushes);
 void CSG_BSP_Free();
 
 region_c *CSG_PointInRegion(double x, double y);
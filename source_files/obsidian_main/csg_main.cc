@@ -22,6 +22,9 @@
 #include "csg_main.h"
 
 #include <algorithm>
+#include <cerrno>
+#include <deque>
+#include <unordered_map>
 
 #include "csg_local.h"
 #include "csg_quake.h"  // for quake_plane_c
@@ -31,6 +34,7 @@
 #endif
 #include "hdr_lua.h"
 #include "headers.h"
+#include "lib_pool.h"
 #include "lib_util.h"
 #include "m_lua.h"
 #include "main.h"
@@ -63,46 +67,191 @@ extern void SPOT_FillPolygon(byte content, const int *shape, int count);
 
 extern bool QLIT_ParseProperty(std::string key, std::string value);
 
-void csg_property_set_c::Add(std::string key, std::string value) {
-    dict[key] = std::string(value);
+// the names live in a deque so that the string_views used as keys
+// of the lookup table never move.
+static std::deque<std::string> prop_atom_names;
+static std::unordered_map<std::string_view, csg_prop_atom_t> prop_atom_table;
+
+csg_prop_atom_t CSG_PropAtom(std::string_view name) {
+    std::unordered_map<std::string_view, csg_prop_atom_t>::iterator PI;
+
+    PI = prop_atom_table.find(name);
+
+    if (PI != prop_atom_table.end()) {
+        return PI->second;
+    }
+
+    csg_prop_atom_t atom = (csg_prop_atom_t)prop_atom_names.size();
+
+    prop_atom_names.emplace_back(name);
+
+    prop_atom_table[prop_atom_names.back()] = atom;
+
+    return atom;
 }
 
-void csg_property_set_c::Remove(std::string key) { dict.erase(key); }
+csg_prop_atom_t CSG_FindPropAtom(std::string_view name) {
+    std::unordered_map<std::string_view, csg_prop_atom_t>::const_iterator PI;
 
-void csg_property_set_c::DebugDump() {
-    std::map<std::string, std::string>::iterator PI;
+    PI = prop_atom_table.find(name);
+
+    if (PI == prop_atom_table.end()) {
+        return -1;
+    }
+
+    return PI->second;
+}
+
+const std::string &CSG_PropAtomName(csg_prop_atom_t atom) {
+    SYS_ASSERT(atom >= 0 && atom < (int)prop_atom_names.size());
+
+    return prop_atom_names[atom];
+}
+
+csg_property_c::csg_property_c(csg_prop_atom_t _key, std::string _value)
+    : key(_key), is_number(false), ivalue(0), dvalue(0), value(std::move(_value)) {
+    // this accepts exactly what StringToDouble() does, but strings
+    // which are not numbers are simply left alone.
+    const char *str = value.c_str();
+    char *str_end;
+
+    errno = 0;
+
+    double num = strtod(str, &str_end);
+
+    if (str_end != str && errno != ERANGE) {
+        is_number = true;
+
+        dvalue = num;
+        ivalue = I_ROUND(num);
+    }
+}
+
+csg_property_c::csg_property_c(csg_prop_atom_t _key, double _value)
+    : key(_key), is_number(true), ivalue(0), dvalue(0), value() {
+    // most values are whole numbers, which "%.14g" prints exactly
+    // (range is checked first, the cast is undefined outside of it)
+    if (std::isfinite(_value) && fabs(_value) < 1e14 &&
+        _value == (double)(long long)_value &&
+        !(_value == 0 && std::signbit(_value))) {
+        value = std::to_string((long long)_value);
+
+        dvalue = _value;
+        ivalue = I_ROUND(_value);
+        return;
+    }
+
+    // otherwise use the same format as LUAI_NUMFFORMAT, so the string
+    // matches what lua_tostring() would have produced.  The number is
+    // read back from it so that it also matches the string constructor.
+    char buffer[64];
+
+    snprintf(buffer, sizeof(buffer), "%.14g", _value);
+
+    value = buffer;
+
+    dvalue = strtod(buffer, NULL);
+    ivalue = I_ROUND(dvalue);
+}
+
+void csg_property_set_c::Add(std::string_view key, std::string value) {
+    Add(CSG_PropAtom(key), std::move(value));
+}
+
+void csg_property_set_c::Add(csg_prop_atom_t key, std::string value) {
+    Insert(csg_property_c(key, std::move(value)));
+}
+
+void csg_property_set_c::Add(csg_prop_atom_t key, double value) {
+    Insert(csg_property_c(key, value));
+}
+
+void csg_property_set_c::Insert(csg_property_c &&prop) {
+    const std::string &name = CSG_PropAtomName(prop.key);
 
+    std::vector<csg_property_c>::iterator PI;
+
+    for (PI = props.begin(); PI != props.end(); PI++) {
+        if (PI->key == prop.key) {
+            *PI = std::move(prop);
+            return;
+        }
+
+        if (PI->Key() > name) {
+            break;
+        }
+    }
+
+    props.insert(PI, std::move(prop));
+}
+
+void csg_property_set_c::Remove(std::string_view key) {
+    csg_prop_atom_t atom = CSG_FindPropAtom(key);
+
+    for (unsigned int i = 0; i < props.size(); i++) {
+        if (props[i].key == atom) {
+            props.erase(props.begin() + i);
+            return;
+        }
+    }
+}
+
+void csg_property_set_c::DebugDump() {
     fmt::print(stderr, "{\n");
 
-    for (PI = dict.begin(); PI != dict.end(); PI++) {
-        fmt::print(stderr, "  {} = \"{}\"\n", PI->first.c_str(),
-                   PI->second.c_str());
+    for (const csg_property_c &P : props) {
+        fmt::print(stderr, "  {} = \"{}\"\n", P.Key(), P.value);
     }
 
     fmt::print(stderr, "}\n");
 }
 
-std::string csg_property_set_c::getStr(std::string key,
+const csg_property_c *csg_property_set_c::Find(std::string_view key) const {
+    csg_prop_atom_t atom = CSG_FindPropAtom(key);
+
+    if (atom < 0) {
+        return NULL;
+    }
+
+    for (const csg_property_c &P : props) {
+        if (P.key == atom) {
+            return &P;
+        }
+    }
+
+    return NULL;
+}
+
+std::string csg_property_set_c::getStr(std::string_view key,
                                        std::string def_val) const {
-    std::map<std::string, std::string>::const_iterator PI = dict.find(key);
+    const csg_property_c *P = Find(key);
 
-    if (PI == dict.end()) {
+    if (!P) {
         return def_val;
     }
 
-    return PI->second.c_str();
+    return P->value;
 }
 
-double csg_property_set_c::getDouble(std::string key, double def_val) const {
-    std::string str = getStr(key);
+double csg_property_set_c::getDouble(std::string_view key,
+                                     double def_val) const {
+    const csg_property_c *P = Find(key);
 
-    return !str.empty() ? StringToDouble(str) : def_val;
+    if (!P || P->value.empty()) {
+        return def_val;
+    }
+
+    return P->is_number ? P->dvalue : StringToDouble(P->value);
 }
 
-int csg_property_set_c::getInt(std::string key, int def_val) const {
-    std::string str = getStr(key);
+int csg_property_set_c::getInt(std::string_view key, int def_val) const {
+    const csg_property_c *P = Find(key);
 
-    return !str.empty() ? I_ROUND(StringToDouble(str)) : def_val;
+    if (!P || P->value.empty()) {
+        return def_val;
+    }
+
+    return P->is_number ? P->ivalue : I_ROUND(StringToDouble(P->value));
 }
 
 void csg_property_set_c::getHexenArgs(u8_t *arg5) const {
@@ -133,6 +282,26 @@ float uv_matrix_c::Calc_T(float x, float y, float z) const {
     return t[0] * x + t[1] * y + t[2] * z + t[3];
 }
 
+// brushes and their vertices come from pools, which are released
+// in one go at the end of a level.
+
+static thread_local object_pool_c<csg_brush_c> brush_pool("brushes");
+static thread_local object_pool_c<brush_vert_c> brush_vert_pool("brush verts");
+
+void *brush_vert_c::operator new(size_t size) {
+    return brush_vert_pool.New(size);
+}
+
+void brush_vert_c::operator delete(void *ptr, size_t size) {
+    brush_vert_pool.Delete(ptr, size);
+}
+
+void *csg_brush_c::operator new(size_t size) { return brush_pool.New(size); }
+
+void csg_brush_c::operator delete(void *ptr, size_t size) {
+    brush_pool.Delete(ptr, size);
+}
+
 brush_vert_c::brush_vert_c(csg_brush_c *_parent, double _x, double _y)
     : parent(_parent), x(_x), y(_y), face(), uv_mat(NULL) {}
 
@@ -466,6 +635,100 @@ bool csg_entity_c::Match(std::string want_name) const {
 
 #define QUAD_NODE_SIZE 320
 
+// brush bboxes are expanded by this much for the ray tests, which
+// keeps them conservative w.r.t. csg_brush_c::IntersectRay (that
+// works in floats and allows 0.1 units of slop in Z).
+#define TRACE_BBOX_EPSILON 0.5
+
+// these bits mark brushes to ignore for the trace_ray() modes
+enum trace_skip_e {
+    TRACE_SKIP_Vis = (1 << 0),      // mode 'v'
+    TRACE_SKIP_Physics = (1 << 1),  // mode 'p'
+};
+
+static int Trace_ModeSkipFlag(std::string_view mode) {
+    if (mode.empty()) {
+        return 0;
+    }
+
+    switch (mode[0]) {
+        case 'v':
+            return TRACE_SKIP_Vis;
+        case 'p':
+            return TRACE_SKIP_Physics;
+        default:
+            return 0;
+    }
+}
+
+static int Trace_BrushSkipBits(const csg_brush_c *B) {
+    int bits = 0;
+
+    if ((B->bflags & BFLAG_NoDraw) || B->bkind == BKIND_Light ||
+        B->bkind == BKIND_Rail || B->bkind == BKIND_Trigger) {
+        bits |= TRACE_SKIP_Vis;
+    }
+
+    if ((B->bflags & BFLAG_NoClip) || B->bkind == BKIND_Liquid ||
+        B->bkind == BKIND_Light || B->bkind == BKIND_Rail ||
+        B->bkind == BKIND_Trigger) {
+        bits |= TRACE_SKIP_Physics;
+    }
+
+    return bits;
+}
+
+// a ray (really a line segment) prepared for slab tests.
+// 't' goes from 0 at the start to 1 at the end.
+class trace_ray_c {
+   public:
+    double x1, y1, z1;
+    double x2, y2, z2;
+
+    // reciprocal of the direction.  a huge (but finite) value is used
+    // for a zero direction, which gives the right answer without the
+    // NaNs that an infinity can produce.
+    double inv_dx, inv_dy, inv_dz;
+
+    int skip_flag;
+
+   public:
+    trace_ray_c(double _x1, double _y1, double _z1, double _x2, double _y2,
+                double _z2, int _skip_flag)
+        : x1(_x1),
+          y1(_y1),
+          z1(_z1),
+          x2(_x2),
+          y2(_y2),
+          z2(_z2),
+          skip_flag(_skip_flag) {
+        inv_dx = Reciprocal(x2 - x1);
+        inv_dy = Reciprocal(y2 - y1);
+        inv_dz = Reciprocal(z2 - z1);
+    }
+
+    // test the 2D part of the ray against a box
+    inline bool TouchesBox(double lx, double ly, double hx, double hy) const {
+        double tx0 = (lx - x1) * inv_dx;
+        double tx1 = (hx - x1) * inv_dx;
+        double ty0 = (ly - y1) * inv_dy;
+        double ty1 = (hy - y1) * inv_dy;
+
+        double t_min = std::max({0.0, std::min(tx0, tx1), std::min(ty0, ty1)});
+        double t_max = std::min({1.0, std::max(tx0, tx1), std::max(ty0, ty1)});
+
+        return t_min <= t_max;
+    }
+
+   private:
+    static double Reciprocal(double d) {
+        if (fabs(d) < 1e-9) {
+            return 1e30;
+        }
+        return 1.0 / d;
+    }
+};
+
 class brush_quad_node_c {
    public:
     int lo_x, lo_y, size;
@@ -474,6 +737,13 @@ class brush_quad_node_c {
 
     std::vector<csg_brush_c *> brushes;
 
+    // bounding boxes (expanded) and trace_ray() skip bits of the brushes
+    // above, kept as separate arrays so the ray tests run over
+    // contiguous memory and do not touch the brushes themselves.
+    std::vector<double> bb_lo_x, bb_lo_y, bb_lo_z;
+    std::vector<double> bb_hi_x, bb_hi_y, bb_hi_z;
+    std::vector<u8_t> skip_bits;
+
    public:
     inline int hi_x() const { return lo_x + size; }
     inline int hi_y() const { return lo_y + size; }
@@ -519,7 +789,21 @@ class brush_quad_node_c {
         }
     }
 
-   private:
+    void StoreBrush(csg_brush_c *B) {
+        brushes.push_back(B);
+
+        // b.z and t.z are bounding heights, even for sloped brushes
+        bb_lo_x.push_back(B->min_x - TRACE_BBOX_EPSILON);
+        bb_lo_y.push_back(B->min_y - TRACE_BBOX_EPSILON);
+        bb_lo_z.push_back(B->b.z - TRACE_BBOX_EPSILON);
+
+        bb_hi_x.push_back(B->max_x + TRACE_BBOX_EPSILON);
+        bb_hi_y.push_back(B->max_y + TRACE_BBOX_EPSILON);
+        bb_hi_z.push_back(B->t.z + TRACE_BBOX_EPSILON);
+
+        skip_bits.push_back(Trace_BrushSkipBits(B));
+    }
+
     void DoAddBrush(csg_brush_c *B, int x1, int y1, int x2, int y2) {
         // does it fit in a child node?
         if (children[0][0]) {
@@ -547,7 +831,7 @@ class brush_quad_node_c {
         }
 
         // nope -- gotta go in this node
-        brushes.push_back(B);
+        StoreBrush(B);
     }
 
    public:
@@ -561,24 +845,6 @@ class brush_quad_node_c {
     }
 
    private:
-    bool IntersectBrush(const csg_brush_c *B, double x1, double y1, double z1,
-                        double x2, double y2, double z2, std::string mode) {
-        if (mode[0] == 'v') {
-            if ((B->bflags & BFLAG_NoDraw) || B->bkind == BKIND_Light ||
-                B->bkind == BKIND_Rail || B->bkind == BKIND_Trigger) {
-                return false;
-            }
-        } else if (mode[0] == 'p') {
-            if ((B->bflags & BFLAG_NoClip) || B->bkind == BKIND_Liquid ||
-                B->bkind == BKIND_Light || B->bkind == BKIND_Rail ||
-                B->bkind == BKIND_Trigger) {
-                return false;
-            }
-        }
-
-        return B->IntersectRay(x1, y1, z1, x2, y2, z2);
-    }
-
     bool BoxTouchesThis(double x1, double y1, double x2, double y2) const {
         if (MAX(x1, x2) < lo_x) {
             return false;
@@ -597,28 +863,66 @@ class brush_quad_node_c {
         return true;
     }
 
-    bool RayTouchesBox(double x1, double y1, double x2, double y2) const {
-        // TODO: a _proper_ line/box test will be much more optimal
-        //       (assuming the average ray is fairly long).
+    bool RayTouchesBox(const trace_ray_c &R) const {
+        return R.TouchesBox(lo_x, lo_y, hi_x(), hi_y());
+    }
 
-        return BoxTouchesThis(x1, y1, x2, y2);
+    bool TraceBrushes(const trace_ray_c &R) const {
+        // the bbox tests are done a block at a time into a small array,
+        // a simple loop over the arrays which the compiler can vectorize.
+        const int BLOCK = 64;
+
+        bool maybe_hit[BLOCK];
+
+        int total = (int)brushes.size();
+
+        for (int base = 0; base < total; base += BLOCK) {
+            int count = std::min(BLOCK, total - base);
+
+            for (int i = 0; i < count; i++) {
+                int k = base + i;
+
+                double tx0 = (bb_lo_x[k] - R.x1) * R.inv_dx;
+                double tx1 = (bb_hi_x[k] - R.x1) * R.inv_dx;
+                double ty0 = (bb_lo_y[k] - R.y1) * R.inv_dy;
+                double ty1 = (bb_hi_y[k] - R.y1) * R.inv_dy;
+                double tz0 = (bb_lo_z[k] - R.z1) * R.inv_dz;
+                double tz1 = (bb_hi_z[k] - R.z1) * R.inv_dz;
+
+                double t_min = std::max({0.0, std::min(tx0, tx1),
+                                         std::min(ty0, ty1),
+                                         std::min(tz0, tz1)});
+                double t_max = std::min({1.0, std::max(tx0, tx1),
+                                         std::max(ty0, ty1),
+                                         std::max(tz0, tz1)});
+
+                maybe_hit[i] =
+                    (t_min <= t_max) && !(skip_bits[k] & R.skip_flag);
+            }
+
+            for (int i = 0; i < count; i++) {
+                if (maybe_hit[i] &&
+                    brushes[base + i]->IntersectRay(R.x1, R.y1, R.z1, R.x2,
+                                                    R.y2, R.z2)) {
+                    return true;
+                }
+            }
+        }
+
+        return false;
     }
 
    public:
-    bool TraceRay(double x1, double y1, double z1, double x2, double y2,
-                  double z2, std::string mode) {
-        for (unsigned int k = 0; k < brushes.size(); k++) {
-            if (IntersectBrush(brushes[k], x1, y1, z1, x2, y2, z2, mode)) {
-                return true;
-            }
+    bool TraceRay(const trace_ray_c &R) const {
+        if (TraceBrushes(R)) {
+            return true;
         }
 
         if (children[0][0]) {
             for (int cx = 0; cx < 2; cx++) {
                 for (int cy = 0; cy < 2; cy++) {
-                    if (children[cx][cy]->RayTouchesBox(x1, y1, x2, y2)) {
-                        if (children[cx][cy]->TraceRay(x1, y1, z1, x2, y2, z2,
-                                                       mode)) {
+                    if (children[cx][cy]->RayTouchesBox(R)) {
+                        if (children[cx][cy]->TraceRay(R)) {
                             return true;
                         }
                     }
@@ -631,7 +935,7 @@ class brush_quad_node_c {
 
    private:
     void SpotTestBrush(const csg_brush_c *B, int x1, int y1, int x2, int y2,
-                       int floor_h) {
+                       int floor_h, std::vector<int> &shape) {
         // ignore non-solid brushes
         if (B->bkind != BKIND_Solid || (B->bflags & BFLAG_NoClip)) {
             return;
@@ -670,8 +974,8 @@ class brush_quad_node_c {
             content = SPOT_WALL;
         }
 
-        // build the polygon
-        std::vector<int> shape;
+        // build the polygon (the caller's buffer is re-used between brushes)
+        shape.clear();
 
         int num_vert = (int)B->verts.size();
 
@@ -688,16 +992,18 @@ class brush_quad_node_c {
     }
 
    public:
-    void SpotStuff(int x1, int y1, int x2, int y2, int floor_h) {
+    void SpotStuff(int x1, int y1, int x2, int y2, int floor_h,
+                   std::vector<int> &shape) {
         for (unsigned int k = 0; k < brushes.size(); k++) {
-            SpotTestBrush(brushes[k], x1, y1, x2, y2, floor_h);
+            SpotTestBrush(brushes[k], x1, y1, x2, y2, floor_h, shape);
         }
 
         if (children[0][0]) {
             for (int cx = 0; cx < 2; cx++) {
                 for (int cy = 0; cy < 2; cy++) {
                     if (children[cx][cy]->BoxTouchesThis(x1, y1, x2, y2)) {
-                        children[cx][cy]->SpotStuff(x1, y1, x2, y2, floor_h);
+                        children[cx][cy]->SpotStuff(x1, y1, x2, y2, floor_h,
+                                                    shape);
                     }
                 }
             }
@@ -741,7 +1047,7 @@ class brush_quad_node_c {
         if (children[0][0]) {
             for (int cx = 0; cx < 2; cx++) {
                 for (int cy = 0; cy < 2; cy++) {
-                    if (children[cx][cy]->RayTouchesBox(x, y, x, y)) {
+                    if (children[cx][cy]->BoxTouchesThis(x, y, x, y)) {
                         if (children[cx][cy]->BrushContents(x, y, z, result,
                                                             liquid_depth)) {
                             return true;
@@ -792,21 +1098,34 @@ int Grab_Properties(lua_State *L, int stack_pos, csg_property_set_c *props,
             continue;
         }
 
-        const char *key = lua_tostring(L, -2);
+        size_t key_len;
+        const char *key = lua_tolstring(L, -2, &key_len);
 
         // optionally skip single letter keys ('x', 'y', etc)
-        if (skip_singles && strlen(key) == 1) {
+        if (skip_singles && key_len == 1) {
             continue;
         }
 
+        csg_prop_atom_t atom = CSG_PropAtom(std::string_view(key, key_len));
+
         // validate the value
         if (lua_type(L, -1) == LUA_TBOOLEAN) {
-            props->Add(key, lua_toboolean(L, -1) ? "1" : "0");
+            props->Add(atom, lua_toboolean(L, -1) ? "1" : "0");
+            continue;
+        }
+
+        // numbers are formatted directly, lua_tostring() would create
+        // (and intern) a new Lua string for each one.
+        if (lua_type(L, -1) == LUA_TNUMBER) {
+            props->Add(atom, (double)lua_tonumber(L, -1));
             continue;
         }
 
-        if (lua_type(L, -1) == LUA_TSTRING || lua_type(L, -1) == LUA_TNUMBER) {
-            props->Add(key, lua_tostring(L, -1));
+        if (lua_type(L, -1) == LUA_TSTRING) {
+            size_t len;
+            const char *str = lua_tolstring(L, -1, &len);
+
+            props->Add(atom, std::string(str, len));
             continue;
         }
 
@@ -1091,6 +1410,11 @@ int CSG_end_level(lua_State *L) {
 
     CSG_BSP_Free();
 
+    // everything in the pools should be gone now
+    LogPrintf("CSG object pools:\n");
+
+    Pool_ReleaseAll(true);
+
     return 0;
 }
 
@@ -1205,6 +1529,54 @@ int CSG_add_brush(lua_State *L) {
     return 0;
 }
 
+// LUA: add_brushes(list, ambient)
+//
+//   list    -- a list of brushes, each one the same as for add_brush().
+//              Brushes without a mode are solid.
+//
+//   ambient -- ambient light for every brush (can be nil)
+//
+// Same as calling add_brush() for each brush, but a whole prefab or
+// room can be sent in one call and the brushes do not need to be
+// copied to insert the mode and ambient light.
+//
+int CSG_add_brushes(lua_State *L) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+
+    bool has_ambient = !lua_isnoneornil(L, 2);
+
+    double ambient = has_ambient ? luaL_checknumber(L, 2) : 0;
+
+    csg_prop_atom_t ambient_atom = CSG_PropAtom("ambient");
+
+    int total = (int)lua_objlen(L, 1);
+
+    all_brushes.reserve(all_brushes.size() + total);
+
+    for (int index = 1; index <= total; index++) {
+        lua_rawgeti(L, 1, index);
+
+        csg_brush_c *B = new csg_brush_c();
+
+        Grab_CoordList(L, lua_gettop(L), B);
+
+        lua_pop(L, 1);
+
+        // this matches what raw_add_brush() does to the first coord
+        if (has_ambient) {
+            B->props.Add(ambient_atom, ambient);
+        } else {
+            B->props.Remove("ambient");
+        }
+
+        all_brushes.push_back(B);
+
+        brush_quad_tree->Add(B);
+    }
+
+    return 0;
+}
+
 // LUA: add_entity(props)
 //
 //   id      -- number or name of thing
@@ -1273,17 +1645,76 @@ int CSG_trace_ray(lua_State *L) {
 
     SYS_ASSERT(brush_quad_tree);
 
-    bool result = brush_quad_tree->TraceRay(x1, y1, z1, x2, y2, z2, mode);
+    bool result = brush_quad_tree->TraceRay(
+        trace_ray_c(x1, y1, z1, x2, y2, z2, Trace_ModeSkipFlag(mode)));
 
     lua_pushboolean(L, result ? 1 : 0);
     return 1;
 }
 
+// LUA: trace_rays(coords, mode)
+//
+//   coords -- a flat list with six numbers per ray:
+//             { x1,y1,z1, x2,y2,z2,  x1,y1,z1, x2,y2,z2, ... }
+//
+//   mode   -- same as for trace_ray()
+//
+//   result is a list with a boolean for each ray, 'true' if
+//   something hit.  Same as calling trace_ray() for each one.
+//
+int CSG_trace_rays(lua_State *L) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+
+    const char *mode = luaL_checkstring(L, 2);
+
+    if (!(mode[0] == 'v' || mode[0] == 'p')) {
+        return luaL_argerror(L, 2, "gui.trace_rays: bad mode string");
+    }
+
+    int total = (int)lua_objlen(L, 1);
+
+    if (total % 6 != 0) {
+        return luaL_argerror(L, 1,
+                             "gui.trace_rays: need six numbers per ray");
+    }
+
+    SYS_ASSERT(brush_quad_tree);
+
+    int skip_flag = Trace_ModeSkipFlag(mode);
+
+    lua_createtable(L, total / 6, 0);
+
+    for (int r = 0; r < total / 6; r++) {
+        double c[6];
+
+        for (int i = 0; i < 6; i++) {
+            lua_rawgeti(L, 1, r * 6 + i + 1);
+            c[i] = luaL_checknumber(L, -1);
+            lua_pop(L, 1);
+        }
+
+        if (fabs(c[3] - c[0]) < 1 && fabs(c[4] - c[1]) < 1 &&
+            fabs(c[5] - c[2]) < 1) {
+            return luaL_error(L, "gui.trace_rays: zero-length vector (ray %d)",
+                              r + 1);
+        }
+
+        bool result = brush_quad_tree->TraceRay(
+            trace_ray_c(c[0], c[1], c[2], c[3], c[4], c[5], skip_flag));
+
+        lua_pushboolean(L, result ? 1 : 0);
+        lua_rawseti(L, -2, r + 1);
+    }
+
+    return 1;
+}
+
 bool CSG_TraceRay(double x1, double y1, double z1, double x2, double y2,
-                  double z2, std::string mode) {
+                  double z2, std::string_view mode) {
     SYS_ASSERT(brush_quad_tree);
 
-    return brush_quad_tree->TraceRay(x1, y1, z1, x2, y2, z2, mode);
+    return brush_quad_tree->TraceRay(
+        trace_ray_c(x1, y1, z1, x2, y2, z2, Trace_ModeSkipFlag(mode)));
 }
 
 int CSG_BrushContents(double x, double y, double z, double *liquid_depth) {
@@ -1305,7 +1736,9 @@ int CSG_BrushContents(double x, double y, double z, double *liquid_depth) {
 }
 
 void CSG_spot_processing(int x1, int y1, int x2, int y2, int floor_h) {
-    brush_quad_tree->SpotStuff(x1, y1, x2, y2, floor_h);
+    std::vector<int> shape;
+
+    brush_quad_tree->SpotStuff(x1, y1, x2, y2, floor_h, shape);
 }
 
 //------------------------------------------------------------------------
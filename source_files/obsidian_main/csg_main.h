@@ -24,6 +24,7 @@
 
 #include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "sys_type.h"
@@ -51,35 +52,84 @@ extern double CLUSTER_SIZE;
 
 /******* CLASSES ***************/
 
+// property keys are interned, so that each property only needs to
+// store a small number and lookups are simple integer compares.
+typedef int csg_prop_atom_t;
+
+csg_prop_atom_t CSG_PropAtom(std::string_view name);
+// returns the atom for the given key, creating it when new.
+
+csg_prop_atom_t CSG_FindPropAtom(std::string_view name);
+// returns -1 if the key has never been used by any property.
+// this never modifies the atom table.
+
+const std::string &CSG_PropAtomName(csg_prop_atom_t atom);
+
+class csg_property_c {
+   public:
+    csg_prop_atom_t key;
+
+    // the value is always kept as a string (e.g. for writing out
+    // entities), but when it looks like a number it is converted
+    // once when added instead of on every lookup.
+    bool is_number;
+
+    int ivalue;
+    double dvalue;
+
+    std::string value;
+
+   public:
+    csg_property_c(csg_prop_atom_t _key, std::string _value);
+
+    // the string is formatted the same way Lua converts a number
+    csg_property_c(csg_prop_atom_t _key, double _value);
+
+    ~csg_property_c() {}
+
+    const std::string &Key() const { return CSG_PropAtomName(key); }
+};
+
 class csg_property_set_c {
    private:
-    std::map<std::string, std::string> dict;
+    // kept sorted by key name, which is the order they are written out.
+    // objects only have a handful of properties, so a linear search
+    // of this is cheaper than any kind of tree or hash table.
+    std::vector<csg_property_c> props;
 
    public:
-    csg_property_set_c() : dict() {}
+    csg_property_set_c() : props() {}
 
     ~csg_property_set_c() {}
 
     // copy constructor
-    csg_property_set_c(const csg_property_set_c &other) : dict(other.dict) {}
+    csg_property_set_c(const csg_property_set_c &other) : props(other.props) {}
+
+    void Add(std::string_view key, std::string value);
+    void Add(csg_prop_atom_t key, std::string value);
+    void Add(csg_prop_atom_t key, double value);
 
-    void Add(std::string key, std::string value);
-    void Remove(std::string key);
+    void Remove(std::string_view key);
 
-    std::string getStr(std::string key, std::string def_val = "") const;
+    std::string getStr(std::string_view key, std::string def_val = "") const;
 
-    double getDouble(std::string key, double def_val = 0) const;
-    int getInt(std::string key, int def_val = 0) const;
+    double getDouble(std::string_view key, double def_val = 0) const;
+    int getInt(std::string_view key, int def_val = 0) const;
 
     void getHexenArgs(u8_t *arg5) const;
 
     void DebugDump();
 
+   private:
+    const csg_property_c *Find(std::string_view key) const;
+
+    void Insert(csg_property_c &&prop);
+
    public:
-    typedef std::map<std::string, std::string>::iterator iterator;
+    typedef std::vector<csg_property_c>::const_iterator iterator;
 
-    iterator begin() { return dict.begin(); }
-    iterator end() { return dict.end(); }
+    iterator begin() const { return props.begin(); }
+    iterator end() const { return props.end(); }
 };
 
 class uv_matrix_c {
@@ -113,6 +163,10 @@ class brush_vert_c {
    public:
     brush_vert_c(csg_brush_c *_parent, double _x = 0, double _y = 0);
     ~brush_vert_c();
+
+    // these come from a pool, see CSG_end_level()
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
 };
 
 class brush_plane_c {
@@ -191,6 +245,10 @@ class csg_brush_c {
     // NOTE: verts and slopes are not cloned
     csg_brush_c(const csg_brush_c *other);
 
+    // these come from a pool, see CSG_end_level()
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
     void ComputeBBox();
     void ComputePlanes();
 
@@ -244,7 +302,7 @@ extern std::string dummy_plane_tex;
 void CSG_Main_Free();
 
 bool CSG_TraceRay(double x1, double y1, double z1, double x2, double y2,
-                  double z2, std::string mode);
+                  double z2, std::string_view mode);
 
 int CSG_BrushContents(double x, double y, double z,
                       double *liquid_depth = NULL);
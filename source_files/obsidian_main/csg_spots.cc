@@ -29,6 +29,10 @@
 #include <iso646.h>
 #endif
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #define GRID_SIZE 20
 
 #define MAX_MON_CELLS 14 /* i.e. 280 units */
@@ -59,6 +63,15 @@ static byte **spot_grid;
 static int *grid_lefties;
 static int *grid_righties;
 
+// Bit-plane used while finding monster spots: one bit per cell which
+// is set when the cell is unusable for the current pass (has a monster,
+// is a dud, or the content is too high).  Stored column by column like
+// spot_grid, so the vertical scans in biggest_gap() and the rectangle
+// tests in test_mon_area() can work a whole 64-bit word at a time.
+static std::vector<uint64_t> mon_block_bits;
+
+static int mon_block_stride;  // words per column
+
 // declare this here (don't pull in all CSG headers)
 extern void CSG_spot_processing(int x1, int y1, int x2, int y2, int floor_h);
 
@@ -90,6 +103,8 @@ void SPOT_CreateGrid(byte content, int min_x, int min_y, int max_x, int max_y) {
 
     grid_lefties = new int[grid_H];
     grid_righties = new int[grid_H];
+
+    mon_block_stride = (grid_H + 63) / 64;
 }
 
 void SPOT_FreeGrid() {
@@ -109,6 +124,8 @@ void SPOT_FreeGrid() {
     if (grid_righties) {
         delete[] grid_righties;
     }
+
+    mon_block_bits.clear();
 }
 
 void SPOT_DumpGrid(const char *info) {
@@ -257,29 +274,103 @@ static void remove_dud_cells() {
     }
 }
 
+static inline int lowest_set_bit(uint64_t value) {
+    // value must not be zero
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return (int)index;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+static inline uint64_t *mon_block_column(int x) {
+    return &mon_block_bits[x * mon_block_stride];
+}
+
+static inline void mon_block_set(int x, int y) {
+    mon_block_column(x)[y >> 6] |= (uint64_t)1 << (y & 63);
+}
+
+static void build_mon_blocks(int want) {
+    mon_block_bits.assign(grid_W * mon_block_stride, 0);
+
+    for (int x = 0; x < grid_W; x++) {
+        for (int y = 0; y < grid_H; y++) {
+            byte content = spot_grid[x][y];
+
+            if ((content & (HAS_MON | IS_DUD)) || (content & 3) > want) {
+                mon_block_set(x, y);
+            }
+        }
+    }
+}
+
+// mask of the bits from 'lo' to 'hi' (inclusive, 0..63) in a word
+static inline uint64_t bit_range_mask(int lo, int hi) {
+    uint64_t upper = (hi >= 63) ? ~(uint64_t)0 : (((uint64_t)1 << (hi + 1)) - 1);
+
+    return upper & ~(((uint64_t)1 << lo) - 1);
+}
+
+static bool mon_column_clear(int x, int y1, int y2) {
+    // true if no cell from y1 to y2 (inclusive) is blocked
+    const uint64_t *col = mon_block_column(x);
+
+    int w1 = y1 >> 6;
+    int w2 = y2 >> 6;
+
+    for (int w = w1; w <= w2; w++) {
+        int lo = (w == w1) ? (y1 & 63) : 0;
+        int hi = (w == w2) ? (y2 & 63) : 63;
+
+        if (col[w] & bit_range_mask(lo, hi)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static int mon_column_next(int x, int y, bool blocked) {
+    // finds the first cell at or after y which is blocked (or not),
+    // returns grid_H if there is none.
+    const uint64_t *col = mon_block_column(x);
+
+    for (int w = y >> 6; w < mon_block_stride; w++) {
+        uint64_t bits = blocked ? col[w] : ~col[w];
+
+        if (w == (y >> 6)) {
+            bits &= bit_range_mask(y & 63, 63);
+        }
+
+        if (bits) {
+            return std::min(grid_H, w * 64 + lowest_set_bit(bits));
+        }
+    }
+
+    return grid_H;
+}
+
 static bool test_mon_area(int x1, int y1, int x2, int y2, int want) {
+    // the 'want' value is already part of mon_block_bits
+    (void)want;
+
     if (x1 < 0 or x2 >= grid_W or y1 < 0 or y2 >= grid_H) {
         return false;
     }
 
     for (int x = x1; x <= x2; x++) {
-        for (int y = y1; y <= y2; y++) {
-            byte content = spot_grid[x][y];
-
-            if (content & (HAS_MON | IS_DUD)) {
-                return false;
-            }
-
-            if ((content & 3) > want) {
-                return false;
-            }
+        if (!mon_column_clear(x, y1, y2)) {
+            return false;
         }
     }
 
     return true;
 }
 
-static int biggest_gap(int *y1, int *y2, int want) {
+static int biggest_gap(int *y1, int *y2) {
     // Note: this also duds any single square spots, which will never
     //       get used because they'll never form a 2x2 group.
 
@@ -289,24 +380,22 @@ static int biggest_gap(int *y1, int *y2, int want) {
     for (int x = 0; x < grid_W; x++) {
         int y = 0;
 
-        while (y < grid_H - 1) {
-            if (!test_mon_area(x, y, x, y, want)) {
-                y++;
-                continue;
-            }
-
-            int ey = y;
+        for (;;) {
+            // find start of the next free run (cannot be the last row)
+            y = mon_column_next(x, y, false);
 
-            while (ey < grid_H - 1 &&
-                   test_mon_area(x, ey + 1, x, ey + 1, want)) {
-                ey++;
+            if (y >= grid_H - 1) {
+                break;
             }
 
+            int ey = mon_column_next(x, y + 1, true) - 1;
+
             int num = ey - y + 1;
 
             if (num == 1) {
                 // single squares are useless, remove them now
                 spot_grid[x][y] |= IS_DUD;
+                mon_block_set(x, y);
             } else if (num > best_num) {
                 best_x = x;
                 best_num = num;
@@ -426,6 +515,7 @@ static void mark_monster(int x1, int y1, int x2, int y2, byte flag) {
     for (int x = x1; x <= x2; x++) {
         for (int y = y1; y <= y2; y++) {
             spot_grid[x][y] |= flag;
+            mon_block_set(x, y);
         }
     }
 }
@@ -438,11 +528,13 @@ void SPOT_MonsterSpots(std::vector<grid_point_c> &spots, int want) {
     //
     //   repeat until no more available.
 
+    build_mon_blocks(want);
+
     for (;;) {
         int x1, x2;
         int y1 = 0, y2 = 0;
 
-        x1 = biggest_gap(&y1, &y2, want);
+        x1 = biggest_gap(&y1, &y2);
 
         if (x1 < 0) {
             return;
@@ -675,16 +767,19 @@ void SPOT_FillPolygon(byte content, std::vector<grid_point_c> &points) {
 }
 
 void SPOT_FillPolygon(byte content, const int *shape, int count) {
-    std::vector<grid_point_c> points;
+    // same as above, but the coordinates are pairs in a flat array.
+    // this is called for every blocking brush, so avoid the copy.
+
+    clear_rows();
 
     for (int i = 0; i < count; i++) {
-        int x = shape[i * 2 + 0];
-        int y = shape[i * 2 + 1];
+        int k = (i + 1) % count;
 
-        points.push_back(grid_point_c(x, y));
+        draw_line(shape[i * 2 + 0], shape[i * 2 + 1], shape[k * 2 + 0],
+                  shape[k * 2 + 1]);
     }
 
-    SPOT_FillPolygon(content, points);
+    fill_rows(content);
 }
 
 void SPOT_DebuggingTest() {
@@ -60,6 +60,19 @@
 
 #include "dm_prefab.h"
 
+#include <array>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <type_traits>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
 #include "aj_poly.h"
 #include "csg_main.h"
 #include "g_doom.h"
@@ -108,38 +121,293 @@ void Appl_Printf(const char *str, ...) {
 }
 
 //------------------------------------------------------------------------
+//  PREFAB CACHE
+//------------------------------------------------------------------------
+//
+//  Polygonating a prefab costs far more than reading the results back,
+//  and the same prefab WADs get loaded over and over, so the tables the
+//  wadfab_get_xxx() functions need are snapshotted after the first load
+//  and kept for the rest of the run.  When the 'prefab_cache' option is
+//  set they are also written to a file in the config directory, so later
+//  runs can skip polygonation entirely.
+//
+//  Entries are keyed on file name + map name, and are only reused when
+//  the size and modification time of the file still match.
+//
 
-int wadfab_free(lua_State *L) {
-    ajpoly::CloseMap();
-    ajpoly::FreeMap();
-    ajpoly::FreeWAD();
-    return 0;
+namespace {
+
+struct fab_thing_t {
+    int x, y, z;
+    int height;
+    int angle;
+    int type;
+    int options;
+    int tid;
+    int special;
+    std::array<u8_t, 5> args;
+};
+
+struct fab_sector_t {
+    int floor_h, ceil_h;
+    int light;
+    int special;
+    int tag;
+
+    // range in the 3D floor table
+    int floor_start;
+    int num_floors;
+
+    // tag is not sent for sectors containing 3D floors
+    bool has_3d_floors;
+
+    std::array<char, 10> floor_tex;
+    std::array<char, 10> ceil_tex;
+};
+
+struct fab_side_t {
+    int sector;  // -1 if none
+    int x_offset, y_offset;
+
+    std::array<char, 10> upper_tex;
+    std::array<char, 10> lower_tex;
+    std::array<char, 10> mid_tex;
+};
+
+struct fab_line_t {
+    int x1, y1, x2, y2;
+    int right, left;  // -1 if none
+    int flags;
+    int special;
+    int tag;
+    std::array<u8_t, 5> args;
+};
+
+struct fab_3d_floor_t {
+    int bottom_h, top_h;
+    int x_offset, y_offset;
+    int special;
+    int light;
+    bool liquid;
+
+    std::array<char, 10> bottom_tex;
+    std::array<char, 10> top_tex;
+    std::array<char, 10> side_tex;
+};
+
+struct fab_edge_t {
+    double x, y;
+    double along;
+    int line;  // -1 if none
+    int side;  // outer sidedef, -1 if none
+};
+
+struct fab_polygon_t {
+    int sector;  // -1 for void space
+    int edge_start;
+    int num_edges;
+};
+
+class wadfab_c {
+   public:
+    // file stamp, used to detect stale entries
+    int64_t size = -1;
+    int64_t mtime = -1;
+
+    std::vector<fab_thing_t> things;
+    std::vector<fab_sector_t> sectors;
+    std::vector<fab_side_t> sides;
+    std::vector<fab_line_t> lines;
+    std::vector<fab_3d_floor_t> floors;
+    std::vector<fab_edge_t> edges;
+    std::vector<fab_polygon_t> polygons;
+};
+
+}  // namespace
+
+static constexpr const char *PREFAB_CACHE_FILENAME = "PREFAB_CACHE.bin";
+static constexpr char prefab_cache_magic[8] = {'O', 'B', 'P', 'F',
+                                               'C', 'A', 'C', '1'};
+
+bool prefab_cache = false;
+
+static std::map<std::string, std::unique_ptr<wadfab_c>> prefab_cache_map;
+
+static bool prefab_cache_loaded = false;
+static bool prefab_cache_dirty = false;
+
+static int prefab_cache_hits = 0;
+static int prefab_cache_misses = 0;
+
+// the prefab which wadfab_get_xxx() functions will read from
+static const wadfab_c *cur_fab = nullptr;
+
+static std::filesystem::path Prefab_CacheFile() {
+    return home_dir / PREFAB_CACHE_FILENAME;
 }
 
-int wadfab_load(lua_State *L) {
-    const char *filename = luaL_checkstring(L, 1);
-    const char *map = luaL_checkstring(L, 2);
+template <typename T>
+static void Cache_Put(std::ostream &fp, const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    fp.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
 
-    if (!PHYSFS_exists(filename)) {
-        return luaL_error(L, "wadfab_load: no such file: %s", filename);
+template <typename T>
+static bool Cache_Get(std::istream &fp, T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    return (bool)fp.read(reinterpret_cast<char *>(&value), sizeof(T));
+}
+
+static void Cache_PutString(std::ostream &fp, const std::string &str) {
+    Cache_Put(fp, (u32_t)str.size());
+    fp.write(str.data(), str.size());
+}
+
+static bool Cache_GetString(std::istream &fp, std::string &str) {
+    u32_t len;
+
+    if (!Cache_Get(fp, len) || len > 4096) {
+        return false;
     }
 
-    if (!ajpoly::LoadWAD(filename)) {
-        return luaL_error(L, "wadfab_load: %s", ajpoly::GetError());
+    str.resize(len);
+    return (bool)fp.read(str.data(), len);
+}
+
+template <typename T>
+static void Cache_PutTable(std::ostream &fp, const std::vector<T> &table) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    Cache_Put(fp, (u32_t)table.size());
+    fp.write(reinterpret_cast<const char *>(table.data()),
+             table.size() * sizeof(T));
+}
+
+template <typename T>
+static bool Cache_GetTable(std::istream &fp, std::vector<T> &table) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    u32_t count;
+
+    if (!Cache_Get(fp, count) || count > (1 << 20)) {
+        return false;
     }
 
-    if (!ajpoly::OpenMap(map)) {
-        return luaL_error(L, "wadfab_load: %s", ajpoly::GetError());
+    table.resize(count);
+    return (bool)fp.read(reinterpret_cast<char *>(table.data()),
+                         count * sizeof(T));
+}
+
+static void Prefab_LoadCache() {
+    prefab_cache_loaded = true;
+
+    if (!prefab_cache) {
+        return;
     }
 
-    if (!ajpoly::Polygonate(true /* require_border */)) {
-        return luaL_error(L, "wadfab_load: %s", ajpoly::GetError());
+    std::ifstream fp(Prefab_CacheFile(), std::ios::in | std::ios::binary);
+
+    if (!fp.is_open()) {
+        return;
     }
 
-    return 0;
+    char magic[sizeof(prefab_cache_magic)];
+    std::string version;
+    u32_t count;
+
+    if (!fp.read(magic, sizeof(magic)) ||
+        memcmp(magic, prefab_cache_magic, sizeof(magic)) != 0 ||
+        !Cache_GetString(fp, version) || version != OBSIDIAN_VERSION ||
+        !Cache_Get(fp, count)) {
+        LogPrintf("Ignoring outdated prefab cache file.\n");
+        return;
+    }
+
+    for (u32_t i = 0; i < count; i++) {
+        std::string key;
+        auto fab = std::make_unique<wadfab_c>();
+
+        if (!Cache_GetString(fp, key) || !Cache_Get(fp, fab->size) ||
+            !Cache_Get(fp, fab->mtime) || !Cache_GetTable(fp, fab->things) ||
+            !Cache_GetTable(fp, fab->sectors) ||
+            !Cache_GetTable(fp, fab->sides) ||
+            !Cache_GetTable(fp, fab->lines) ||
+            !Cache_GetTable(fp, fab->floors) ||
+            !Cache_GetTable(fp, fab->edges) ||
+            !Cache_GetTable(fp, fab->polygons)) {
+            LogPrintf("Prefab cache file is truncated.\n");
+            break;
+        }
+
+        prefab_cache_map[key] = std::move(fab);
+    }
+
+    LogPrintf("Loaded {} prefabs from cache file.\n", prefab_cache_map.size());
 }
 
-//------------------------------------------------------------------------
+static void Prefab_SaveCache() {
+    const std::filesystem::path filename = Prefab_CacheFile();
+
+    // write to a temporary file first, so that an interrupted save
+    // (or another instance reading it) never sees a partial cache.
+    std::filesystem::path temp_name = filename;
+    temp_name += fmt::format(".{}.tmp", getpid());
+
+    {
+        std::ofstream fp(temp_name,
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+
+        if (!fp.is_open()) {
+            LogPrintf("Error: unable to create file: {}\n({})\n\n",
+                      temp_name.string(), strerror(errno));
+            return;
+        }
+
+        fp.write(prefab_cache_magic, sizeof(prefab_cache_magic));
+        Cache_PutString(fp, OBSIDIAN_VERSION);
+        Cache_Put(fp, (u32_t)prefab_cache_map.size());
+
+        for (const auto &[key, fab] : prefab_cache_map) {
+            Cache_PutString(fp, key);
+            Cache_Put(fp, fab->size);
+            Cache_Put(fp, fab->mtime);
+            Cache_PutTable(fp, fab->things);
+            Cache_PutTable(fp, fab->sectors);
+            Cache_PutTable(fp, fab->sides);
+            Cache_PutTable(fp, fab->lines);
+            Cache_PutTable(fp, fab->floors);
+            Cache_PutTable(fp, fab->edges);
+            Cache_PutTable(fp, fab->polygons);
+        }
+
+        if (!fp) {
+            LogPrintf("Error: failed writing prefab cache file.\n");
+            fp.close();
+            std::filesystem::remove(temp_name);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp_name, filename, ec);
+
+    if (ec) {
+        LogPrintf("Error: unable to rename {} --> {}\n",
+                  temp_name.string(), filename.string());
+        std::filesystem::remove(temp_name, ec);
+    }
+}
+
+void Prefab_CloseCache() {
+    if (prefab_cache_hits + prefab_cache_misses > 0) {
+        LogPrintf("Prefab cache: {} hits, {} misses\n", prefab_cache_hits,
+                  prefab_cache_misses);
+    }
+
+    if (prefab_cache && prefab_cache_dirty) {
+        Prefab_SaveCache();
+    }
+
+    prefab_cache_dirty = false;
+}
 
 static int calc_thing_z(int x, int y) {
     for (int p = 0; p < ajpoly::num_polygons; p++) {
@@ -159,14 +427,267 @@ static int calc_thing_z(int x, int y) {
     return 0;  // dummy value
 }
 
+static double calc_along_dist(const ajpoly::edge_c *E) {
+    const ajpoly::linedef_c *LD = E->linedef;
+    SYS_ASSERT(LD);
+
+    double ref_x = (E->side == 1) ? LD->start->x : LD->end->x;
+    double ref_y = (E->side == 1) ? LD->start->y : LD->end->y;
+
+    double dx = ref_x - E->end->x;
+    double dy = ref_y - E->end->y;
+
+    return hypot(dx, dy);
+}
+
+// the tables are written to the cache file as raw bytes, so the records
+// are cleared completely (padding included) before being filled in.
+template <typename T>
+static void Snapshot_Resize(std::vector<T> &table, int count) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    table.resize(count);
+    memset(table.data(), 0, table.size() * sizeof(T));
+}
+
+template <typename T>
+static T &Snapshot_Append(std::vector<T> &table) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    T &rec = table.emplace_back();
+    memset(&rec, 0, sizeof(T));
+    return rec;
+}
+
+static void Snapshot_3DFloors(wadfab_c *fab, const ajpoly::sector_c *S,
+                              fab_sector_t &sec) {
+    sec.floor_start = (int)fab->floors.size();
+    sec.num_floors = 0;
+
+    for (int k = 0; k < S->num_floors; k++) {
+        // determine line and dummy sector
+        const ajpoly::linedef_c *LD =
+            const_cast<ajpoly::sector_c *>(S)->getExtraFloor(k);
+
+        if (!LD || !LD->right || !LD->right->sector) {
+            break;
+        }
+
+        const ajpoly::sector_c *SEC = LD->right->sector;
+
+        fab_3d_floor_t &F = Snapshot_Append(fab->floors);
+
+        F.bottom_h = SEC->floor_h;
+        F.bottom_tex = SEC->floor_tex;
+        F.top_h = SEC->ceil_h;
+        F.top_tex = SEC->ceil_tex;
+        F.side_tex = LD->right->mid_tex;
+        F.x_offset = LD->right->x_offset;
+        F.y_offset = LD->right->y_offset;
+        F.special = SEC->special;
+        F.light = SEC->light;
+        F.liquid = (LD->special == 405);
+
+        sec.num_floors += 1;
+    }
+}
+
+// copy everything the wadfab_get_xxx() functions need out of the
+// AJ-Polygonator structures.
+static void Snapshot_Prefab(wadfab_c *fab) {
+    Snapshot_Resize(fab->things, ajpoly::num_things);
+
+    for (int i = 0; i < ajpoly::num_things; i++) {
+        const ajpoly::thing_c *TH = ajpoly::Thing(i);
+        fab_thing_t &T = fab->things[i];
+
+        T.x = TH->x;
+        T.y = TH->y;
+        T.z = calc_thing_z(TH->x, TH->y);
+        T.height = TH->height;
+        T.angle = TH->angle;
+        T.type = TH->type;
+        T.options = TH->options;
+        T.tid = TH->tid;
+        T.special = TH->special;
+        T.args = TH->args;
+    }
+
+    Snapshot_Resize(fab->sectors, ajpoly::num_sectors);
+
+    for (int i = 0; i < ajpoly::num_sectors; i++) {
+        const ajpoly::sector_c *SEC = ajpoly::Sector(i);
+        fab_sector_t &S = fab->sectors[i];
+
+        S.floor_h = SEC->floor_h;
+        S.ceil_h = SEC->ceil_h;
+        S.light = SEC->light;
+        S.special = SEC->special;
+        S.tag = SEC->tag;
+        S.has_3d_floors = (SEC->num_floors != 0);
+        S.floor_tex = SEC->floor_tex;
+        S.ceil_tex = SEC->ceil_tex;
+
+        Snapshot_3DFloors(fab, SEC, S);
+    }
+
+    Snapshot_Resize(fab->sides, ajpoly::num_sidedefs);
+
+    for (int i = 0; i < ajpoly::num_sidedefs; i++) {
+        const ajpoly::sidedef_c *SD = ajpoly::Sidedef(i);
+        fab_side_t &S = fab->sides[i];
+
+        S.sector = SD->sector ? SD->sector->index : -1;
+        S.x_offset = SD->x_offset;
+        S.y_offset = SD->y_offset;
+        S.upper_tex = SD->upper_tex;
+        S.lower_tex = SD->lower_tex;
+        S.mid_tex = SD->mid_tex;
+    }
+
+    Snapshot_Resize(fab->lines, ajpoly::num_linedefs);
+
+    for (int i = 0; i < ajpoly::num_linedefs; i++) {
+        const ajpoly::linedef_c *LD = ajpoly::Linedef(i);
+        fab_line_t &L = fab->lines[i];
+
+        L.x1 = (int)LD->start->x;
+        L.y1 = (int)LD->start->y;
+        L.x2 = (int)LD->end->x;
+        L.y2 = (int)LD->end->y;
+        L.right = LD->right ? LD->right->index : -1;
+        L.left = LD->left ? LD->left->index : -1;
+        L.flags = LD->flags;
+        L.special = LD->special;
+        L.tag = LD->tag;
+        L.args = LD->args;
+    }
+
+    Snapshot_Resize(fab->polygons, ajpoly::num_polygons);
+
+    std::vector<const ajpoly::edge_c *> edges;
+
+    for (int i = 0; i < ajpoly::num_polygons; i++) {
+        const ajpoly::polygon_c *poly = ajpoly::Polygon(i);
+        fab_polygon_t &P = fab->polygons[i];
+
+        P.sector = poly->sector ? poly->sector->index : -1;
+        if (P.sector == VOID_SECTOR_IDX) {
+            P.sector = -1;
+        }
+
+        edges.clear();
+        for (const ajpoly::edge_c *E = poly->edge_list; E; E = E->next) {
+            edges.push_back(E);
+        }
+
+        P.edge_start = (int)fab->edges.size();
+        P.num_edges = (int)edges.size();
+
+        // the polygon edges are clockwise, but OBLIGE are anti-clockwise.
+        // hence reverse the order.  We also use 'end' instead of 'start'.
+        for (auto it = edges.rbegin(); it != edges.rend(); ++it) {
+            const ajpoly::edge_c *E = *it;
+            fab_edge_t &FE = Snapshot_Append(fab->edges);
+
+            // using 'end' coord since edges face outwards
+            FE.x = E->end->x;
+            FE.y = E->end->y;
+            FE.along = 0;
+            FE.line = -1;
+            FE.side = -1;
+
+            if (E->linedef) {
+                FE.line = E->linedef->index;
+                FE.along = calc_along_dist(E);
+
+                // we want the "outer" sidedef (the opposite side)
+                const ajpoly::sidedef_c *SD =
+                    (E->side == 0) ? E->linedef->left : E->linedef->right;
+
+                if (SD) {
+                    FE.side = SD->index;
+                }
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------
+
+int wadfab_free(lua_State *L) {
+    cur_fab = nullptr;
+    return 0;
+}
+
+int wadfab_load(lua_State *L) {
+    const char *filename = luaL_checkstring(L, 1);
+    const char *map = luaL_checkstring(L, 2);
+
+    cur_fab = nullptr;
+
+    if (!prefab_cache_loaded) {
+        Prefab_LoadCache();
+    }
+
+    PHYSFS_Stat stat;
+
+    if (!PHYSFS_stat(filename, &stat)) {
+        return luaL_error(L, "wadfab_load: no such file: %s", filename);
+    }
+
+    std::string key = fmt::format("{}|{}", filename, map);
+
+    auto it = prefab_cache_map.find(key);
+
+    if (it != prefab_cache_map.end() && it->second->size == stat.filesize &&
+        it->second->mtime == stat.modtime) {
+        prefab_cache_hits += 1;
+        cur_fab = it->second.get();
+        return 0;
+    }
+
+    prefab_cache_misses += 1;
+
+    if (!ajpoly::LoadWAD(filename)) {
+        return luaL_error(L, "wadfab_load: %s", ajpoly::GetError());
+    }
+
+    if (!ajpoly::OpenMap(map)) {
+        return luaL_error(L, "wadfab_load: %s", ajpoly::GetError());
+    }
+
+    if (!ajpoly::Polygonate(true /* require_border */)) {
+        return luaL_error(L, "wadfab_load: %s", ajpoly::GetError());
+    }
+
+    auto fab = std::make_unique<wadfab_c>();
+
+    fab->size = stat.filesize;
+    fab->mtime = stat.modtime;
+
+    Snapshot_Prefab(fab.get());
+
+    ajpoly::CloseMap();
+    ajpoly::FreeMap();
+    ajpoly::FreeWAD();
+
+    cur_fab = fab.get();
+
+    prefab_cache_map[key] = std::move(fab);
+    prefab_cache_dirty = true;
+
+    return 0;
+}
+
+//------------------------------------------------------------------------
+
 int wadfab_get_thing(lua_State *L) {
     int index = luaL_checkinteger(L, 1);
 
-    if (index < 0 || index >= ajpoly::num_things) {
+    if (!cur_fab || index < 0 || index >= (int)cur_fab->things.size()) {
         return 0;
     }
 
-    const ajpoly::thing_c *TH = ajpoly::Thing(index);
+    const fab_thing_t *TH = &cur_fab->things[index];
 
     lua_newtable(L);
 
@@ -176,7 +697,7 @@ int wadfab_get_thing(lua_State *L) {
     lua_pushinteger(L, TH->y);
     lua_setfield(L, -2, "y");
 
-    lua_pushinteger(L, calc_thing_z(TH->x, TH->y));
+    lua_pushinteger(L, TH->z);
     lua_setfield(L, -2, "z");
 
     lua_pushinteger(L, TH->angle);
@@ -194,11 +715,11 @@ int wadfab_get_thing(lua_State *L) {
 int wadfab_get_thing_hexen(lua_State *L) {
     int index = luaL_checkinteger(L, 1);
 
-    if (index < 0 || index >= ajpoly::num_things) {
+    if (!cur_fab || index < 0 || index >= (int)cur_fab->things.size()) {
         return 0;
     }
 
-    const ajpoly::thing_c *TH = ajpoly::Thing(index);
+    const fab_thing_t *TH = &cur_fab->things[index];
 
     lua_newtable(L);
 
@@ -247,11 +768,11 @@ int wadfab_get_thing_hexen(lua_State *L) {
 int wadfab_get_sector(lua_State *L) {
     int index = luaL_checkinteger(L, 1);
 
-    if (index < 0 || index >= ajpoly::num_sectors) {
+    if (!cur_fab || index < 0 || index >= (int)cur_fab->sectors.size()) {
         return 0;
     }
 
-    const ajpoly::sector_c *SEC = ajpoly::Sector(index);
+    const fab_sector_t *SEC = &cur_fab->sectors[index];
 
     lua_newtable(L);
 
@@ -268,7 +789,7 @@ int wadfab_get_sector(lua_State *L) {
     lua_setfield(L, -2, "light");
 
     // if we have 3D floors here, do not send the tag
-    if (SEC->num_floors == 0) {
+    if (!SEC->has_3d_floors) {
         lua_pushinteger(L, SEC->tag);
         lua_setfield(L, -2, "tag");
     }
@@ -285,11 +806,11 @@ int wadfab_get_sector(lua_State *L) {
 int wadfab_get_side(lua_State *L) {
     int index = luaL_checkinteger(L, 1);
 
-    if (index < 0 || index >= ajpoly::num_sidedefs) {
+    if (!cur_fab || index < 0 || index >= (int)cur_fab->sides.size()) {
         return 0;
     }
 
-    const ajpoly::sidedef_c *SD = ajpoly::Sidedef(index);
+    const fab_side_t *SD = &cur_fab->sides[index];
 
     lua_newtable(L);
 
@@ -299,8 +820,8 @@ int wadfab_get_side(lua_State *L) {
     lua_pushinteger(L, SD->y_offset);
     lua_setfield(L, -2, "y_offset");
 
-    if (SD->sector) {
-        lua_pushinteger(L, SD->sector->index);
+    if (SD->sector >= 0) {
+        lua_pushinteger(L, SD->sector);
         lua_setfield(L, -2, "sector");
     }
 
@@ -319,36 +840,28 @@ int wadfab_get_side(lua_State *L) {
     return 1;
 }
 
-int wadfab_get_line(lua_State *L) {
-    int index = luaL_checkinteger(L, 1);
-
-    if (index < 0 || index >= ajpoly::num_linedefs) {
-        return 0;
-    }
-
-    const ajpoly::linedef_c *LD = ajpoly::Linedef(index);
-
+static void push_line_common(lua_State *L, const fab_line_t *LD) {
     lua_newtable(L);
 
-    lua_pushinteger(L, LD->start->x);
+    lua_pushinteger(L, LD->x1);
     lua_setfield(L, -2, "x1");
 
-    lua_pushinteger(L, LD->start->y);
+    lua_pushinteger(L, LD->y1);
     lua_setfield(L, -2, "y1");
 
-    lua_pushinteger(L, LD->end->x);
+    lua_pushinteger(L, LD->x2);
     lua_setfield(L, -2, "x2");
 
-    lua_pushinteger(L, LD->end->y);
+    lua_pushinteger(L, LD->y2);
     lua_setfield(L, -2, "y2");
 
-    if (LD->right) {
-        lua_pushinteger(L, LD->right->index);
+    if (LD->right >= 0) {
+        lua_pushinteger(L, LD->right);
         lua_setfield(L, -2, "right");
     }
 
-    if (LD->left) {
-        lua_pushinteger(L, LD->left->index);
+    if (LD->left >= 0) {
+        lua_pushinteger(L, LD->left);
         lua_setfield(L, -2, "left");
     }
 
@@ -357,51 +870,35 @@ int wadfab_get_line(lua_State *L) {
 
     lua_pushinteger(L, LD->flags);
     lua_setfield(L, -2, "flags");
-
-    lua_pushinteger(L, LD->tag);
-    lua_setfield(L, -2, "tag");
-
-    return 1;
 }
 
-int wadfab_get_line_hexen(lua_State *L) {
+int wadfab_get_line(lua_State *L) {
     int index = luaL_checkinteger(L, 1);
 
-    if (index < 0 || index >= ajpoly::num_linedefs) {
+    if (!cur_fab || index < 0 || index >= (int)cur_fab->lines.size()) {
         return 0;
     }
 
-    const ajpoly::linedef_c *LD = ajpoly::Linedef(index);
-
-    lua_newtable(L);
-
-    lua_pushinteger(L, LD->start->x);
-    lua_setfield(L, -2, "x1");
+    const fab_line_t *LD = &cur_fab->lines[index];
 
-    lua_pushinteger(L, LD->start->y);
-    lua_setfield(L, -2, "y1");
+    push_line_common(L, LD);
 
-    lua_pushinteger(L, LD->end->x);
-    lua_setfield(L, -2, "x2");
+    lua_pushinteger(L, LD->tag);
+    lua_setfield(L, -2, "tag");
 
-    lua_pushinteger(L, LD->end->y);
-    lua_setfield(L, -2, "y2");
+    return 1;
+}
 
-    if (LD->right) {
-        lua_pushinteger(L, LD->right->index);
-        lua_setfield(L, -2, "right");
-    }
+int wadfab_get_line_hexen(lua_State *L) {
+    int index = luaL_checkinteger(L, 1);
 
-    if (LD->left) {
-        lua_pushinteger(L, LD->left->index);
-        lua_setfield(L, -2, "left");
+    if (!cur_fab || index < 0 || index >= (int)cur_fab->lines.size()) {
+        return 0;
     }
 
-    lua_pushinteger(L, LD->special);
-    lua_setfield(L, -2, "special");
+    const fab_line_t *LD = &cur_fab->lines[index];
 
-    lua_pushinteger(L, LD->flags);
-    lua_setfield(L, -2, "flags");
+    push_line_common(L, LD);
 
     lua_pushinteger(L, LD->args[0]);
     lua_setfield(L, -2, "arg1");
@@ -421,49 +918,24 @@ int wadfab_get_line_hexen(lua_State *L) {
     return 1;
 }
 
-static double calc_along_dist(const ajpoly::edge_c *E) {
-    const ajpoly::linedef_c *LD = E->linedef;
-
-    SYS_ASSERT(LD);
-
-    double ref_x = (E->side == 1) ? LD->start->x : LD->end->x;
-    double ref_y = (E->side == 1) ? LD->start->y : LD->end->y;
-
-    double dx = ref_x - E->end->x;
-    double dy = ref_y - E->end->y;
-
-    return hypot(dx, dy);
-}
-
-static void push_edge(lua_State *L, int tab_index, const ajpoly::edge_c *E) {
+static void push_edge(lua_State *L, int tab_index, const fab_edge_t *E) {
     lua_newtable(L);
 
-    // using 'end' coord since edges face outwards
-
-    lua_pushnumber(L, E->end->x);
+    lua_pushnumber(L, E->x);
     lua_setfield(L, -2, "x");
 
-    lua_pushnumber(L, E->end->y);
+    lua_pushnumber(L, E->y);
     lua_setfield(L, -2, "y");
 
-    if (E->linedef) {
-        lua_pushinteger(L, E->linedef->index);
+    if (E->line >= 0) {
+        lua_pushinteger(L, E->line);
         lua_setfield(L, -2, "line");
 
-        lua_pushnumber(L, calc_along_dist(E));
+        lua_pushnumber(L, E->along);
         lua_setfield(L, -2, "along");
 
-        const ajpoly::sidedef_c *SD;
-
-        // we want the "outer" sidedef (the opposite side)
-        if (E->side == 0) {
-            SD = E->linedef->left;
-        } else {
-            SD = E->linedef->right;
-        }
-
-        if (SD) {
-            lua_pushinteger(L, SD->index);
+        if (E->side >= 0) {
+            lua_pushinteger(L, E->side);
             lua_setfield(L, -2, "side");
         }
     }
@@ -474,37 +946,21 @@ static void push_edge(lua_State *L, int tab_index, const ajpoly::edge_c *E) {
 int wadfab_get_polygon(lua_State *L) {
     int index = luaL_checkinteger(L, 1);
 
-    if (index < 0 || index >= ajpoly::num_polygons) {
+    if (!cur_fab || index < 0 || index >= (int)cur_fab->polygons.size()) {
         return 0;
     }
 
-    const ajpoly::polygon_c *poly = ajpoly::Polygon(index);
+    const fab_polygon_t *poly = &cur_fab->polygons[index];
 
     // result #1 : SECTOR
-    int sect_id = poly->sector ? poly->sector->index : -1;
-
-    if (sect_id == VOID_SECTOR_IDX) {
-        sect_id = -1;
-    }
-
-    lua_pushinteger(L, sect_id);
+    lua_pushinteger(L, poly->sector);
 
     // result #2 : COORDS
-    std::vector<ajpoly::edge_c *> edges;
-
-    for (ajpoly::edge_c *E = poly->edge_list; E; E = E->next) {
-        edges.push_back(E);
-    }
+    // [ edges were already put in anti-clockwise order by Snapshot_Prefab ]
+    lua_createtable(L, poly->num_edges, 0);
 
-    int edge_num = (int)edges.size();
-
-    lua_createtable(L, edge_num, 0);
-
-    for (int tab_index = 1; tab_index <= edge_num; tab_index++) {
-        // the polygon edges are clockwise, but OBLIGE are anti-clockwise.
-        // hence reverse the order.  We also use 'end' instead of 'start'.
-
-        push_edge(L, tab_index, edges[edge_num - tab_index]);
+    for (int k = 0; k < poly->num_edges; k++) {
+        push_edge(L, k + 1, &cur_fab->edges[poly->edge_start + k]);
     }
 
     return 2;
@@ -514,66 +970,61 @@ int wadfab_get_3d_floor(lua_State *L) {
     int poly_idx = luaL_checkinteger(L, 1);
     int floor_idx = luaL_checkinteger(L, 2);
 
-    if (poly_idx < 0 || poly_idx >= ajpoly::num_polygons) {
+    if (!cur_fab || poly_idx < 0 ||
+        poly_idx >= (int)cur_fab->polygons.size()) {
         return 0;
     }
 
-    const ajpoly::polygon_c *poly = ajpoly::Polygon(poly_idx);
+    int sect_id = cur_fab->polygons[poly_idx].sector;
 
-    if (!poly->sector || poly->sector->num_floors <= 0) {
+    if (sect_id < 0 || sect_id >= (int)cur_fab->sectors.size()) {
         return 0;
     }
 
-    // determine line and dummy sector
-
-    const ajpoly::linedef_c *LD = poly->sector->getExtraFloor(floor_idx);
+    const fab_sector_t *S = &cur_fab->sectors[sect_id];
 
-    if (!LD) {
+    if (floor_idx < 0 || floor_idx >= S->num_floors) {
         return 0;
     }
 
-    const ajpoly::sector_c *SEC = LD->right->sector;
-
-    if (!SEC) {
-        return 0;
-    }
+    const fab_3d_floor_t *F = &cur_fab->floors[S->floor_start + floor_idx];
 
     // save the information
 
     lua_newtable(L);
 
     // BOTTOM
-    lua_pushinteger(L, SEC->floor_h);
+    lua_pushinteger(L, F->bottom_h);
     lua_setfield(L, -2, "bottom_h");
 
-    lua_pushstring(L, SEC->floor_tex.data());
+    lua_pushstring(L, F->bottom_tex.data());
     lua_setfield(L, -2, "bottom_tex");
 
     // TOP
-    lua_pushinteger(L, SEC->ceil_h);
+    lua_pushinteger(L, F->top_h);
     lua_setfield(L, -2, "top_h");
 
-    lua_pushstring(L, SEC->ceil_tex.data());
+    lua_pushstring(L, F->top_tex.data());
     lua_setfield(L, -2, "top_tex");
 
     // SIDE
-    lua_pushstring(L, LD->right->mid_tex.data());
+    lua_pushstring(L, F->side_tex.data());
     lua_setfield(L, -2, "side_tex");
 
-    lua_pushinteger(L, LD->right->x_offset);
+    lua_pushinteger(L, F->x_offset);
     lua_setfield(L, -2, "x_offset");
 
-    lua_pushinteger(L, LD->right->y_offset);
+    lua_pushinteger(L, F->y_offset);
     lua_setfield(L, -2, "y_offset");
 
     // PROPERTIES
-    lua_pushinteger(L, SEC->special);
+    lua_pushinteger(L, F->special);
     lua_setfield(L, -2, "special");
 
-    lua_pushinteger(L, SEC->light);
+    lua_pushinteger(L, F->light);
     lua_setfield(L, -2, "light");
 
-    if (LD->special == 405) {
+    if (F->liquid) {
         lua_pushinteger(L, 1);
         lua_setfield(L, -2, "liquid");
     }
@@ -22,6 +22,13 @@
 #ifndef __OBLIGE_DM_PREFAB_H__
 #define __OBLIGE_DM_PREFAB_H__
 
+// when set, polygonated prefabs are saved to a cache file in the
+// config directory and reused by later runs.
+extern bool prefab_cache;
+
+// log the cache statistics and save the cache file (if needed)
+void Prefab_CloseCache();
+
 #endif /* __OBLIGE_DM_PREFAB_H__ */
 
 //--- editor settings ---
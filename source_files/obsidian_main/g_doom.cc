@@ -23,7 +23,9 @@
 
 #include "headers.h"
 
-#include <bitset>
+#include <climits>
+#include <fstream>
+#include <memory>
 #include <string>
 
 #ifndef CONSOLE_ONLY
@@ -32,10 +34,10 @@
 #include "lib_file.h"
 #include "lib_util.h"
 #include "lib_wad.h"
+#include "lib_zip.h"
 #include "m_cookie.h"
 #include "m_lua.h"
 #include "main.h"
-#include "miniz.h"
 #include "q_common.h"  // qLump_c
 #include "sys_xoshiro.h"
 
@@ -67,7 +69,6 @@ static qLump_c *vertex_lump;
 static qLump_c *sector_lump;
 static qLump_c *sidedef_lump;
 static qLump_c *linedef_lump;
-static qLump_c *textmap_lump;
 static qLump_c *endmap_lump;
 
 static int errors_seen;
@@ -79,11 +80,10 @@ bool build_reject;
 
 static bool UDMF_mode;
 
-int udmf_vertexes;
-int udmf_sectors;
-int udmf_linedefs;
-int udmf_things;
-int udmf_sidedefs;
+// the level being built in UDMF mode, and the finished ones which are
+// waiting for the node builder
+static Doom::udmf_level_t *udmf_level;
+static std::vector<std::unique_ptr<Doom::udmf_level_t>> udmf_levels;
 
 enum wad_section_e {
     SECTION_Patches = 0,
@@ -127,6 +127,10 @@ std::array<byte, 128> empty_korax_behavior = {
 //  WAD OUTPUT
 //------------------------------------------------------------------------
 
+// the whole WAD is built in memory, and only hits the disk once, when
+// the final WAD (with nodes) or PK3 is written in Finish().
+static std::vector<u8_t> wad_image;
+
 namespace Doom {
 void WriteLump(std::string_view name, const void *data, u32_t len) {
     SYS_ASSERT(name.size() <= 8);
@@ -226,20 +230,15 @@ void Doom::AddSectionLump(char ch, std::string name, qLump_c *lump) {
     sections[k]->push_back(lump);
 }
 
-bool Doom::StartWAD(std::filesystem::path filename) {
-    if (!WAD_OpenWrite(filename)) {
-#ifndef CONSOLE_ONLY
-        DLG_ShowError(_("Unable to create wad file:\n\n%s"), strerror(errno));
-#else
-        fmt::print(_("Unable to create wad file:\n\n%s"), strerror(errno));
-#endif
-        return false;
-    }
+bool Doom::StartWAD() {
+    WAD_OpenWriteMem(&wad_image);
 
     errors_seen = 0;
 
     ClearSections();
 
+    udmf_levels.clear();
+
     qLump_c *info = BSP_CreateInfoLump();
     WriteLump("OBSIDATA", info);
     delete info;
@@ -256,6 +255,300 @@ bool Doom::EndWAD() {
     return errors_seen == 0;
 }
 
+//------------------------------------------------------------------------
+//  UDMF OUTPUT
+//------------------------------------------------------------------------
+
+namespace Doom {
+static void VisitVertex(const udmf_vertex_t &V, udmf_fields_c &out) {
+    out.Block("vertex");
+    out.FloatField("x", V.x);
+    out.FloatField("y", V.y);
+    out.EndBlock();
+}
+
+static void VisitSector(const udmf_sector_t &S, udmf_fields_c &out) {
+    out.Block("sector");
+    out.IntField("heightfloor", S.floor_h);
+    out.IntField("heightceiling", S.ceil_h);
+    out.StringField("texturefloor", S.floor_tex);
+    out.StringField("textureceiling", S.ceil_tex);
+    out.IntField("lightlevel", S.light);
+    out.IntField("special", S.special);
+    out.IntField("id", S.tag);
+    out.EndBlock();
+}
+
+static void VisitSidedef(const udmf_sidedef_t &SD, udmf_fields_c &out) {
+    out.Block("sidedef");
+    out.IntField("offsetx", SD.x_offset);
+    out.IntField("offsety", SD.y_offset);
+    out.StringField("texturetop", SD.upper_tex);
+    out.StringField("texturemiddle", SD.mid_tex);
+    out.StringField("texturebottom", SD.lower_tex);
+    out.IntField("sector", SD.sector);
+    out.EndBlock();
+}
+
+static void VisitLinedef(const udmf_linedef_t &L, int format,
+                         udmf_fields_c &out) {
+    out.Block("linedef");
+
+    if (format != SUBFMT_Hexen) {
+        out.IntField("id", L.tag);
+    } else if (L.type == 121) {
+        out.IntField("id", L.args[0]);
+    }
+
+    out.IntField("v1", L.start);
+    out.IntField("v2", L.end);
+    out.IntField("sidefront", L.side1);
+    out.IntField("sideback", L.side2);
+
+    if (format != SUBFMT_Hexen) {
+        out.IntField("arg0", L.tag);
+        out.IntField("special", L.type);
+    } else {
+        // Line_SetIdentification only sets the line id (done above)
+        if (L.type == 121) {
+            out.IntField("special", 0);
+            out.IntField("arg0", 0);
+        } else {
+            out.IntField("special", L.type);
+            out.IntField("arg0", L.args[0]);
+        }
+        out.IntField("arg1", L.args[1]);
+        out.IntField("arg2", L.args[2]);
+        out.IntField("arg3", L.args[3]);
+        out.IntField("arg4", L.args[4]);
+    }
+
+    static const char *const flag_names[10] = {
+        "blocking",      "blockmonsters", "twosided",   "dontpegtop",
+        "dontpegbottom", "secret",        "blocksound", "dontdraw",
+        "mapped",        "passuse"};
+
+    for (int i = 0; i < 10; i++) {
+        if (L.flags & (1 << i)) {
+            const char *name = flag_names[i];
+
+            if (i == 9 && format == SUBFMT_Hexen) {
+                name = "repeatspecial";
+            }
+
+            out.BoolField(name, true);
+        }
+    }
+
+    if (format == SUBFMT_Hexen && L.type > 0) {
+        static const char *const spac_names[6] = {
+            "playercross", "playeruse",  "monstercross",
+            "impact",      "playerpush", "missilecross"};
+
+        int spac = (L.flags & 0x1C00) >> 10;
+
+        if (spac < 6) {
+            out.BoolField(spac_names[spac], true);
+        }
+    }
+
+    out.EndBlock();
+}
+
+static void VisitThing(const udmf_thing_t &T, int format,
+                       udmf_fields_c &out) {
+    out.Block("thing");
+
+    if (format == SUBFMT_Hexen) {
+        out.IntField("id", T.tid);
+    }
+
+    out.FloatField("x", T.x);
+    out.FloatField("y", T.y);
+
+    if (format == SUBFMT_Hexen) {
+        out.FloatField("height", T.height);
+    }
+
+    out.IntField("type", T.type);
+    out.IntField("angle", T.angle);
+
+    if (T.options & MTF_Easy) {
+        out.BoolField("skill1", true);
+        out.BoolField("skill2", true);
+    }
+    if (T.options & MTF_Medium) {
+        out.BoolField("skill3", true);
+    }
+    if (T.options & MTF_Hard) {
+        out.BoolField("skill4", true);
+        out.BoolField("skill5", true);
+    }
+    if (T.options & MTF_Ambush) {
+        out.BoolField("ambush", true);
+    }
+
+    if (format != SUBFMT_Hexen) {
+        out.BoolField("single", (T.options & MTF_NotSP) == 0);
+        out.BoolField("dm", (T.options & MTF_NotDM) == 0);
+        out.BoolField("coop", (T.options & MTF_NotCOOP) == 0);
+
+        if (T.options & MTF_Friend) {
+            out.BoolField("friend", true);
+        }
+
+        // Testing fix for compatibility with ZDoom mods that add classes in
+        // games other than Hexen
+        out.BoolField("class1", true);
+        out.BoolField("class2", true);
+        out.BoolField("class3", true);
+    } else {
+        static const char *const flag_names[7] = {
+            "dormant", "class1", "class2", "class3", "single", "coop", "dm"};
+
+        for (int i = 0; i < 7; i++) {
+            if (T.options & (16 << i)) {
+                out.BoolField(flag_names[i], true);
+            }
+        }
+
+        out.IntField("special", T.special);
+
+        if (T.has_args) {
+            out.IntField("arg0", T.args[0]);
+            out.IntField("arg1", T.args[1]);
+            out.IntField("arg2", T.args[2]);
+            out.IntField("arg3", T.args[3]);
+            out.IntField("arg4", T.args[4]);
+        }
+    }
+
+    out.EndBlock();
+}
+}  // namespace Doom
+
+void Doom::UDMF_Visit(const udmf_level_t &level, udmf_fields_c &out) {
+    if (level.sub_format == SUBFMT_Hexen) {
+        out.StringField("namespace", "Hexen");
+    } else {
+        out.StringField("namespace", "ZDoomTranslated");
+
+        if (level.ee_compat) {
+            out.BoolField("ee_compat", true);
+        }
+    }
+
+    // same order as ZDBSP writes them
+    for (const udmf_thing_t &T : level.things) {
+        VisitThing(T, level.sub_format, out);
+    }
+    for (const udmf_vertex_t &V : level.vertices) {
+        VisitVertex(V, out);
+    }
+    for (const udmf_linedef_t &L : level.linedefs) {
+        VisitLinedef(L, level.sub_format, out);
+    }
+    for (const udmf_sidedef_t &SD : level.sidedefs) {
+        VisitSidedef(SD, out);
+    }
+    for (const udmf_sector_t &S : level.sectors) {
+        VisitSector(S, out);
+    }
+}
+
+const Doom::udmf_level_t *Doom::UDMF_FindLevel(std::string_view name) {
+    for (const auto &level : udmf_levels) {
+        if (StringCaseCmp(level->name, name) == 0) {
+            return level.get();
+        }
+    }
+
+    return NULL;
+}
+
+namespace Doom {
+class udmf_text_c : public udmf_fields_c {
+    // formats the TEXTMAP lump.  Uses fmt since it does not depend on
+    // the locale, and appends to a buffer which is re-used for every
+    // level.
+
+   private:
+    std::string &buf;
+
+    bool in_block;
+
+   public:
+    explicit udmf_text_c(std::string &_buf) : buf(_buf), in_block(false) {}
+
+    virtual ~udmf_text_c() {}
+
+    void Block(const char *kind) {
+        fmt::format_to(std::back_inserter(buf), "\n{}\n{{\n", kind);
+        in_block = true;
+    }
+
+    void EndBlock() {
+        buf += "}\n";
+        in_block = false;
+    }
+
+    void IntField(const char *key, int value) {
+        Key(key);
+        fmt::format_int str(value);
+        buf.append(str.data(), str.size());
+        End();
+    }
+
+    void FloatField(const char *key, double value) {
+        Key(key);
+        fmt::format_to(std::back_inserter(buf), "{:f}", value);
+        End();
+    }
+
+    void BoolField(const char *key, bool value) {
+        Key(key);
+        buf += value ? "true" : "false";
+        End();
+    }
+
+    void StringField(const char *key, const std::string &value) {
+        Key(key);
+        buf += '"';
+        buf += value;
+        buf += '"';
+        End();
+    }
+
+   private:
+    void Key(const char *key) {
+        if (in_block) {
+            buf += '\t';
+        }
+        buf += key;
+        buf += " = ";
+    }
+
+    void End() { buf += in_block ? ";\n" : ";\n\n"; }
+};
+
+static void WriteTextMap(const udmf_level_t &level) {
+    static std::string buf;
+
+    buf.clear();
+
+    // rough size of each block, saves growing the buffer
+    buf.reserve(64 + level.vertices.size() * 48 + level.sectors.size() * 180 +
+                level.sidedefs.size() * 150 + level.linedefs.size() * 200 +
+                level.things.size() * 280);
+
+    udmf_text_c text(buf);
+
+    UDMF_Visit(level, text);
+
+    WriteLump("TEXTMAP", buf.data(), (u32_t)buf.size());
+}
+}  // namespace Doom
+
 namespace Doom {
 static void FreeLumps() {
     delete header_lump;
@@ -272,8 +565,8 @@ static void FreeLumps() {
         delete linedef_lump;
         linedef_lump = nullptr;
     } else {
-        delete textmap_lump;
-        textmap_lump = nullptr;
+        delete udmf_level;
+        udmf_level = nullptr;
         delete endmap_lump;
         endmap_lump = nullptr;
     }
@@ -291,15 +584,10 @@ void Doom::BeginLevel() {
         linedef_lump = new qLump_c();
         sidedef_lump = new qLump_c();
     } else {
-        textmap_lump = new qLump_c();
-        if (sub_format == SUBFMT_Hexen) {
-            textmap_lump->Printf("namespace = \"Hexen\";\n\n");
-        } else {
-            textmap_lump->Printf("namespace = \"ZDoomTranslated\";\n\n");
-            if (current_port == "eternity") {
-                textmap_lump->Printf("ee_compat = true;\n\n");
-            }
-        }
+        udmf_level = new udmf_level_t();
+        udmf_level->sub_format = sub_format;
+        udmf_level->ee_compat =
+            (sub_format != SUBFMT_Hexen && current_port == "eternity");
         endmap_lump = new qLump_c();
     }
 }
@@ -319,7 +607,15 @@ void Doom::EndLevel(std::string_view level_name) {
     WriteLump(level_name, header_lump);
 
     if (UDMF_mode) {
-        WriteLump("TEXTMAP", textmap_lump);
+        udmf_level->name = level_name;
+
+        WriteTextMap(*udmf_level);
+
+        // keep the objects for ZDBSP, saves it parsing the TEXTMAP
+        if (build_nodes) {
+            udmf_levels.emplace_back(udmf_level);
+            udmf_level = nullptr;
+        }
     }
 
     if (not UDMF_mode) {
@@ -380,11 +676,7 @@ void Doom::AddVertex(int x, int y) {
         vert.y = LE_S16(y);
         vertex_lump->Append(&vert, sizeof(vert));
     } else {
-        textmap_lump->Printf("\nvertex\n{\n");
-        textmap_lump->Printf("\tx = %f;\n", (double)x);
-        textmap_lump->Printf("\ty = %f;\n", (double)y);
-        textmap_lump->Printf("}\n");
-        udmf_vertexes += 1;
+        udmf_level->vertices.push_back(udmf_vertex_t{x, y});
     }
 }
 
@@ -411,16 +703,8 @@ void Doom::AddSector(int f_h, std::string f_tex, int c_h, std::string c_tex,
         sec.tag = LE_S16(tag);
         sector_lump->Append(&sec, sizeof(sec));
     } else {
-        textmap_lump->Printf("\nsector\n{\n");
-        textmap_lump->Printf("\theightfloor = %d;\n", f_h);
-        textmap_lump->Printf("\theightceiling = %d;\n", c_h);
-        textmap_lump->Printf("\ttexturefloor = \"%s\";\n", f_tex.c_str());
-        textmap_lump->Printf("\ttextureceiling = \"%s\";\n", c_tex.c_str());
-        textmap_lump->Printf("\tlightlevel = %d;\n", light);
-        textmap_lump->Printf("\tspecial = %d;\n", special);
-        textmap_lump->Printf("\tid = %d;\n", tag);
-        textmap_lump->Printf("}\n");
-        udmf_sectors += 1;
+        udmf_level->sectors.push_back(
+            udmf_sector_t{f_h, c_h, f_tex, c_tex, light, special, tag});
     }
 }
 
@@ -451,15 +735,8 @@ void Doom::AddSidedef(int sector, std::string l_tex, std::string m_tex,
         side.y_offset = LE_S16(y_offset);
         sidedef_lump->Append(&side, sizeof(side));
     } else {
-        textmap_lump->Printf("\nsidedef\n{\n");
-        textmap_lump->Printf("\toffsetx = %d;\n", x_offset);
-        textmap_lump->Printf("\toffsety = %d;\n", y_offset);
-        textmap_lump->Printf("\ttexturetop = \"%s\";\n", u_tex.c_str());
-        textmap_lump->Printf("\ttexturemiddle = \"%s\";\n", m_tex.c_str());
-        textmap_lump->Printf("\ttexturebottom = \"%s\";\n", l_tex.c_str());
-        textmap_lump->Printf("\tsector = %d;\n", sector);
-        textmap_lump->Printf("}\n");
-        udmf_sidedefs += 1;
+        udmf_level->sidedefs.push_back(udmf_sidedef_t{
+            sector, l_tex, m_tex, u_tex, x_offset, y_offset});
     }
 }
 
@@ -476,162 +753,65 @@ int Doom::v094_add_sidedef(lua_State *L) {
 
 void Doom::AddLinedef(int vert1, int vert2, int side1, int side2, int type,
                       int flags, int tag, const byte *args) {
-    if (sub_format != SUBFMT_Hexen) {
-        if (not UDMF_mode) {
-            raw_linedef_t line;
+    if (UDMF_mode) {
+        udmf_linedef_t line;
 
-            line.start = LE_U16(vert1);
-            line.end = LE_U16(vert2);
+        line.start = vert1;
+        line.end = vert2;
 
-            line.sidedef1 = side1 < 0 ? 0xFFFF : LE_U16(side1);
-            line.sidedef2 = side2 < 0 ? 0xFFFF : LE_U16(side2);
+        line.side1 = side1 < 0 ? -1 : side1;
+        line.side2 = side2 < 0 ? -1 : side2;
 
-            line.type = LE_U16(type);
-            line.flags = LE_U16(flags);
-            line.tag = LE_U16(tag);
-            linedef_lump->Append(&line, sizeof(line));
-        } else {
-            textmap_lump->Printf("\nlinedef\n{\n");
-            textmap_lump->Printf("\tid = %d;\n", tag);
-            textmap_lump->Printf("\tv1 = %d;\n", vert1);
-            textmap_lump->Printf("\tv2 = %d;\n", vert2);
-            textmap_lump->Printf("\tsidefront = %d;\n", side1 < 0 ? -1 : side1);
-            textmap_lump->Printf("\tsideback = %d;\n", side2 < 0 ? -1 : side2);
-            textmap_lump->Printf("\targ0 = %d;\n", tag);
-            textmap_lump->Printf("\tspecial = %d;\n", type);
-            std::bitset<16> udmf_flags(flags);
-            if (udmf_flags.test(0)) {
-                textmap_lump->Printf("\tblocking = true;\n");
-            }
-            if (udmf_flags.test(1)) {
-                textmap_lump->Printf("\tblockmonsters = true;\n");
-            }
-            if (udmf_flags.test(2)) {
-                textmap_lump->Printf("\ttwosided = true;\n");
-            }
-            if (udmf_flags.test(3)) {
-                textmap_lump->Printf("\tdontpegtop = true;\n");
-            }
-            if (udmf_flags.test(4)) {
-                textmap_lump->Printf("\tdontpegbottom = true;\n");
-            }
-            if (udmf_flags.test(5)) {
-                textmap_lump->Printf("\tsecret = true;\n");
-            }
-            if (udmf_flags.test(6)) {
-                textmap_lump->Printf("\tblocksound = true;\n");
-            }
-            if (udmf_flags.test(7)) {
-                textmap_lump->Printf("\tdontdraw = true;\n");
-            }
-            if (udmf_flags.test(8)) {
-                textmap_lump->Printf("\tmapped = true;\n");
-            }
-            if (udmf_flags.test(9)) {
-                textmap_lump->Printf("\tpassuse = true;\n");
-            }
-            textmap_lump->Printf("}\n");
-            udmf_linedefs += 1;
+        line.type = type;
+        line.flags = flags;
+        line.tag = tag;
+
+        line.args.fill(0);
+
+        if (args) {
+            std::copy(args, args + 5, line.args.data());
         }
+
+        udmf_level->linedefs.push_back(line);
+        return;
+    }
+
+    if (sub_format != SUBFMT_Hexen) {
+        raw_linedef_t line;
+
+        line.start = LE_U16(vert1);
+        line.end = LE_U16(vert2);
+
+        line.sidedef1 = side1 < 0 ? 0xFFFF : LE_U16(side1);
+        line.sidedef2 = side2 < 0 ? 0xFFFF : LE_U16(side2);
+
+        line.type = LE_U16(type);
+        line.flags = LE_U16(flags);
+        line.tag = LE_U16(tag);
+        linedef_lump->Append(&line, sizeof(line));
     } else  // Hexen format
     {
-        if (not UDMF_mode) {
-            raw_hexen_linedef_t line;
-
-            // clear unused fields (esp. arguments)
-            memset(&line, 0, sizeof(line));
+        raw_hexen_linedef_t line;
 
-            line.start = LE_U16(vert1);
-            line.end = LE_U16(vert2);
+        // clear unused fields (esp. arguments)
+        memset(&line, 0, sizeof(line));
 
-            line.sidedef1 = side1 < 0 ? 0xffff : LE_U16(side1);
-            line.sidedef2 = side2 < 0 ? 0xffff : LE_U16(side2);
+        line.start = LE_U16(vert1);
+        line.end = LE_U16(vert2);
 
-            line.special = type;  // 8 bits
-            line.flags = LE_U16(flags);
+        line.sidedef1 = side1 < 0 ? 0xffff : LE_U16(side1);
+        line.sidedef2 = side2 < 0 ? 0xffff : LE_U16(side2);
 
-            // tag value is UNUSED
+        line.special = type;  // 8 bits
+        line.flags = LE_U16(flags);
 
-            if (args) {
-                std::copy(args, args + 5, line.args.data());
-            }
+        // tag value is UNUSED
 
-            linedef_lump->Append(&line, sizeof(line));
-        } else {
-            textmap_lump->Printf("\nlinedef\n{\n");
-            if (type == 121) {
-                textmap_lump->Printf("\tid = %d;\n", args[0]);
-            }
-            textmap_lump->Printf("\tv1 = %d;\n", vert1);
-            textmap_lump->Printf("\tv2 = %d;\n", vert2);
-            textmap_lump->Printf("\tsidefront = %d;\n", side1 < 0 ? -1 : side1);
-            textmap_lump->Printf("\tsideback = %d;\n", side2 < 0 ? -1 : side2);
-            if (type == 121) {
-                textmap_lump->Printf("\tspecial = 0;\n");
-                textmap_lump->Printf("\targ0 = 0;\n");
-            } else {
-                textmap_lump->Printf("\tspecial = %d;\n", type);
-                textmap_lump->Printf("\targ0 = %d;\n", args[0]);
-            }
-            textmap_lump->Printf("\targ1 = %d;\n", args[1]);
-            textmap_lump->Printf("\targ2 = %d;\n", args[2]);
-            textmap_lump->Printf("\targ3 = %d;\n", args[3]);
-            textmap_lump->Printf("\targ4 = %d;\n", args[4]);
-            std::bitset<16> udmf_flags(flags);
-            if (udmf_flags.test(0)) {
-                textmap_lump->Printf("\tblocking = true;\n");
-            }
-            if (udmf_flags.test(1)) {
-                textmap_lump->Printf("\tblockmonsters = true;\n");
-            }
-            if (udmf_flags.test(2)) {
-                textmap_lump->Printf("\ttwosided = true;\n");
-            }
-            if (udmf_flags.test(3)) {
-                textmap_lump->Printf("\tdontpegtop = true;\n");
-            }
-            if (udmf_flags.test(4)) {
-                textmap_lump->Printf("\tdontpegbottom = true;\n");
-            }
-            if (udmf_flags.test(5)) {
-                textmap_lump->Printf("\tsecret = true;\n");
-            }
-            if (udmf_flags.test(6)) {
-                textmap_lump->Printf("\tblocksound = true;\n");
-            }
-            if (udmf_flags.test(7)) {
-                textmap_lump->Printf("\tdontdraw = true;\n");
-            }
-            if (udmf_flags.test(8)) {
-                textmap_lump->Printf("\tmapped = true;\n");
-            }
-            if (udmf_flags.test(9)) {
-                textmap_lump->Printf("\trepeatspecial = true;\n");
-            }
-            int spac = (flags & 0x1C00) >> 10;
-            if (type > 0) {
-                if (spac == 0) {
-                    textmap_lump->Printf("\tplayercross = true;\n");
-                }
-                if (spac == 1) {
-                    textmap_lump->Printf("\tplayeruse = true;\n");
-                }
-                if (spac == 2) {
-                    textmap_lump->Printf("\tmonstercross = true;\n");
-                }
-                if (spac == 3) {
-                    textmap_lump->Printf("\timpact = true;\n");
-                }
-                if (spac == 4) {
-                    textmap_lump->Printf("\tplayerpush = true;\n");
-                }
-                if (spac == 5) {
-                    textmap_lump->Printf("\tmissilecross = true;\n");
-                }
-            }
-            textmap_lump->Printf("}\n");
-            udmf_linedefs += 1;
+        if (args) {
+            std::copy(args, args + 5, line.args.data());
         }
+
+        linedef_lump->Append(&line, sizeof(line));
     }
 }
 
@@ -684,151 +864,68 @@ void Doom::AddThing(int x, int y, int h, int type, int angle, int options,
         y += 32;
     }
 
-    if (sub_format != SUBFMT_Hexen) {
-        if (not UDMF_mode) {
-            raw_thing_t thing;
+    if (sub_format == SUBFMT_Hexen && ob_hexen_ceiling_check(type)) {
+        h = 0;
+    }
 
-            thing.x = LE_S16(x);
-            thing.y = LE_S16(y);
+    if (UDMF_mode) {
+        udmf_thing_t thing;
 
-            thing.type = LE_U16(type);
-            thing.angle = LE_S16(angle);
-            thing.options = LE_U16(options);
-            thing_lump->Append(&thing, sizeof(thing));
-        } else {
-            textmap_lump->Printf("\nthing\n{\n");
-            textmap_lump->Printf("\tx = %f;\n", (double)x);
-            textmap_lump->Printf("\ty = %f;\n", (double)y);
-            textmap_lump->Printf("\ttype = %d;\n", type);
-            textmap_lump->Printf("\tangle = %d;\n", angle);
-            std::bitset<16> udmf_flags(options);
-            if (udmf_flags.test(0)) {
-                textmap_lump->Printf("\tskill1 = true;\n");
-                textmap_lump->Printf("\tskill2 = true;\n");
-            }
-            if (udmf_flags.test(1)) {
-                textmap_lump->Printf("\tskill3 = true;\n");
-            }
-            if (udmf_flags.test(2)) {
-                textmap_lump->Printf("\tskill4 = true;\n");
-                textmap_lump->Printf("\tskill5 = true;\n");
-            }
-            if (udmf_flags.test(3)) {
-                textmap_lump->Printf("\tambush = true;\n");
-            }
-            if (udmf_flags.test(4)) {
-                textmap_lump->Printf("\tsingle = false;\n");
-            } else {
-                textmap_lump->Printf("\tsingle = true;\n");
-            }
-            if (udmf_flags.test(5)) {
-                textmap_lump->Printf("\tdm = false;\n");
-            } else {
-                textmap_lump->Printf("\tdm = true;\n");
-            }
-            if (udmf_flags.test(6)) {
-                textmap_lump->Printf("\tcoop = false;\n");
-            } else {
-                textmap_lump->Printf("\tcoop = true;\n");
-            }
-            if (udmf_flags.test(7)) {
-                textmap_lump->Printf("\tfriend = true;\n");
-            }
-            // Testing fix for compatibility with ZDoom mods that add classes in
-            // games other than Hexen
-            textmap_lump->Printf("\tclass1 = true;\n");
-            textmap_lump->Printf("\tclass2 = true;\n");
-            textmap_lump->Printf("\tclass3 = true;\n");
-            textmap_lump->Printf("}\n");
-            udmf_things += 1;
+        thing.x = x;
+        thing.y = y;
+        thing.height = h;
+
+        thing.type = type;
+        thing.angle = angle;
+        thing.options = options;
+
+        thing.tid = tid;
+        thing.special = special;
+
+        thing.has_args = (args != NULL);
+        thing.args.fill(0);
+
+        if (args) {
+            std::copy(args, args + 5, thing.args.data());
         }
+
+        udmf_level->things.push_back(thing);
+        return;
+    }
+
+    if (sub_format != SUBFMT_Hexen) {
+        raw_thing_t thing;
+
+        thing.x = LE_S16(x);
+        thing.y = LE_S16(y);
+
+        thing.type = LE_U16(type);
+        thing.angle = LE_S16(angle);
+        thing.options = LE_U16(options);
+        thing_lump->Append(&thing, sizeof(thing));
     } else  // Hexen format
     {
-        if (not UDMF_mode) {
-            raw_hexen_thing_t thing;
+        raw_hexen_thing_t thing;
 
-            // clear unused fields (esp. arguments)
-            memset(&thing, 0, sizeof(thing));
+        // clear unused fields (esp. arguments)
+        memset(&thing, 0, sizeof(thing));
 
-            thing.x = LE_S16(x);
-            thing.y = LE_S16(y);
-
-            if (ob_hexen_ceiling_check(type)) {
-                thing.height = 0;
-            } else {
-                thing.height = LE_S16(h);
-            }
-            thing.type = LE_U16(type);
-            thing.angle = LE_S16(angle);
-            thing.options = LE_U16(options);
+        thing.x = LE_S16(x);
+        thing.y = LE_S16(y);
 
-            thing.tid = LE_S16(tid);
-            thing.special = special;
+        thing.height = LE_S16(h);
+        thing.type = LE_U16(type);
+        thing.angle = LE_S16(angle);
+        thing.options = LE_U16(options);
 
-            if (args) {
-                std::copy(args, args + 5, thing.args.data());
-            }
+        thing.tid = LE_S16(tid);
+        thing.special = special;
 
-            thing_lump->Append(&thing, sizeof(thing));
-        } else {
-            textmap_lump->Printf("\nthing\n{\n");
-            textmap_lump->Printf("\tid = %d;\n", tid);
-            textmap_lump->Printf("\tx = %f;\n", (double)x);
-            textmap_lump->Printf("\ty = %f;\n", (double)y);
-            if (ob_hexen_ceiling_check(type)) {
-                textmap_lump->Printf("\theight = %f;\n", 0);
-            } else {
-                textmap_lump->Printf("\theight = %f;\n", (double)h);
-            }
-            textmap_lump->Printf("\ttype = %d;\n", type);
-            textmap_lump->Printf("\tangle = %d;\n", angle);
-            std::bitset<16> udmf_flags(options);
-            if (udmf_flags.test(0)) {
-                textmap_lump->Printf("\tskill1 = true;\n");
-                textmap_lump->Printf("\tskill2 = true;\n");
-            }
-            if (udmf_flags.test(1)) {
-                textmap_lump->Printf("\tskill3 = true;\n");
-            }
-            if (udmf_flags.test(2)) {
-                textmap_lump->Printf("\tskill4 = true;\n");
-                textmap_lump->Printf("\tskill5 = true;\n");
-            }
-            if (udmf_flags.test(3)) {
-                textmap_lump->Printf("\tambush = true;\n");
-            }
-            if (udmf_flags.test(4)) {
-                textmap_lump->Printf("\tdormant = true;\n");
-            }
-            if (udmf_flags.test(5)) {
-                textmap_lump->Printf("\tclass1 = true;\n");
-            }
-            if (udmf_flags.test(6)) {
-                textmap_lump->Printf("\tclass2 = true;\n");
-            }
-            if (udmf_flags.test(7)) {
-                textmap_lump->Printf("\tclass3 = true;\n");
-            }
-            if (udmf_flags.test(8)) {
-                textmap_lump->Printf("\tsingle = true;\n");
-            }
-            if (udmf_flags.test(9)) {
-                textmap_lump->Printf("\tcoop = true;\n");
-            }
-            if (udmf_flags.test(10)) {
-                textmap_lump->Printf("\tdm = true;\n");
-            }
-            textmap_lump->Printf("\tspecial = %d;\n", special);
-            if (args) {
-                textmap_lump->Printf("\targ0 = %d;\n", args[0]);
-                textmap_lump->Printf("\targ1 = %d;\n", args[1]);
-                textmap_lump->Printf("\targ2 = %d;\n", args[2]);
-                textmap_lump->Printf("\targ3 = %d;\n", args[3]);
-                textmap_lump->Printf("\targ4 = %d;\n", args[4]);
-            }
-            textmap_lump->Printf("}\n");
-            udmf_things += 1;
+        if (args) {
+            std::copy(args, args + 5, thing.args.data());
         }
+
+        thing_lump->Append(&thing, sizeof(thing));
     }
 }
 
@@ -852,21 +949,21 @@ int Doom::NumVertexes() {
     if (not UDMF_mode) {
         return vertex_lump->GetSize() / sizeof(raw_vertex_t);
     }
-    return udmf_vertexes;
+    return (int)udmf_level->vertices.size();
 }
 
 int Doom::NumSectors() {
     if (not UDMF_mode) {
         return sector_lump->GetSize() / sizeof(raw_sector_t);
     }
-    return udmf_sectors;
+    return (int)udmf_level->sectors.size();
 }
 
 int Doom::NumSidedefs() {
     if (not UDMF_mode) {
         return sidedef_lump->GetSize() / sizeof(raw_sidedef_t);
     }
-    return udmf_sidedefs;
+    return (int)udmf_level->sidedefs.size();
 }
 
 int Doom::NumLinedefs() {
@@ -877,7 +974,7 @@ int Doom::NumLinedefs() {
 
         return linedef_lump->GetSize() / sizeof(raw_linedef_t);
     }
-    return udmf_linedefs;
+    return (int)udmf_level->linedefs.size();
 }
 
 int Doom::NumThings() {
@@ -888,7 +985,7 @@ int Doom::NumThings() {
 
         return thing_lump->GetSize() / sizeof(raw_thing_t);
     }
-    return udmf_things;
+    return (int)udmf_level->things.size();
 }
 
 //----------------------------------------------------------------------------
@@ -915,13 +1012,10 @@ void Send_Prog_Step(const char *step_name) {
 #endif
 }
 
-static bool BuildNodes(std::filesystem::path filename) {
+static bool BuildNodes(const std::filesystem::path &filename,
+                       std::string *out_buffer) {
     LogPrintf("\n");
 
-    if (!build_nodes) {
-        return true;
-    }
-
     // Replace this with a Lua call at some point, maybe ob_get_param - Dasho
     int map_nums;
     std::string wadlength = ob_get_param("length");
@@ -966,8 +1060,8 @@ static bool BuildNodes(std::filesystem::path filename) {
             map_nums = 45;
         }
     }
-    if (zdmain(filename, current_port, UDMF_mode, build_reject, map_nums) !=
-        0) {
+    if (zdmain(wad_image.data(), wad_image.size(), filename, out_buffer,
+               current_port, UDMF_mode, build_reject, map_nums) != 0) {
         Main::ProgStatus(_("ZDBSP Error!"));
         return false;
     }
@@ -975,6 +1069,149 @@ static bool BuildNodes(std::filesystem::path filename) {
     return true;
 }
 
+static bool SaveFile(const std::filesystem::path &filename, const void *data,
+                     size_t length) {
+    std::ofstream out(filename, std::ios::out | std::ios::binary);
+
+    if (!out.is_open()) {
+        LogPrintf("Unable to create file: {}\n", filename.generic_string());
+        return false;
+    }
+
+    out.write(static_cast<const char *>(data), length);
+    out.close();
+
+    if (out.fail()) {
+        LogPrintf("Error writing file: {}\n", filename.generic_string());
+        return false;
+    }
+
+    LogPrintf("Wrote WAD file: {}\n", filename.generic_string());
+
+    return true;
+}
+
+static bool LoadWADImage(const std::filesystem::path &filename) {
+    // SLUMP writes its own WAD file, grab it for node building
+    std::ifstream in(filename, std::ios::in | std::ios::binary);
+
+    if (!in.is_open()) {
+        LogPrintf("Unable to open file: {}\n", filename.generic_string());
+        return false;
+    }
+
+    in.seekg(0, std::ios::end);
+    wad_image.resize(in.tellg());
+    in.seekg(0);
+    in.read(reinterpret_cast<char *>(wad_image.data()), wad_image.size());
+
+    return !in.fail();
+}
+
+static int ZipLevel() {
+    std::string mode = ob_get_param("zip_compression");
+
+    if (mode == "store") {
+        return 0;
+    } else if (mode == "fast") {
+        return 1;
+    } else if (mode == "best") {
+        return 9;
+    }
+
+    return 6;
+}
+
+static bool ZipWrite(const std::filesystem::path &zip_filename,
+                     const std::string &entry_name, const void *data,
+                     size_t length) {
+    if (length > INT_MAX) {
+        return false;
+    }
+
+    if (!ZIPF_OpenWrite(zip_filename, ZipLevel())) {
+        return false;
+    }
+
+    ZIPF_NewLump(entry_name.c_str());
+
+    bool ok = ZIPF_AppendData(data, (int)length);
+
+    // the lump and directory must be finished even after a failure,
+    // so that the file gets closed.
+    bool finish_ok = ZIPF_FinishLump();
+    bool close_ok = ZIPF_CloseWrite();
+
+    return ok && finish_ok && close_ok;
+}
+
+static bool ZipOutput(const std::filesystem::path &filename, const void *data,
+                      size_t length) {
+    std::filesystem::path zip_filename = filename;
+    zip_filename.replace_extension("pk3");
+
+    if (std::filesystem::exists(zip_filename)) {
+        if (create_backups) {
+            Main::BackupFile(zip_filename);
+        }
+        std::filesystem::remove(zip_filename);
+    }
+
+    const u32_t start_time = TimeGetMillies();
+
+    if (!ZipWrite(zip_filename, filename.filename().string(), data, length)) {
+        LogPrintf("Zipping output WAD to {} failed! Retaining original WAD.\n",
+                  zip_filename.generic_string());
+
+        std::error_code ec;
+        std::filesystem::remove(zip_filename, ec);
+
+        return SaveFile(filename, data, length);
+    }
+
+    std::error_code ec;
+    uintmax_t zip_size = std::filesystem::file_size(zip_filename, ec);
+
+    LogPrintf("Compressed {} bytes to {} bytes in {:.2f} seconds\n", length,
+              ec ? 0 : zip_size, (TimeGetMillies() - start_time) / 1000.0);
+
+    // SLUMP leaves a plain WAD behind
+    if (std::filesystem::exists(filename)) {
+        std::filesystem::remove(filename);
+    }
+
+    return true;
+}
+
+static bool WriteOutput(const std::filesystem::path &filename) {
+    bool compress = ob_mod_enabled("compress_output");
+
+    const void *data = wad_image.data();
+    size_t length = wad_image.size();
+
+    std::string node_buffer;
+
+    if (build_nodes) {
+        // when not compressing, ZDBSP writes the final WAD itself
+        if (!BuildNodes(filename, compress ? &node_buffer : NULL)) {
+            return false;
+        }
+
+        if (!compress) {
+            return true;
+        }
+
+        data = node_buffer.data();
+        length = node_buffer.size();
+    }
+
+    if (compress) {
+        return ZipOutput(filename, data, length);
+    }
+
+    return SaveFile(filename, data, length);
+}
+
 }  // namespace Doom
 
 //------------------------------------------------------------------------
@@ -1052,7 +1289,7 @@ bool Doom::game_interface_c::Start(const char *preset) {
         return true;
     }
 
-    if (!StartWAD(filename)) {
+    if (!StartWAD()) {
         Main::ProgStatus(_("Error (create file)"));
         return false;
     }
@@ -1107,6 +1344,10 @@ bool Doom::game_interface_c::Finish(bool build_ok) {
         EndWAD();
     } else {
         build_ok = slump_main(filename);
+
+        if (build_ok) {
+            build_ok = Doom::LoadWADImage(filename);
+        }
     }
 
     if (UDMF_mode) {
@@ -1124,73 +1365,29 @@ bool Doom::game_interface_c::Finish(bool build_ok) {
     }
 
     if (build_ok) {
-        build_ok = Doom::BuildNodes(filename);
+        build_ok = Doom::WriteOutput(filename);
     }
 
     if (!build_ok) {
         // remove the WAD if an error occurred
         if (!preserve_failures) {
             std::filesystem::remove(filename);
+        } else if (!std::filesystem::exists(filename)) {
+            Doom::SaveFile(filename, wad_image.data(), wad_image.size());
         }
     } else {
         Recent_AddFile(RECG_Output, filename);
     }
 
-    if (build_ok) {
-        if (ob_mod_enabled("compress_output")) {
-            std::filesystem::path zip_filename = filename;
-            zip_filename.replace_extension("pk3");
-            if (std::filesystem::exists(zip_filename)) {
-                if (create_backups) {
-                    Main::BackupFile(zip_filename);
-                }
-                std::filesystem::remove(zip_filename);
-            }
-            FILE *zip_file = fopen(filename.string().c_str(), "rb");
-            int zip_length = std::filesystem::file_size(filename);
-            byte *zip_buf = new byte[zip_length];
-            if (zip_buf && zip_file) {
-                memset(zip_buf, 0, zip_length);
-                fread(zip_buf, 1, zip_length, zip_file);
-            }
-            if (zip_file) {
-                fclose(zip_file);
-            }
-            if (zip_buf) {
-                if (mz_zip_add_mem_to_archive_file_in_place(
-                        zip_filename.string().c_str(),
-                        filename.filename().string().c_str(), zip_buf,
-                        zip_length, NULL, 0, MZ_DEFAULT_COMPRESSION)) {
-                    std::filesystem::remove(filename);
-                    delete[] zip_buf;
-                } else {
-                    LogPrintf(
-                        "Zipping output WAD to {} failed! Retaining original "
-                        "WAD.\n",
-                        zip_filename.generic_string());
-                }
-            } else {
-                LogPrintf(
-                    "Zipping output WAD to {} failed! Retaining original "
-                    "WAD.\n",
-                    zip_filename.generic_string());
-            }
-        }
-    }
+    wad_image.clear();
+    wad_image.shrink_to_fit();
+
+    udmf_levels.clear();
 
     return build_ok;
 }
 
-void Doom::game_interface_c::BeginLevel() {
-    if (UDMF_mode) {
-        udmf_vertexes = 0;
-        udmf_sectors = 0;
-        udmf_linedefs = 0;
-        udmf_things = 0;
-        udmf_sidedefs = 0;
-    }
-    Doom::BeginLevel();
-}
+void Doom::game_interface_c::BeginLevel() { Doom::BeginLevel(); }
 
 void Doom::game_interface_c::Property(std::string key, std::string value) {
     if (StringCaseCmp(key, "level_name") == 0) {
@@ -24,6 +24,8 @@
 
 #include <filesystem>
 #include <array>
+#include <string>
+#include <vector>
 #include "sys_type.h"
 #include "m_lua.h"
 
@@ -42,7 +44,7 @@ extern int sub_format;
 
 /***** FUNCTIONS ****************/
 
-bool StartWAD(std::filesystem::path filename);
+bool StartWAD();
 bool EndWAD();
 
 void BeginLevel();
@@ -90,6 +92,82 @@ int NumThings();
 void Send_Prog_Nodes(int progress, int num_maps);
 void Send_Prog_Step(const char *step_name);
 
+/* ----- UDMF levels ---------------------- */
+
+// In UDMF mode the map objects are kept in these arrays while the level
+// is being built, and the TEXTMAP lump is written in one go when it is
+// finished.  ZDBSP reads the same fields via UDMF_Visit() instead of
+// parsing the text again.
+
+struct udmf_vertex_t {
+    int x, y;
+};
+
+struct udmf_sector_t {
+    int floor_h, ceil_h;
+    std::string floor_tex, ceil_tex;
+    int light, special, tag;
+};
+
+struct udmf_sidedef_t {
+    int sector;
+    std::string lower_tex, mid_tex, upper_tex;
+    int x_offset, y_offset;
+};
+
+struct udmf_linedef_t {
+    int start, end;
+    int side1, side2;  // -1 for none
+    int type, flags, tag;
+    std::array<u8_t, 5> args;
+};
+
+struct udmf_thing_t {
+    int x, y, height;
+    int type, angle, options;
+    int tid;
+    u8_t special;
+    bool has_args;
+    std::array<u8_t, 5> args;
+};
+
+struct udmf_level_t {
+    std::string name;
+
+    int sub_format;
+    bool ee_compat;
+
+    std::vector<udmf_vertex_t> vertices;
+    std::vector<udmf_sector_t> sectors;
+    std::vector<udmf_sidedef_t> sidedefs;
+    std::vector<udmf_linedef_t> linedefs;
+    std::vector<udmf_thing_t> things;
+};
+
+class udmf_fields_c {
+    // Receives the contents of a TEXTMAP lump in the order they are
+    // written.  Fields before the first block are global ones (like the
+    // namespace).  Keys are always string literals.
+
+   public:
+    virtual ~udmf_fields_c() {}
+
+    virtual void Block(const char *kind) = 0;  // "thing", "vertex" etc
+    virtual void EndBlock() = 0;
+
+    virtual void IntField(const char *key, int value) = 0;
+    virtual void FloatField(const char *key, double value) = 0;
+    virtual void BoolField(const char *key, bool value) = 0;
+    virtual void StringField(const char *key, const std::string &value) = 0;
+};
+
+void UDMF_Visit(const udmf_level_t &level, udmf_fields_c &out);
+
+const udmf_level_t *UDMF_FindLevel(std::string_view name);
+// returns the objects of a finished UDMF level, or NULL when there is
+// no such level (e.g. the WAD was not built in UDMF mode).  Levels are
+// kept until the output file has been written.
+
 /* ----- Level structures ---------------------- */
 
 #pragma pack(push, 1)
@@ -63,7 +63,7 @@
 #define NODE_PADDING 16
 #define MODEL_PADDING 1.0
 
-extern void Q1_ClippingHull(int hull);
+extern void Q1_ClippingHulls();
 extern std::filesystem::path BestDirectory();
 
 static std::string level_name;
@@ -1132,9 +1132,7 @@ static void Q1_ClipModels() {
     q1_clip = BSP_NewLump(LUMP_CLIPNODES);
     q1_total_clip = 0;
 
-    for (int hull = 1; hull < 6; hull++) {
-        Q1_ClippingHull(hull);
-    }
+    Q1_ClippingHulls();
 }
 
 static void Q1_WriteModels() {
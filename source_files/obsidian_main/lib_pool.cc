@@ -0,0 +1,168 @@
+//------------------------------------------------------------------------
+//  Object Pools
+//------------------------------------------------------------------------
+//
+//  OBSIDIAN Level Maker
+//
+//  Copyright (C) 2021-2022 The OBSIDIAN Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "lib_pool.h"
+
+#include <algorithm>
+
+#include "headers.h"
+#include "lib_util.h"
+#include "main.h"
+#include "sys_assert.h"
+
+// this is a function (not a global) so that pools which are globals
+// in other files can register themselves during static init.
+// Pools are thread_local, so each thread has its own registry.
+static std::vector<pool_base_c *> &Pool_Registry() {
+    static thread_local std::vector<pool_base_c *> registry;
+    return registry;
+}
+
+pool_base_c::pool_base_c(const char *_name, size_t _item_size,
+                         size_t _block_items)
+    : name(_name),
+      item_size(_item_size),
+      block_items(_block_items),
+      blocks(),
+      bump_pos(NULL),
+      bump_end(NULL),
+      free_list(NULL),
+      live(0),
+      peak_live(0),
+      total_allocs(0) {
+    // keep every item suitably aligned for any type
+    const size_t align = alignof(std::max_align_t);
+
+    item_size = std::max(item_size, sizeof(free_item_t));
+    item_size = (item_size + align - 1) & ~(align - 1);
+
+    Pool_Registry().push_back(this);
+}
+
+pool_base_c::~pool_base_c() {
+    // the blocks are deliberately not freed here, since objects may
+    // still get deleted after this during program shutdown.
+    std::vector<pool_base_c *> &registry = Pool_Registry();
+
+    registry.erase(std::remove(registry.begin(), registry.end(), this),
+                   registry.end());
+}
+
+void pool_base_c::NewBlock() {
+    char *block = (char *)::operator new(item_size * block_items);
+
+    blocks.push_back(block);
+
+    bump_pos = block;
+    bump_end = block + item_size * block_items;
+}
+
+void *pool_base_c::Alloc() {
+    void *ptr;
+
+    if (free_list) {
+        ptr = free_list;
+        free_list = free_list->next;
+    } else {
+        if (bump_pos == bump_end) {
+            NewBlock();
+        }
+
+        ptr = bump_pos;
+        bump_pos += item_size;
+    }
+
+    live += 1;
+    total_allocs += 1;
+
+    peak_live = std::max(peak_live, live);
+
+    return ptr;
+}
+
+void pool_base_c::Free(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    SYS_ASSERT(live > 0);
+
+    free_item_t *item = (free_item_t *)ptr;
+
+    item->next = free_list;
+    free_list = item;
+
+    live -= 1;
+}
+
+void pool_base_c::Release() {
+    for (char *block : blocks) {
+        ::operator delete(block);
+    }
+
+    blocks.clear();
+
+    bump_pos = bump_end = NULL;
+    free_list = NULL;
+
+    live = 0;
+    peak_live = 0;
+    total_allocs = 0;
+}
+
+void pool_base_c::LogStats() const {
+    if (total_allocs == 0) {
+        return;
+    }
+
+    LogPrintf("   {:<12} {:>8} allocs, peak {:>7} ({} KB in {} blocks)\n",
+              name, total_allocs, peak_live,
+              (item_size * block_items * blocks.size()) / 1024,
+              blocks.size());
+
+    // the CSG code loses track of a few objects (e.g. merged snags)
+    if (live > 0) {
+        LogPrintf("   {:<12} {:>8} never freed\n", "", live);
+    }
+}
+
+void Pool_ReleaseAll(bool show_stats) {
+    size_t total_allocs = 0;
+    size_t total_blocks = 0;
+
+    for (pool_base_c *pool : Pool_Registry()) {
+        if (show_stats) {
+            pool->LogStats();
+
+            total_allocs += pool->total_allocs;
+            total_blocks += pool->blocks.size();
+        }
+
+        pool->Release();
+    }
+
+    if (show_stats && total_allocs > 0) {
+        LogPrintf("   {} objects allocated from {} blocks\n", total_allocs,
+                  total_blocks);
+    }
+}
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
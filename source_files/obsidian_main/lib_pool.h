@@ -0,0 +1,125 @@
+//------------------------------------------------------------------------
+//  Object Pools
+//------------------------------------------------------------------------
+//
+//  OBSIDIAN Level Maker
+//
+//  Copyright (C) 2021-2022 The OBSIDIAN Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef __LIB_POOL_H__
+#define __LIB_POOL_H__
+
+#include <cstddef>
+#include <vector>
+
+class pool_base_c {
+    // A pool hands out fixed size pieces of memory, carved from large
+    // blocks.  Freed pieces go on a free list for re-use, and all the
+    // blocks are released at once when the owner knows the objects
+    // are no longer needed.
+    //
+    // Pools are NOT thread safe.  They are declared thread_local, so
+    // every thread allocates from its own copy, and objects must be
+    // freed by the same thread which allocated them.
+
+   public:
+    const char *name;
+
+   private:
+    size_t item_size;
+    size_t block_items;
+
+    std::vector<char *> blocks;
+
+    // unused part of the newest block
+    char *bump_pos;
+    char *bump_end;
+
+    struct free_item_t {
+        free_item_t *next;
+    };
+
+    free_item_t *free_list;
+
+    // statistics, reset by Release()
+    size_t live;
+    size_t peak_live;
+    size_t total_allocs;
+
+   public:
+    pool_base_c(const char *_name, size_t _item_size, size_t _block_items);
+    virtual ~pool_base_c();
+
+    void *Alloc();
+    void Free(void *ptr);
+
+    // frees all the blocks.  Items still in use are simply dropped,
+    // without calling their destructors.
+    void Release();
+
+    void LogStats() const;
+
+   private:
+    void NewBlock();
+
+    friend void Pool_ReleaseAll(bool show_stats);
+};
+
+template <class T, size_t BLOCK_ITEMS = 512>
+class object_pool_c : public pool_base_c {
+    // Typed pool, used by giving a class its own operator new/delete:
+    //
+    //    static thread_local object_pool_c<foo_c> pool("foos");
+    //
+    //    void *operator new(size_t size) { return pool.New(size); }
+    //
+    //    void operator delete(void *ptr, size_t size) {
+    //        pool.Delete(ptr, size);
+    //    }
+
+   public:
+    explicit object_pool_c(const char *_name)
+        : pool_base_c(_name, sizeof(T), BLOCK_ITEMS) {}
+
+    virtual ~object_pool_c() {}
+
+    // objects of a derived class are bigger, so they are left to the
+    // global heap.
+    void *New(size_t size) {
+        if (size != sizeof(T)) {
+            return ::operator new(size);
+        }
+        return Alloc();
+    }
+
+    void Delete(void *ptr, size_t size) {
+        if (size != sizeof(T)) {
+            ::operator delete(ptr);
+            return;
+        }
+        Free(ptr);
+    }
+};
+
+void Pool_ReleaseAll(bool show_stats);
+// releases the blocks of every pool of the calling thread, optionally
+// logging how much each pool was used since the last release.  Nothing
+// may refer to pooled objects after this.  Called at the end of each
+// level, and by worker threads when their work is done.
+
+#endif /* __LIB_POOL_H__ */
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
@@ -0,0 +1,199 @@
+//------------------------------------------------------------------------
+//  Worker Threads
+//------------------------------------------------------------------------
+//
+//  OBSIDIAN Level Maker
+//
+//  Copyright (C) 2021-2022 The OBSIDIAN Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "lib_thread.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "lib_util.h"
+#include "main.h"
+
+// how often (in milliseconds) the idle function gets called
+#define IDLE_INTERVAL 50
+
+static thread_local bool is_worker_thread = false;
+
+bool Thread_IsWorker() { return is_worker_thread; }
+
+int Thread_WorkerCount() {
+    int count = worker_threads;
+
+    if (count <= 0) {
+        count = (int)std::thread::hardware_concurrency();
+    }
+
+    return (count < 1) ? 1 : count;
+}
+
+class thread_range_c {
+   public:
+    std::mutex lock;
+
+    // remaining indices are lo .. hi-1
+    int lo, hi;
+
+   public:
+    thread_range_c() : lo(0), hi(0) {}
+
+    // owner takes from the front...
+    bool TakeFront(int *index) {
+        std::lock_guard<std::mutex> guard(lock);
+
+        if (lo >= hi) {
+            return false;
+        }
+
+        *index = lo++;
+        return true;
+    }
+
+    // ...thieves take from the back.
+    bool TakeBack(int *index) {
+        std::lock_guard<std::mutex> guard(lock);
+
+        if (lo >= hi) {
+            return false;
+        }
+
+        *index = --hi;
+        return true;
+    }
+};
+
+static bool Thread_SerialFor(int count, const thread_work_f &func,
+                             const thread_idle_f &idle_func) {
+    u32_t last_idle = TimeGetMillies();
+
+    for (int i = 0; i < count; i++) {
+        func(i, 0);
+
+        if (idle_func && (u32_t)(TimeGetMillies() - last_idle) >= IDLE_INTERVAL) {
+            if (!idle_func()) {
+                return false;
+            }
+
+            last_idle = TimeGetMillies();
+        }
+    }
+
+    return true;
+}
+
+bool Thread_ParallelFor(int count, const thread_work_f &func,
+                        const thread_idle_f &idle_func) {
+    if (count <= 0) {
+        return true;
+    }
+
+    int num_workers = Thread_WorkerCount();
+
+    if (num_workers > count) {
+        num_workers = count;
+    }
+
+    if (num_workers <= 1) {
+        return Thread_SerialFor(count, func, idle_func);
+    }
+
+    std::vector<thread_range_c> ranges(num_workers);
+
+    for (int w = 0; w < num_workers; w++) {
+        ranges[w].lo = (int)((long long)count * w / num_workers);
+        ranges[w].hi = (int)((long long)count * (w + 1) / num_workers);
+    }
+
+    std::atomic<bool> aborted(false);
+    std::atomic<int> active(num_workers);
+
+    std::mutex done_lock;
+    std::condition_variable done_cond;
+
+    auto worker_main = [&](int w) {
+        is_worker_thread = true;
+
+        int index;
+
+        while (!aborted.load(std::memory_order_relaxed)) {
+            if (ranges[w].TakeFront(&index)) {
+                func(index, w);
+                continue;
+            }
+
+            // our own range is empty, try to steal from another one
+            bool stole = false;
+
+            for (int k = 1; k < num_workers && !stole; k++) {
+                stole = ranges[(w + k) % num_workers].TakeBack(&index);
+            }
+
+            if (!stole) {
+                break;
+            }
+
+            func(index, w);
+        }
+
+        std::lock_guard<std::mutex> guard(done_lock);
+
+        active--;
+        done_cond.notify_all();
+    };
+
+    std::vector<std::thread> threads;
+
+    threads.reserve(num_workers);
+
+    for (int w = 0; w < num_workers; w++) {
+        threads.emplace_back(worker_main, w);
+    }
+
+    {
+        std::unique_lock<std::mutex> guard(done_lock);
+
+        while (active.load() > 0) {
+            done_cond.wait_for(guard,
+                               std::chrono::milliseconds(IDLE_INTERVAL));
+
+            if (idle_func && active.load() > 0 && !aborted.load()) {
+                guard.unlock();
+
+                if (!idle_func()) {
+                    aborted = true;
+                }
+
+                guard.lock();
+            }
+        }
+    }
+
+    for (std::thread &T : threads) {
+        T.join();
+    }
+
+    return !aborted.load();
+}
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
@@ -0,0 +1,60 @@
+//------------------------------------------------------------------------
+//  Worker Threads
+//------------------------------------------------------------------------
+//
+//  OBSIDIAN Level Maker
+//
+//  Copyright (C) 2021-2022 The OBSIDIAN Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef __LIB_THREAD_H__
+#define __LIB_THREAD_H__
+
+#include <functional>
+
+typedef std::function<void(int index, int worker)> thread_work_f;
+
+// returns false to abandon the remaining work (e.g. user hit Cancel)
+typedef std::function<bool()> thread_idle_f;
+
+int Thread_WorkerCount();
+// returns the number of worker threads to use, which is the
+// 'worker_threads' option or the number of hardware threads when
+// that option is zero.  Always at least 1.
+
+bool Thread_ParallelFor(int count, const thread_work_f &func,
+                        const thread_idle_f &idle_func = nullptr);
+// calls func(index, worker) for every index in [0, count), spreading
+// the work over the worker threads.  The 'worker' parameter is in the
+// range [0, Thread_WorkerCount()) and is unique among the threads
+// running at the same time, so it can select per-worker scratch data.
+//
+// Each worker owns a contiguous range of indices and takes work
+// from the front of it, and when that is exhausted it steals from
+// the back of another worker's range, so a few expensive items do
+// not hold up the rest.
+//
+// The calling thread merely waits, and calls idle_func (when given)
+// every so often.  Returns false if idle_func asked to stop early,
+// in which case some indices may not have been visited.
+
+bool Thread_IsWorker();
+// true when called from one of the threads started by
+// Thread_ParallelFor().  When there is only a single worker, the work
+// is done by the calling thread and this returns false.
+
+#endif /* __LIB_THREAD_H__ */
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
@@ -253,11 +253,43 @@ void WAD_ListEntries(void) {
 
 static std::ofstream wad_W_fp;
 
+// when non-NULL, the WAD is being written into this buffer instead
+static std::vector<u8_t> *wad_W_mem;
+
 static std::list<raw_wad_lump_t> wad_W_directory;
 
 static raw_wad_lump_t wad_W_lump;
 
+static u32_t WAD_WriteTell() {
+    if (wad_W_mem) {
+        return static_cast<u32_t>(wad_W_mem->size());
+    }
+
+    return static_cast<u32_t>(wad_W_fp.tellp());
+}
+
+static bool WAD_WriteRaw(const void *data, int length) {
+    if (wad_W_mem) {
+        const u8_t *src = static_cast<const u8_t *>(data);
+
+        wad_W_mem->insert(wad_W_mem->end(), src, src + length);
+        return true;
+    }
+
+    wad_W_fp.write(static_cast<const char *>(data), length);
+    return !wad_W_fp.fail();
+}
+
+static void WAD_WriteDummyHeader() {
+    raw_wad_header_t header;
+    memset(&header, 0, sizeof(header));
+
+    WAD_WriteRaw(&header, sizeof(raw_wad_header_t));
+}
+
 bool WAD_OpenWrite(std::filesystem::path filename) {
+    wad_W_mem = NULL;
+
     wad_W_fp.open(filename, std::ios::out | std::ios::binary);
 
     if (!wad_W_fp.is_open()) {
@@ -267,20 +299,23 @@ bool WAD_OpenWrite(std::filesystem::path filename) {
 
     LogPrintf("Created WAD file: {}\n", filename.string());
 
-    // write out a dummy header
-    raw_wad_header_t header;
-    memset(&header, 0, sizeof(header));
-
-    wad_W_fp.write(reinterpret_cast<const char *>(&header),
-                   sizeof(raw_wad_header_t));
-    wad_W_fp << std::flush;
+    WAD_WriteDummyHeader();
 
     return true;
 }
 
-void WAD_CloseWrite(void) {
-    wad_W_fp << std::flush;
+void WAD_OpenWriteMem(std::vector<u8_t> *buffer) {
+    SYS_ASSERT(buffer);
+
+    wad_W_mem = buffer;
+    wad_W_mem->clear();
+
+    LogPrintf("Created WAD in memory\n");
+
+    WAD_WriteDummyHeader();
+}
 
+void WAD_CloseWrite(void) {
     // write the directory
 
     LogPrintf("Writing WAD directory\n");
@@ -289,7 +324,7 @@ void WAD_CloseWrite(void) {
 
     memcpy(header.magic, "PWAD", sizeof(header.magic));
 
-    header.dir_start = wad_W_fp.tellp();
+    header.dir_start = WAD_WriteTell();
     header.num_lumps = 0;
 
     std::list<raw_wad_lump_t>::iterator WDI;
@@ -297,26 +332,28 @@ void WAD_CloseWrite(void) {
     for (WDI = wad_W_directory.begin(); WDI != wad_W_directory.end(); ++WDI) {
         raw_wad_lump_t *L = &(*WDI);
 
-        wad_W_fp.write(reinterpret_cast<const char *>(L),
-                       sizeof(raw_wad_lump_t));
-        wad_W_fp << std::flush;
+        WAD_WriteRaw(L, sizeof(raw_wad_lump_t));
 
         header.num_lumps++;
     }
 
-    wad_W_fp << std::flush;
-
     // finally write the _real_ WAD header
 
     header.dir_start = LE_U32(header.dir_start);
     header.num_lumps = LE_U32(header.num_lumps);
 
-    wad_W_fp.seekp(0, std::ios::beg);
+    if (wad_W_mem) {
+        memcpy(wad_W_mem->data(), &header, sizeof(header));
+
+        wad_W_mem = NULL;
+    } else {
+        wad_W_fp.seekp(0, std::ios::beg);
 
-    wad_W_fp.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        wad_W_fp.write(reinterpret_cast<const char *>(&header), sizeof(header));
 
-    wad_W_fp << std::flush;
-    wad_W_fp.close();
+        wad_W_fp << std::flush;
+        wad_W_fp.close();
+    }
 
     LogPrintf("Closed WAD file\n");
 
@@ -332,7 +369,7 @@ void WAD_NewLump(std::string_view name) {
 
     std::copy(name.data(), name.data() + name.size(), wad_W_lump.name);
 
-    wad_W_lump.start = wad_W_fp.tellp();
+    wad_W_lump.start = WAD_WriteTell();
 }
 
 bool WAD_AppendData(const void *data, int length) {
@@ -342,13 +379,12 @@ bool WAD_AppendData(const void *data, int length) {
 
     SYS_ASSERT(length > 0);
 
-    return static_cast<bool>(
-        wad_W_fp.write(static_cast<const char *>(data), length));
+    return WAD_WriteRaw(data, length);
 }
 
 void WAD_FinishLump(void) {
     const int len =
-        static_cast<int>(wad_W_fp.tellp()) - static_cast<int>(wad_W_lump.start);
+        static_cast<int>(WAD_WriteTell()) - static_cast<int>(wad_W_lump.start);
 
     // pad lumps to a multiple of four bytes
     int padding = ALIGN_LEN(len) - len;
@@ -356,8 +392,7 @@ void WAD_FinishLump(void) {
     if (padding > 0) {
         static u8_t zeros[4] = {0, 0, 0, 0};
 
-        wad_W_fp.write(reinterpret_cast<const char *>(zeros), padding);
-        wad_W_fp << std::flush;
+        WAD_WriteRaw(zeros, padding);
     }
 
     // fix endianness
@@ -26,6 +26,7 @@
 
 #include <filesystem>
 #include <string_view>
+#include <vector>
 #include "sys_type.h"
 
 bool WAD_OpenRead(std::filesystem::path filename);
@@ -45,6 +46,10 @@ void WAD_ListEntries();
 bool WAD_OpenWrite(std::filesystem::path filename);
 void WAD_CloseWrite();
 
+// write the WAD into the given buffer instead of a file.
+// the buffer is complete after WAD_CloseWrite().
+void WAD_OpenWriteMem(std::vector<u8_t> *buffer);
+
 void WAD_NewLump(std::string_view name);
 bool WAD_AppendData(const void *data, int length);
 void WAD_FinishLump();
@@ -0,0 +1,137 @@
+//------------------------------------------------------------------------
+//  Word Lists
+//------------------------------------------------------------------------
+//
+//  OBSIDIAN Level Maker
+//
+//  Copyright (C) 2021-2022 The OBSIDIAN Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "lib_words.h"
+
+#include <map>
+#include <memory>
+
+#include "headers.h"
+#include "lib_util.h"
+#include "main.h"
+#include "physfs.h"
+
+word_list_c::word_list_c() : blob(), offsets() {}
+
+word_list_c::~word_list_c() {}
+
+bool word_list_c::Load(const std::string &filename) {
+    PHYSFS_File *fp = PHYSFS_openRead(filename.c_str());
+
+    if (!fp) {
+        LogPrintf("Unable to open word list: {}\n", filename);
+        return false;
+    }
+
+    PHYSFS_sint64 length = PHYSFS_fileLength(fp);
+
+    if (length > 0) {
+        blob.resize(length);
+        length = PHYSFS_readBytes(fp, blob.data(), length);
+    }
+
+    PHYSFS_close(fp);
+
+    if (length < 0) {
+        LogPrintf("Error reading word list: {}\n", filename);
+        blob.clear();
+        return false;
+    }
+
+    blob.resize(length);
+
+    // turn each line into a NUL terminated word, in place.
+    // blank lines are skipped and any CR is removed.
+    offsets.clear();
+
+    size_t start = 0;
+
+    for (size_t pos = 0; pos <= blob.size(); pos++) {
+        if (pos < blob.size() && blob[pos] != '\n') {
+            continue;
+        }
+
+        size_t end = pos;
+
+        if (end > start && blob[end - 1] == '\r') {
+            end--;
+        }
+
+        if (end > start) {
+            blob[end] = 0;
+            offsets.push_back((uint32_t)start);
+        }
+
+        start = pos + 1;
+    }
+
+    // a last line without a newline needs a terminator too
+    blob.push_back(0);
+
+    return true;
+}
+
+//------------------------------------------------------------------------
+
+static std::map<std::string, std::unique_ptr<word_list_c>, std::less<>>
+    all_word_lists;
+
+const word_list_c *WordList_Find(std::string_view name) {
+    auto it = all_word_lists.find(name);
+
+    if (it != all_word_lists.end()) {
+        return it->second.get();
+    }
+
+    // only plain names are allowed, the list must be in data/words
+    for (char ch : name) {
+        if (!(isalnum((unsigned char)ch) || ch == '_' || ch == '-')) {
+            return NULL;
+        }
+    }
+
+    if (name.empty()) {
+        return NULL;
+    }
+
+    const u32_t start_time = TimeGetMillies();
+
+    std::unique_ptr<word_list_c> list = std::make_unique<word_list_c>();
+
+    if (!list->Load(fmt::format("data/words/{}.txt", name)) ||
+        list->Count() == 0) {
+        // remember the failure, so it is not retried every time
+        list.reset();
+    } else {
+        LogPrintf("Loaded word list '{}' ({} words) in {} seconds\n", name,
+                  list->Count(), (TimeGetMillies() - start_time) / 1000.0);
+    }
+
+    const word_list_c *result = list.get();
+
+    all_word_lists.emplace(std::string(name), std::move(list));
+
+    return result;
+}
+
+void WordList_FreeAll() { all_word_lists.clear(); }
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
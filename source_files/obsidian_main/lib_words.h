@@ -0,0 +1,61 @@
+//------------------------------------------------------------------------
+//  Word Lists
+//------------------------------------------------------------------------
+//
+//  OBSIDIAN Level Maker
+//
+//  Copyright (C) 2021-2022 The OBSIDIAN Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef __LIB_WORDS_H__
+#define __LIB_WORDS_H__
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class word_list_c {
+    // A list of words kept in a single block of memory: every word is
+    // followed by a NUL, and the index holds the offset of each one.
+    // The source is a plain text file with one word per line.
+
+   private:
+    std::string blob;
+
+    std::vector<uint32_t> offsets;
+
+   public:
+    word_list_c();
+    ~word_list_c();
+
+    // reads the file via PhysFS, returns false on failure.
+    bool Load(const std::string &filename);
+
+    size_t Count() const { return offsets.size(); }
+
+    const char *Get(size_t index) const { return &blob[offsets[index]]; }
+};
+
+const word_list_c *WordList_Find(std::string_view name);
+// gets a list from the "data/words" folder, loading it the first time
+// it is needed.  Returns NULL if the list does not exist or is empty.
+// Lists stay loaded until WordList_FreeAll() is called.
+
+void WordList_FreeAll();
+
+#endif /* __LIB_WORDS_H__ */
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
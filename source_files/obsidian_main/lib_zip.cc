@@ -26,8 +26,10 @@
 #include "miniz.h"
 
 #include <list>
+#include <vector>
 
 #include "fmt/core.h"
+#include "lib_thread.h"
 #include "lib_util.h"
 #include "main.h"
 
@@ -614,12 +616,115 @@ static zip_local_entry_t w_local;
 
 static int w_local_start;
 static int w_local_length;
+static int w_compress_length;
 
 // common date and time (not swapped)
 static int zipf_date;
 static int zipf_time;
 
-bool ZIPF_OpenWrite(const std::filesystem::path &filename) {
+// compression level for new lumps, 0 to store them
+static int w_level;
+
+// When compressing, the data of a lump is collected into chunks which
+// are deflated in parallel, and written out in order.  Every chunk is
+// a separate deflate stream ending on a byte boundary (a sync flush),
+// except the last one is finished properly, so together they form one
+// valid stream.  Only a few chunks are held in memory at a time.
+
+#define ZIPF_CHUNK_SIZE (256 * 1024)
+
+typedef struct {
+    std::vector<byte> in;
+    std::vector<byte> out;
+
+    bool last;
+} zip_chunk_t;
+
+static std::vector<zip_chunk_t> w_chunks;
+
+static void deflate_chunk(zip_chunk_t &C) {
+    z_stream Z;
+
+    memset(&Z, 0, sizeof(Z));
+
+    // raw deflate data, no zlib header
+    if (deflateInit2(&Z, w_level, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY) !=
+        Z_OK) {
+        Main::FatalError("ZIPF: cannot initialize compression\n");
+    }
+
+    C.out.resize(deflateBound(&Z, C.in.size()) + 64);
+
+    Z.next_in = C.in.data();
+    Z.avail_in = C.in.size();
+
+    Z.next_out = C.out.data();
+    Z.avail_out = C.out.size();
+
+    for (;;) {
+        int res = deflate(&Z, C.last ? Z_FINISH : Z_SYNC_FLUSH);
+
+        if (res == Z_STREAM_END) {
+            break;
+        }
+
+        if (res != Z_OK) {
+            Main::FatalError("ZIPF: compression failed ({})\n", res);
+        }
+
+        if (!C.last && Z.avail_in == 0 && Z.avail_out > 0) {
+            break;
+        }
+
+        // output buffer is full (should not happen)
+        size_t used = Z.next_out - C.out.data();
+
+        C.out.resize(C.out.size() * 2);
+
+        Z.next_out = C.out.data() + used;
+        Z.avail_out = C.out.size() - used;
+    }
+
+    C.out.resize(Z.total_out);
+
+    deflateEnd(&Z);
+
+    // the input is no longer needed
+    C.in.clear();
+    C.in.shrink_to_fit();
+}
+
+static bool flush_chunks(bool finish) {
+    if (finish) {
+        // even an empty lump needs a proper end to the stream
+        if (w_chunks.empty()) {
+            w_chunks.push_back(zip_chunk_t{});
+        }
+
+        w_chunks.back().last = true;
+    }
+
+    if (w_chunks.empty()) {
+        return true;
+    }
+
+    Thread_ParallelFor((int)w_chunks.size(), [](int index, int /*worker*/) {
+        deflate_chunk(w_chunks[index]);
+    });
+
+    for (const zip_chunk_t &C : w_chunks) {
+        w_zip_fp.write(reinterpret_cast<const char *>(C.out.data()),
+                       C.out.size());
+
+        w_compress_length += C.out.size();
+    }
+
+    w_chunks.clear();
+
+    return !w_zip_fp.fail();
+}
+
+bool ZIPF_OpenWrite(const std::filesystem::path &filename, int level) {
     w_zip_fp.open(filename, std::ios::out | std::ios::binary);
 
     if (!w_zip_fp) {
@@ -629,6 +734,8 @@ bool ZIPF_OpenWrite(const std::filesystem::path &filename) {
 
     LogPrintf("Created ZIP file: {}\n", filename);
 
+    w_level = std::max(0, std::min(level, 9));
+
     // grab the current date and time
     time_t cur_time = time(NULL);
 
@@ -649,7 +756,7 @@ bool ZIPF_OpenWrite(const std::filesystem::path &filename) {
     return true;
 }
 
-void ZIPF_CloseWrite(void) {
+bool ZIPF_CloseWrite(void) {
     w_zip_fp << std::flush;
 
     // write the directory
@@ -697,9 +804,16 @@ void ZIPF_CloseWrite(void) {
     w_zip_fp << std::flush;
     w_zip_fp.close();
 
+    // a failure anywhere above leaves the stream in a failed state
+    bool ok = !w_zip_fp.fail();
+
+    w_zip_fp.clear();
+
     LogPrintf("Closed ZIP file\n");
 
     w_directory.clear();
+
+    return ok;
 }
 
 void ZIPF_NewLump(const char *name) {
@@ -711,15 +825,22 @@ void ZIPF_NewLump(const char *name) {
     // remember position
     w_local_start = w_zip_fp.tellp();
     w_local_length = 0;
+    w_compress_length = 0;
+
+    w_chunks.clear();
 
     // setup the zip_local_entry_t fields
     memcpy(w_local.hdr.magic, ZIPF_LOCAL_MAGIC, 4);
 
-    w_local.hdr.req_version = LE_U16(ZIPF_REQ_VERSION);
     w_local.hdr.flags = 0;
 
-    // no compression... yet...
-    w_local.hdr.comp_method = LE_U16(ZIPF_COMP_STORE);
+    if (w_level > 0) {
+        w_local.hdr.req_version = LE_U16(ZIPF_REQ_VERSION_DEFLATE);
+        w_local.hdr.comp_method = LE_U16(ZIPF_COMP_DEFLATE);
+    } else {
+        w_local.hdr.req_version = LE_U16(ZIPF_REQ_VERSION);
+        w_local.hdr.comp_method = LE_U16(ZIPF_COMP_STORE);
+    }
 
     w_local.hdr.file_date = LE_U16(zipf_date);
     w_local.hdr.file_time = LE_U16(zipf_time);
@@ -748,23 +869,60 @@ bool ZIPF_AppendData(const void *data, int length) {
 
     SYS_ASSERT(length > 0);
 
-    if (!w_zip_fp.write(static_cast<const char *>(data), length)) {
-        return false;
-    }
-
     // compute the CRC -- use function from zlib
     w_local.hdr.crc = crc32(w_local.hdr.crc, (const Bytef *)data, (uInt)length);
 
     w_local_length += length;
 
+    if (w_level == 0) {
+        if (!w_zip_fp.write(static_cast<const char *>(data), length)) {
+            return false;
+        }
+
+        w_compress_length += length;
+        return true;
+    }
+
+    const byte *pos = static_cast<const byte *>(data);
+
+    while (length > 0) {
+        if (w_chunks.empty() || w_chunks.back().in.size() == ZIPF_CHUNK_SIZE) {
+            // compress the full chunks once there is enough work for
+            // all the threads.
+            if ((int)w_chunks.size() >= Thread_WorkerCount() * 2) {
+                if (!flush_chunks(false)) {
+                    return false;
+                }
+            }
+
+            w_chunks.push_back(zip_chunk_t{});
+            w_chunks.back().in.reserve(ZIPF_CHUNK_SIZE);
+        }
+
+        std::vector<byte> &in = w_chunks.back().in;
+
+        int count = std::min(length, (int)(ZIPF_CHUNK_SIZE - in.size()));
+
+        in.insert(in.end(), pos, pos + count);
+
+        pos += count;
+        length -= count;
+    }
+
     return true;
 }
 
-void ZIPF_FinishLump(void) {
+bool ZIPF_FinishLump(void) {
+    bool ok = true;
+
+    if (w_level > 0) {
+        ok = flush_chunks(true);
+    }
+
     w_zip_fp << std::flush;
 
     w_local.hdr.full_size = LE_U32(w_local_length);
-    w_local.hdr.compress_size = LE_U32(w_local_length);
+    w_local.hdr.compress_size = LE_U32(w_compress_length);
 
     // seek back and fix up the CRC and size fields
     w_zip_fp.seekp(w_local_start + LOCAL_CRC_OFFSET, std::ios::beg);
@@ -779,6 +937,8 @@ void ZIPF_FinishLump(void) {
     // seek back to end of file
     w_zip_fp.seekp(0, std::ios::end);
 
+    ok = ok && !w_zip_fp.fail();
+
     // create the central entry from the local entry
     zip_central_entry_t central;
 
@@ -809,6 +969,8 @@ void ZIPF_FinishLump(void) {
     strcpy(central.name, w_local.name);
 
     w_directory.push_back(central);
+
+    return ok;
 }
 
 //--- editor settings ---
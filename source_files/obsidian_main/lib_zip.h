@@ -42,12 +42,14 @@ void ZIPF_ListEntries();
 
 /* ZIP writing */
 
-bool ZIPF_OpenWrite(const std::filesystem::path &filename);
-void ZIPF_CloseWrite();
+// level is 0 to store the lumps as-is, or 1-9 to deflate them (6 is
+// the usual default).  Compression is spread over the worker threads.
+bool ZIPF_OpenWrite(const std::filesystem::path &filename, int level = 0);
+bool ZIPF_CloseWrite();
 
 void ZIPF_NewLump(const char *name);
 bool ZIPF_AppendData(const void *data, int length);
-void ZIPF_FinishLump();
+bool ZIPF_FinishLump();
 
 /* ----- ZIP file structures ---------------------- */
 
@@ -148,6 +150,7 @@ constexpr int ZIPF_COMP_DEFLATE = 8;
 
 // version numbers:
 constexpr unsigned int ZIPF_REQ_VERSION = 0x00A;
+constexpr unsigned int ZIPF_REQ_VERSION_DEFLATE = 0x014;
 constexpr unsigned int ZIPF_MADE_VERSION = 0x314;
 
 // external attributes:
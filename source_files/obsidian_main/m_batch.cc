@@ -0,0 +1,396 @@
+//------------------------------------------------------------------------
+//  BATCH FARM : many builds from one process
+//------------------------------------------------------------------------
+//
+//  OBSIDIAN Level Maker
+//
+//  Copyright (C) 2021-2022 The OBSIDIAN Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+//
+//  With --batch-count or --seed-list, the scripts are loaded once and
+//  then one output file is built per seed.  Each output is named after
+//  the --batch filename with the seed appended, and a JSON line with
+//  the seed, output name, result and build time is appended to a report
+//  file next to it (same name with a ".jsonl" extension).
+//
+//  With --jobs, the seeds are divided between that many copies of this
+//  program, each being a normal farm process with its own seed list and
+//  log file.  Separate processes keep the Lua and CSG state of every
+//  build completely isolated.
+//
+//------------------------------------------------------------------------
+
+#include "m_batch.h"
+
+#include <fstream>
+#include <thread>
+
+#include "fmt/core.h"
+#include "headers.h"
+#include "lib_argv.h"
+#include "lib_util.h"
+#include "m_cookie.h"
+#include "main.h"
+#include "sys_xoshiro.h"
+
+int batch_count = 0;
+int batch_jobs = 1;
+std::filesystem::path batch_seed_list;
+
+static std::filesystem::path batch_report_file;
+
+bool Batch_FarmMode() { return batch_count > 0 || !batch_seed_list.empty(); }
+
+static std::vector<std::string> Batch_LoadSeedList() {
+    std::ifstream fp(batch_seed_list, std::ios::in);
+
+    if (!fp.is_open()) {
+        Main::FatalError("Cannot open seed list: {}\n",
+                         batch_seed_list.string());
+    }
+
+    std::vector<std::string> seeds;
+
+    for (std::string line; std::getline(fp, line);) {
+        // strip whitespace and CR from either end
+        while (!line.empty() && isspace((unsigned char)line.back())) {
+            line.pop_back();
+        }
+        size_t start = 0;
+        while (start < line.size() && isspace((unsigned char)line[start])) {
+            start++;
+        }
+        line.erase(0, start);
+
+        // skip blank lines and comments
+        if (line.empty() || line[0] == '#' || line.rfind("--", 0) == 0) {
+            continue;
+        }
+
+        seeds.push_back(line);
+    }
+
+    return seeds;
+}
+
+static std::vector<std::string> Batch_MakeSeeds() {
+    std::vector<std::string> seeds;
+
+    if (!batch_seed_list.empty()) {
+        seeds = Batch_LoadSeedList();
+
+        if (batch_count > 0 && (int)seeds.size() > batch_count) {
+            seeds.resize(batch_count);
+        }
+
+        return seeds;
+    }
+
+    // the first seed is the normal one (random, or from the config file
+    // when -k is used), the rest follow on from it.  This does not depend
+    // on the builds themselves, so the same seeds are used for any
+    // number of jobs.
+    xoshiro_Reseed(next_rand_seed);
+
+    seeds.push_back(std::to_string(next_rand_seed));
+
+    while ((int)seeds.size() < batch_count) {
+        seeds.push_back(std::to_string(xoshiro_UInt()));
+    }
+
+    return seeds;
+}
+
+static std::filesystem::path Batch_OutputName(const std::string &seed) {
+    // keep file names sane for string seeds
+    std::string safe;
+
+    for (char ch : seed) {
+        safe.push_back((isalnum((unsigned char)ch) || ch == '-') ? ch : '_');
+    }
+
+    std::filesystem::path name = batch_output_file;
+
+    name.replace_filename(fmt::format("{}_{}{}",
+                                      batch_output_file.stem().string(), safe,
+                                      batch_output_file.extension().string()));
+    return name;
+}
+
+static std::filesystem::path Batch_MakeReportName() {
+    std::filesystem::path name = batch_output_file;
+
+    if (!name.is_absolute()) {
+        name = Resolve_DefaultOutputPath() / name;
+    }
+
+    return name.replace_extension("jsonl");
+}
+
+static std::string JSON_Escape(const std::string &str) {
+    std::string result;
+
+    for (char ch : str) {
+        switch (ch) {
+            case '"':
+                result += "\\\"";
+                break;
+            case '\\':
+                result += "\\\\";
+                break;
+            default:
+                if ((unsigned char)ch < 32) {
+                    result += fmt::format("\\u{:04x}", (int)ch);
+                } else {
+                    result.push_back(ch);
+                }
+                break;
+        }
+    }
+
+    return result;
+}
+
+static void Batch_Report(const std::string &seed,
+                         const std::filesystem::path &output, bool success,
+                         u32_t millis) {
+    // the whole line is written at once, so that lines from several
+    // worker processes appending to the same file do not get mixed up.
+    std::string line = fmt::format(
+        "{{\"seed\": \"{}\", \"output\": \"{}\", \"success\": {}, "
+        "\"seconds\": {:.3f}}}\n",
+        JSON_Escape(seed), JSON_Escape(output.generic_string()),
+        success ? "true" : "false", millis / 1000.0);
+
+    std::ofstream fp(batch_report_file, std::ios::out | std::ios::app);
+
+    if (!fp.is_open()) {
+        LogPrintf("Error: unable to write batch report: {}\n",
+                  batch_report_file.string());
+        return;
+    }
+
+    fp << line;
+}
+
+static int Batch_RunSerial(const std::vector<std::string> &seeds) {
+    const std::filesystem::path base_output = batch_output_file;
+
+    int failures = 0;
+
+    for (size_t i = 0; i < seeds.size(); i++) {
+        const std::string &seed = seeds[i];
+
+        LogPrintf("\n==== Farm build {}/{} : seed {} ====\n\n", i + 1,
+                  seeds.size(), seed);
+
+        // same handling as a "seed=xxx" argument on the command line
+        Cookie_LoadString(fmt::format("seed = {}\n", seed), true);
+        did_specify_seed = true;
+
+        batch_output_file = Batch_OutputName(seed);
+
+        const u32_t start_time = TimeGetMillies();
+
+        Main_SetSeed();
+
+        bool result = Build_Cool_Shit();
+
+        const u32_t total_time = TimeGetMillies() - start_time;
+
+        Batch_Report(seed, batch_output_file, result, total_time);
+
+        fmt::print("{} [{}/{}] {} ({:.1f} seconds)\n",
+                   result ? "OK    " : "FAILED", i + 1, seeds.size(),
+                   batch_output_file.string(), total_time / 1000.0);
+
+        if (!result) {
+            failures += 1;
+        }
+
+        batch_output_file = base_output;
+    }
+
+    LogPrintf("\nFarm finished: {} builds, {} failed\n", seeds.size(),
+              failures);
+
+    return (failures > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+//------------------------------------------------------------------------
+
+static std::string Batch_Quote(const std::string &arg) {
+#ifdef _WIN32
+    std::string result = "\"";
+    for (char ch : arg) {
+        if (ch == '"') {
+            result += "\\\"";
+        } else {
+            result.push_back(ch);
+        }
+    }
+    return result + "\"";
+#else
+    std::string result = "'";
+    for (char ch : arg) {
+        if (ch == '\'') {
+            result += "'\\''";
+        } else {
+            result.push_back(ch);
+        }
+    }
+    return result + "'";
+#endif
+}
+
+// rebuild our own command line for a worker, minus the farm options
+// and log file which get replaced.
+static std::string Batch_WorkerCommand(const std::filesystem::path &seed_file,
+                                       const std::filesystem::path &log_file,
+                                       int threads) {
+    std::string cmd = Batch_Quote(argv::list[0]);
+
+    for (size_t i = 1; i < argv::list.size(); i++) {
+        const std::string &arg = argv::list[i];
+
+        if (argv::IsOption(i)) {
+            std::string_view name{arg.data() + 1, arg.size() - 1};
+
+            if (StringCaseCmp(name, "jobs") == 0 ||
+                StringCaseCmp(name, "batch-count") == 0 ||
+                StringCaseCmp(name, "seed-list") == 0 ||
+                StringCaseCmp(name, "log") == 0 ||
+                StringCaseCmp(name, "threads") == 0) {
+                // skip the value too
+                if (i + 1 < argv::list.size() && !argv::IsOption(i + 1)) {
+                    i++;
+                }
+                continue;
+            }
+
+            // long options lost one of their hyphens in argv::Init
+            cmd += (arg.size() > 2) ? " -" : " ";
+        } else {
+            cmd += " ";
+        }
+
+        cmd += Batch_Quote(arg);
+    }
+
+    cmd += " --seed-list " + Batch_Quote(seed_file.string());
+    cmd += " --log " + Batch_Quote(log_file.string());
+    cmd += fmt::format(" --threads {}", threads);
+
+#ifdef _WIN32
+    // cmd.exe strips the outer quotes
+    cmd = "\"" + cmd + "\"";
+#endif
+
+    return cmd;
+}
+
+static int Batch_RunJobs(const std::vector<std::string> &seeds, int jobs) {
+    // divide the threads used for lighting and nodes between the jobs
+    int threads = worker_threads;
+
+    if (threads == 0) {
+        threads = std::max(
+            1, (int)std::thread::hardware_concurrency() / jobs);
+    }
+
+    std::vector<std::filesystem::path> seed_files(jobs);
+    std::vector<std::string> commands(jobs);
+
+    for (int w = 0; w < jobs; w++) {
+        seed_files[w] = batch_report_file;
+        seed_files[w].replace_extension(fmt::format("job{}.seeds", w + 1));
+
+        std::ofstream fp(seed_files[w], std::ios::out | std::ios::trunc);
+
+        if (!fp.is_open()) {
+            Main::FatalError("Cannot create seed list: {}\n",
+                             seed_files[w].string());
+        }
+
+        for (size_t i = w; i < seeds.size(); i += jobs) {
+            fp << seeds[i] << "\n";
+        }
+
+        fp.close();
+
+        std::filesystem::path log_file = logging_file;
+        log_file.replace_extension(fmt::format("job{}.txt", w + 1));
+
+        commands[w] = Batch_WorkerCommand(seed_files[w], log_file, threads);
+
+        LogPrintf("Worker {}: {}\n", w + 1, commands[w]);
+    }
+
+    std::vector<int> results(jobs, 0);
+    std::vector<std::thread> workers;
+
+    for (int w = 0; w < jobs; w++) {
+        workers.emplace_back([&, w]() {
+            results[w] = std::system(commands[w].c_str());
+        });
+    }
+
+    for (std::thread &T : workers) {
+        T.join();
+    }
+
+    int failures = 0;
+
+    for (int w = 0; w < jobs; w++) {
+        std::error_code ec;
+        std::filesystem::remove(seed_files[w], ec);
+
+        if (results[w] != 0) {
+            LogPrintf("Worker {} exited with status {}\n", w + 1,
+                      results[w]);
+            failures += 1;
+        }
+    }
+
+    LogPrintf("\nFarm finished: {} builds in {} jobs, {} jobs failed\n",
+              seeds.size(), jobs, failures);
+
+    return (failures > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int Batch_RunFarm() {
+    std::vector<std::string> seeds = Batch_MakeSeeds();
+
+    if (seeds.empty()) {
+        fmt::print(stderr, "No seeds to build!\n");
+        LogPrintf("No seeds to build!\n");
+        return EXIT_FAILURE;
+    }
+
+    int jobs = std::min(batch_jobs, (int)seeds.size());
+
+    batch_report_file = Batch_MakeReportName();
+
+    LogPrintf("Batch farm: {} builds, {} jobs, report: {}\n", seeds.size(),
+              jobs, batch_report_file.string());
+
+    if (jobs > 1) {
+        return Batch_RunJobs(seeds, jobs);
+    }
+
+    return Batch_RunSerial(seeds);
+}
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
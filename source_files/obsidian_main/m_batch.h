@@ -0,0 +1,46 @@
+//------------------------------------------------------------------------
+//  BATCH FARM : many builds from one process
+//------------------------------------------------------------------------
+//
+//  OBSIDIAN Level Maker
+//
+//  Copyright (C) 2021-2022 The OBSIDIAN Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef __OBSIDIAN_BATCH_H__
+#define __OBSIDIAN_BATCH_H__
+
+#include <filesystem>
+
+// number of builds for --batch-count (0 = not used)
+extern int batch_count;
+
+// number of worker processes for --jobs
+extern int batch_jobs;
+
+// file given to --seed-list (empty = not used)
+extern std::filesystem::path batch_seed_list;
+
+// true when --batch-count or --seed-list was given
+bool Batch_FarmMode();
+
+// run every build of the farm, either in this process or spread over
+// several worker processes.  Scripts must already be loaded.
+// returns the process exit code.
+int Batch_RunFarm();
+
+#endif /* __OBSIDIAN_BATCH_H__ */
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
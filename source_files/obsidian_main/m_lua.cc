@@ -26,6 +26,14 @@
 #include <iso646.h>
 #endif
 #include <array>
+#include <fstream>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
 
 #include "fmt/format.h"
 #ifndef CONSOLE_ONLY
@@ -37,6 +45,7 @@
 #include "lib_file.h"
 #include "lib_signal.h"
 #include "lib_util.h"
+#include "lib_words.h"
 #include "main.h"
 #include "physfs.h"
 #include "sys_xoshiro.h"
@@ -1141,6 +1150,28 @@ int gui_random_int(lua_State *L) {
     return 1;
 }
 
+// LUA: random_word(list_name) --> string
+//
+// picks a word from a list in data/words (loaded on first use), using
+// the same random number that rand.pick() on the whole list would.
+//
+int gui_random_word(lua_State *L) {
+    const char *name = luaL_checkstring(L, 1);
+
+    const word_list_c *list = WordList_Find(name);
+
+    if (!list) {
+        return luaL_error(L, "gui.random_word: unknown word list '%s'", name);
+    }
+
+    // this matches rand.irange(1, count)
+    double count = (double)list->Count();
+    double index = floor(1.0 + xoshiro_Double() * (count - 1 + 0.9999));
+
+    lua_pushstring(L, list->Get((size_t)index - 1));
+    return 1;
+}
+
 // LUA: bit_and(A, B) --> number
 //
 int gui_bit_and(lua_State *L) {
@@ -1337,8 +1368,10 @@ extern int CSG_end_level(lua_State *L);
 extern int CSG_property(lua_State *L);
 extern int CSG_tex_property(lua_State *L);
 extern int CSG_add_brush(lua_State *L);
+extern int CSG_add_brushes(lua_State *L);
 extern int CSG_add_entity(lua_State *L);
 extern int CSG_trace_ray(lua_State *L);
+extern int CSG_trace_rays(lua_State *L);
 
 extern int WF_wolf_block(lua_State *L);
 extern int WF_wolf_read(lua_State *L);
@@ -1439,6 +1472,7 @@ static const luaL_Reg gui_script_funcs[] = {
     {"abort", gui_abort},
     {"random", gui_random},
     {"random_int", gui_random_int},
+    {"random_word", gui_random_word},
 
     // file & directory functions
     {"import", gui_import},
@@ -1455,8 +1489,10 @@ static const luaL_Reg gui_script_funcs[] = {
     {"property", CSG_property},
     {"tex_property", CSG_tex_property},
     {"add_brush", CSG_add_brush},
+    {"add_brushes", CSG_add_brushes},
     {"add_entity", CSG_add_entity},
     {"trace_ray", CSG_trace_ray},
+    {"trace_rays", CSG_trace_rays},
 
     // Mini-Map functions
     {"minimap_disable", gui_minimap_disable},
@@ -1686,76 +1722,192 @@ bool Script_RunString(const char *str, ...)
 }
 */
 
-typedef struct load_info_t {
-    PHYSFS_File *fp;
-    std::string error_msg;
-    char buffer[2048];
+//------------------------------------------------------------------------
+// BYTECODE CACHE
+//------------------------------------------------------------------------
+//
+// When the 'script_cache' option is set, each script is stored as LuaJIT
+// bytecode in a cache directory next to the config file, and that is
+// loaded instead of parsing the source again.  A cache file is only used
+// when the script path and a hash of the source text both match, so
+// editing a script (or an addon replacing it) simply recompiles it.
+// Anything unexpected quietly falls back to loading the source.
+//
 
-} load_info_t;
+bool script_cache = false;
 
-static const char *my_reader(lua_State *L, void *ud, size_t *size) {
-    (void)L;
+static constexpr char script_cache_magic[8] = {'O', 'B', 'L', 'J',
+                                               'B', 'C', '0', '1'};
 
-    load_info_t *info = (load_info_t *)ud;
+// timing / statistics for the startup report
+static int script_load_count = 0;
+static int script_cached_count = 0;
+static u32_t script_load_millis = 0;
 
-    if (PHYSFS_eof(info->fp)) {
-        return NULL;
+static uint64_t Script_HashSource(const std::string &data) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (unsigned char ch : data) {
+        hash = (hash ^ ch) * 0x100000001b3ULL;
     }
 
-    PHYSFS_sint64 len =
-        PHYSFS_readBytes(info->fp, info->buffer, sizeof(info->buffer));
+    return hash;
+}
+
+static std::filesystem::path Script_CacheFile(const std::string &name) {
+    return home_dir / "script_cache" /
+           fmt::format("{:016x}.ljbc", Script_HashSource(name));
+}
 
-    // negative result indicates a "complete failure"
-    if (len < 0) {
-        info->error_msg = PHYSFS_getErrorByCode(PHYSFS_getLastErrorCode());
-        len = 0;
+// header layout: magic, source hash, path length, path, bytecode
+static std::string Script_CacheHeader(const std::string &name,
+                                      uint64_t source_hash) {
+    std::string header(script_cache_magic, sizeof(script_cache_magic));
+
+    header.append((const char *)&source_hash, sizeof(source_hash));
+
+    u32_t name_len = (u32_t)name.size();
+
+    header.append((const char *)&name_len, sizeof(name_len));
+    header.append(name);
+
+    return header;
+}
+
+static bool Script_LoadCached(lua_State *L, const std::string &name,
+                              uint64_t source_hash) {
+    std::ifstream fp(Script_CacheFile(name), std::ios::in | std::ios::binary);
+
+    if (!fp.is_open()) {
+        return false;
     }
 
-    *size = (size_t)len;
+    std::string data{std::istreambuf_iterator<char>(fp),
+                     std::istreambuf_iterator<char>()};
 
-    if (!size) {
-        return NULL;
+    const std::string header = Script_CacheHeader(name, source_hash);
+
+    if (data.size() <= header.size() ||
+        data.compare(0, header.size(), header) != 0) {
+        return false;
     }
 
-    return info->buffer;  // OK
+    // the bytecode keeps the original chunk name, so error messages
+    // and tracebacks are the same as when loading the source.
+    int status = luaL_loadbufferx(L, data.data() + header.size(),
+                                  data.size() - header.size(),
+                                  ("@" + name).c_str(), "b");
+    if (status != 0) {
+        lua_pop(L, 1);  // error message
+        return false;
+    }
+
+    return true;
 }
 
-static int my_loadfile(lua_State *L, const std::filesystem::path &filename) {
-    /* index of filename on the stack */
-    int fnameindex = lua_gettop(L) + 1;
+static int Script_DumpWriter(lua_State *L, const void *p, size_t sz,
+                             void *ud) {
+    (void)L;
 
-    lua_pushfstring(L, "@%s", filename.generic_string().c_str());
+    ((std::string *)ud)->append((const char *)p, sz);
+    return 0;
+}
+
+static void Script_SaveCached(lua_State *L, const std::string &name,
+                              uint64_t source_hash) {
+    std::string data = Script_CacheHeader(name, source_hash);
+
+    // function to dump is on top of the stack
+    if (lua_dump(L, Script_DumpWriter, &data) != 0) {
+        return;
+    }
+
+    std::filesystem::path filename = Script_CacheFile(name);
+
+    std::error_code ec;
+    std::filesystem::create_directories(filename.parent_path(), ec);
+
+    // write to a temporary file first, several processes may be
+    // starting up at the same time.
+    std::filesystem::path temp_name = filename;
+    temp_name += fmt::format(".{}.tmp", getpid());
+
+    {
+        std::ofstream fp(temp_name,
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+
+        if (!fp.is_open()) {
+            return;
+        }
 
-    load_info_t info;
+        fp.write(data.data(), data.size());
 
-    info.fp = PHYSFS_openRead(filename.generic_string().c_str());
-    info.error_msg.clear();
+        if (!fp) {
+            fp.close();
+            std::filesystem::remove(temp_name, ec);
+            return;
+        }
+    }
+
+    std::filesystem::rename(temp_name, filename, ec);
+
+    if (ec) {
+        std::filesystem::remove(temp_name, ec);
+    }
+}
 
-    if (!info.fp) {
+static int my_loadfile(lua_State *L, const std::filesystem::path &filename) {
+    const std::string name = filename.generic_string();
+
+    PHYSFS_File *fp = PHYSFS_openRead(name.c_str());
+
+    if (!fp) {
         lua_pushfstring(L, "file open error: %s",
                         PHYSFS_getErrorByCode(PHYSFS_getLastErrorCode()));
-        lua_remove(L, fnameindex);
+        return LUA_ERRFILE;
+    }
+
+    std::string source;
+
+    PHYSFS_sint64 length = PHYSFS_fileLength(fp);
 
+    if (length > 0) {
+        source.resize(length);
+        length = PHYSFS_readBytes(fp, source.data(), length);
+    }
+
+    // negative result indicates a "complete failure"
+    if (length < 0) {
+        lua_pushstring(
+            L, fmt::format("file read error: {}",
+                           PHYSFS_getErrorByCode(PHYSFS_getLastErrorCode()))
+                   .c_str());
+        PHYSFS_close(fp);
         return LUA_ERRFILE;
     }
 
-    // int status = lua_load(L, my_reader, &info, lua_tostring(L, -1), "bt");
+    PHYSFS_close(fp);
 
-    int status = lua_load(L, my_reader, &info, lua_tostring(L, -1));
+    source.resize(length);
 
-    /* close file (even in case of errors) */
-    PHYSFS_close(info.fp);
+    uint64_t source_hash = 0;
 
-    if (!info.error_msg.empty()) {
-        /* ignore results from 'lua_load' */
-        lua_settop(L, fnameindex);
-        status = LUA_ERRFILE;
+    if (script_cache) {
+        source_hash = Script_HashSource(source);
 
-        lua_pushstring(
-            L, fmt::format("file read error: {}", info.error_msg).c_str());
+        if (Script_LoadCached(L, name, source_hash)) {
+            script_cached_count += 1;
+            return 0;
+        }
     }
 
-    lua_remove(L, fnameindex);
+    int status = luaL_loadbufferx(L, source.data(), source.size(),
+                                  ("@" + name).c_str(), "t");
+
+    if (status == 0 && script_cache) {
+        Script_SaveCached(L, name, source_hash);
+    }
 
     return status;
 }
@@ -1773,8 +1925,13 @@ void Script_Load(std::filesystem::path script_name) {
 
     DebugPrintf(fmt::format("  loading script: '{}'\n", filename).c_str());
 
+    const u32_t start_time = TimeGetMillies();
+
     int status = my_loadfile(LUA_ST, filename);
 
+    script_load_count += 1;
+    script_load_millis += TimeGetMillies() - start_time;
+
     if (status == 0) {
         status = lua_pcall(LUA_ST, 0, 0, 0);
     }
@@ -1791,6 +1948,12 @@ void Script_Open() {
         LogPrintf("\n--- OPENING LUA VM ---\n\n");
     }
 
+    const u32_t start_time = TimeGetMillies();
+
+    script_load_count = 0;
+    script_cached_count = 0;
+    script_load_millis = 0;
+
     // create Lua state
 
     LUA_ST = luaL_newstate();
@@ -1839,6 +2002,14 @@ void Script_Open() {
     }
 
     has_added_buttons = true;
+
+    if (main_action != MAIN_SOFT_RESTART) {
+        LogPrintf("Loaded {} scripts ({} from bytecode cache) in {} seconds\n",
+                  script_load_count, script_cached_count,
+                  script_load_millis / 1000.0);
+        LogPrintf("Script startup took {} seconds\n\n",
+                  (TimeGetMillies() - start_time) / 1000.0);
+    }
 }
 
 void Script_Close() {
@@ -1846,6 +2017,8 @@ void Script_Close() {
         lua_close(LUA_ST);
     }
 
+    WordList_FreeAll();
+
     if (main_action != MAIN_SOFT_RESTART) {
         LogPrintf("\n--- CLOSED LUA VM ---\n\n");
     }
@@ -33,6 +33,9 @@ typedef struct lua_State lua_State;
 void Script_Open();
 void Script_Close();
 
+// when set, scripts are cached as LuaJIT bytecode in the config directory
+extern bool script_cache;
+
 #define MAX_COLOR_MAPS 9  // 1 to 9 (from Lua)
 #define MAX_COLORS_PER_MAP 260
 
@@ -24,6 +24,7 @@
 #include "hdr_fltk.h"
 #include "hdr_ui.h"
 #endif
+#include "dm_prefab.h"
 #include "headers.h"
 #include "lib_argv.h"
 #include "lib_util.h"
@@ -83,6 +84,10 @@ void Parse_Option(const std::string &name, const std::string &value) {
         default_output_path = value;
     } else if (StringCaseCmp(name, "builds_per_run") == 0) {
         builds_per_run = StringToInt(value);
+    } else if (StringCaseCmp(name, "prefab_cache") == 0) {
+        prefab_cache = StringToInt(value) ? true : false;
+    } else if (StringCaseCmp(name, "script_cache") == 0) {
+        script_cache = StringToInt(value) ? true : false;
     } else {
         fmt::print("{} '{}'\n", _("Unknown option: "), name);
     }
@@ -189,6 +194,8 @@ bool Options_Save(std::filesystem::path filename) {
     option_fp << "log_limit = " << log_limit << "\n";
     option_fp << "default_output_path = " << default_output_path << "\n";
     option_fp << "builds_per_run = " << builds_per_run << "\n";
+    option_fp << "prefab_cache = " << (prefab_cache ? 1 : 0) << "\n";
+    option_fp << "script_cache = " << (script_cache ? 1 : 0) << "\n";
 
     option_fp << "\n";
 
@@ -20,12 +20,14 @@
 //------------------------------------------------------------------------
 
 #include <array>
+#include <charconv>
 #include "main.h"
 #include "obsidian_config.h"
 #include "fmt/core.h"
 #include "images.h"
 
 #include "csg_main.h"
+#include "dm_prefab.h"
 #include "g_nukem.h"
 #ifndef CONSOLE_ONLY
 #include "hdr_fltk.h"
@@ -36,6 +38,7 @@
 #include "lib_file.h"
 #include "lib_util.h"
 #include "m_addons.h"
+#include "m_batch.h"
 #include "m_cookie.h"
 #include "m_lua.h"
 #include "m_trans.h"
@@ -157,6 +160,7 @@ int log_size = 7;
 int log_limit = 5;
 bool mid_batch = false;
 int builds_per_run = 1;
+int worker_threads = 0;
 
 int old_x = 0;
 int old_y = 0;
@@ -279,6 +283,11 @@ static void ShowInfo() {
         "  -a --addon    <file>...   Addon(s) to use\n"
         "  -l --load     <file>      Load settings from a file\n"
         "  -k --keep                 Keep SEED from loaded settings\n"
+        "     --threads  <count>     Worker threads for lighting/nodes (0 = auto)\n"
+        "\n"
+        "     --batch-count <count>  Build this many outputs, one per seed\n"
+        "     --seed-list   <file>   Build one output for each seed in a file\n"
+        "     --jobs     <count>     Number of builds to run at the same time\n"
         "\n"
         "     --randomize-all        Randomize all options\n"
         "     --randomize-arch       Randomize architecture settings\n"
@@ -999,6 +1008,9 @@ void Main::Detail::Shutdown(const bool error) {
         Options_Save(options_file);
     }
 #endif
+    if (!error) {
+        Prefab_CloseCache();
+    }
     Script_Close();
     LogClose();
 }
@@ -1083,7 +1095,17 @@ static void Module_Defaults() {
 
 //------------------------------------------------------------------------
 
+// for reporting the time from launch to the first build
+static u32_t launch_time;
+static bool did_first_build = false;
+
 bool Build_Cool_Shit() {
+    if (!did_first_build) {
+        did_first_build = true;
+        LogPrintf("Time from launch to first build: {} seconds\n\n",
+                  (TimeGetMillies() - launch_time) / 1000.0);
+    }
+
 #ifndef CONSOLE_ONLY
     // clear the map
     if (main_win) {
@@ -1223,8 +1245,55 @@ bool Build_Cool_Shit() {
     return was_ok;
 }
 
+// the count given after an option such as --threads.  A missing or
+// non-numeric count is a fatal error.
+static int Options_ParseCount(int arg, const char *name) {
+    int count = 0;
+
+    if (arg + 1 < (int)argv::list.size() && !argv::IsOption(arg + 1)) {
+        const std::string &value = argv::list[arg + 1];
+
+        auto [end, ec] = std::from_chars(value.data(),
+                                         value.data() + value.size(), count);
+
+        if (ec == std::errc() && end == value.data() + value.size()) {
+            return count;
+        }
+
+        fmt::print(stderr, "OBSIDIAN ERROR: bad count for --{}: {}\n", name,
+                   value);
+        exit(EXIT_FAILURE);
+    }
+
+    fmt::print(stderr, "OBSIDIAN ERROR: missing count for --{}\n", name);
+    exit(EXIT_FAILURE);
+}
+
 void Options_ParseArguments() {
 
+    if (const int threads_arg = argv::Find(0, "threads"); threads_arg >= 0) {
+        worker_threads = MAX(0, Options_ParseCount(threads_arg, "threads"));
+    }
+
+    if (const int count_arg = argv::Find(0, "batch-count"); count_arg >= 0) {
+        batch_count = MAX(1, Options_ParseCount(count_arg, "batch-count"));
+    }
+
+    if (const int list_arg = argv::Find(0, "seed-list"); list_arg >= 0) {
+        if (list_arg + 1 >= (int)argv::list.size() ||
+            argv::IsOption(list_arg + 1)) {
+            fmt::print(stderr,
+                       "OBSIDIAN ERROR: missing filename for --seed-list\n");
+            exit(EXIT_FAILURE);
+        }
+
+        batch_seed_list = argv::list[list_arg + 1];
+    }
+
+    if (const int jobs_arg = argv::Find(0, "jobs"); jobs_arg >= 0) {
+        batch_jobs = MAX(1, Options_ParseCount(jobs_arg, "jobs"));
+    }
+
     if (argv::Find(0, "randomize-all") >= 0) {
         if (batch_mode) {
             batch_randomize_groups.push_back("architecture");
@@ -1265,6 +1334,8 @@ skiprest:;
 /* ----- main program ----------------------------- */
 
 int main(int argc, char **argv) {
+    launch_time = TimeGetMillies();
+
     // initialise argument parser (skipping program name)
 
     // these flags take at least one argument
@@ -1595,6 +1666,12 @@ softrestart:;
             return EXIT_FAILURE;
         }
 
+        if (Batch_FarmMode()) {
+            int result = Batch_RunFarm();
+            Main::Detail::Shutdown(false);
+            return result;
+        }
+
         Main_SetSeed();
         if (!Build_Cool_Shit()) {
             fmt::print(stderr, "FAILED!\n");
@@ -185,6 +185,7 @@ extern int log_limit;
 extern bool first_run;
 extern bool mid_batch;
 extern int builds_per_run;
+extern int worker_threads;
 
 extern std::string def_filename;
 
@@ -204,6 +205,9 @@ extern std::string default_output_path;
 
 extern std::filesystem::path Resolve_DefaultOutputPath();
 
+void Main_SetSeed();
+bool Build_Cool_Shit();
+
 extern std::filesystem::path gif_filename;
 
 extern std::string string_seed;
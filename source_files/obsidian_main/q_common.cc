@@ -148,19 +148,76 @@ void qLump_c::SetCRLF(bool enable) { crlf = enable; }
 
 //------------------------------------------------------------------------
 
-#define PLANE_HASH_SIZE 128
+index_hash_c::index_hash_c() : slots(), hashes(), used(0) {}
+
+index_hash_c::~index_hash_c() {}
+
+void index_hash_c::Clear() {
+    slots.clear();
+    hashes.clear();
+
+    used = 0;
+}
+
+void index_hash_c::Insert(u32_t hash, int index) {
+    // keep the table at most half full
+    if ((used + 1) * 2 > slots.size()) {
+        Grow();
+    }
+
+    size_t mask = slots.size() - 1;
+    size_t pos = hash & mask;
+
+    while (slots[pos] != 0) {
+        pos = (pos + 1) & mask;
+    }
+
+    slots[pos] = (u32_t)index + 1;
+    hashes[pos] = hash;
+
+    used += 1;
+}
+
+void index_hash_c::Grow() {
+    std::vector<u32_t> old_slots;
+    std::vector<u32_t> old_hashes;
+
+    old_slots.swap(slots);
+    old_hashes.swap(hashes);
+
+    size_t new_size = old_slots.empty() ? 256 : old_slots.size() * 2;
+
+    slots.assign(new_size, 0);
+    hashes.assign(new_size, 0);
+
+    used = 0;
+
+    for (size_t i = 0; i < old_slots.size(); i++) {
+        if (old_slots[i] != 0) {
+            Insert(old_hashes[i], (int)old_slots[i] - 1);
+        }
+    }
+}
+
+u32_t QCOM_HashValues(const u32_t *values, int count) {
+    u32_t hash = 0;
+
+    for (int i = 0; i < count; i++) {
+        hash = IntHash(hash ^ values[i]);
+    }
+
+    return hash;
+}
+
+//------------------------------------------------------------------------
 
 static std::vector<dplane_t> bsp_planes;
 
-static std::vector<int> *plane_hashtab[PLANE_HASH_SIZE];
+static index_hash_c plane_hash;
 
 static void BSP_ClearPlanes() {
     bsp_planes.clear();
-
-    for (int h = 0; h < PLANE_HASH_SIZE; h++) {
-        delete plane_hashtab[h];
-        plane_hashtab[h] = NULL;
-    }
+    plane_hash.Clear();
 }
 
 static void BSP_PreparePlanes() { BSP_ClearPlanes(); }
@@ -187,10 +244,6 @@ static u16_t AddRawPlane(const dplane_t *plane, bool *was_new) {
         raw_plane.dist = +0.0f;
     }
 
-    int hash = I_ROUND(raw_plane.dist * 1.1);
-
-    hash = hash & (PLANE_HASH_SIZE - 1);
-
     // fix endianness
     raw_plane.normal[0] = LE_Float32(raw_plane.normal[0]);
     raw_plane.normal[1] = LE_Float32(raw_plane.normal[1]);
@@ -199,24 +252,24 @@ static u16_t AddRawPlane(const dplane_t *plane, bool *was_new) {
     raw_plane.dist = LE_Float32(raw_plane.dist);
     raw_plane.type = LE_S32(raw_plane.type);
 
-    // look for it in hash table...
+    // look for it in hash table, which uses every field (after the
+    // fixes above, identical planes have identical bits).
 
-    *was_new = false;
+    static_assert(sizeof(dplane_t) == 5 * sizeof(u32_t));
 
-    if (!plane_hashtab[hash]) {
-        plane_hashtab[hash] = new std::vector<int>;
-    }
+    u32_t key[5];
+    memcpy(key, &raw_plane, sizeof(key));
 
-    std::vector<int> *hashtab = plane_hashtab[hash];
+    u32_t hash = QCOM_HashValues(key, 5);
 
-    for (unsigned int i = 0; i < hashtab->size(); i++) {
-        int index = (*hashtab)[i];
+    *was_new = false;
 
-        SYS_ASSERT(index < (int)bsp_planes.size());
+    int index = plane_hash.Find(hash, [&](int other) {
+        return memcmp(&raw_plane, &bsp_planes[other], sizeof(raw_plane)) == 0;
+    });
 
-        if (memcmp(&raw_plane, &bsp_planes[index], sizeof(raw_plane)) == 0) {
-            return index;  // found it
-        }
+    if (index >= 0) {
+        return index;  // found it
     }
 
     // not found, so add new one...
@@ -225,7 +278,7 @@ static u16_t AddRawPlane(const dplane_t *plane, bool *was_new) {
 
     bsp_planes.push_back(raw_plane);
 
-    hashtab->push_back(new_index);
+    plane_hash.Insert(hash, new_index);
 
 #if 0  // DEBUG
 fprintf(stderr, "ADDED PLANE #%d : %08x %08x %08x d:%08x tp:%08x\n",
@@ -352,19 +405,13 @@ void BSP_WritePlanes(int lump_num, int max_planes) {
 
 //------------------------------------------------------------------------
 
-#define VERTEX_HASH_SIZE 512
-
 static std::vector<dvertex_t> bsp_vertices;
 
-static std::vector<int> *vert_hashtab[VERTEX_HASH_SIZE];
+static index_hash_c vert_hash;
 
 static void BSP_ClearVertices() {
     bsp_vertices.clear();
-
-    for (int h = 0; h < VERTEX_HASH_SIZE; h++) {
-        delete vert_hashtab[h];
-        vert_hashtab[h] = NULL;
-    }
+    vert_hash.Clear();
 }
 
 static void BSP_PrepareVertices() {
@@ -378,10 +425,6 @@ static void BSP_PrepareVertices() {
 }
 
 u16_t BSP_AddVertex(float x, float y, float z) {
-    int hash = I_ROUND(x * 1.1);
-
-    hash = hash & (VERTEX_HASH_SIZE - 1);
-
     // create on-disk vertex, fixing endianness
     dvertex_t raw_vert;
 
@@ -390,20 +433,21 @@ u16_t BSP_AddVertex(float x, float y, float z) {
     raw_vert.z = LE_Float32(z);
 
     // find existing vertex...
-    // for speed we use a hash-table
+    // for speed we use a hash-table, keyed on all three coordinates
 
-    if (!vert_hashtab[hash]) {
-        vert_hashtab[hash] = new std::vector<int>;
-    }
+    static_assert(sizeof(dvertex_t) == 3 * sizeof(u32_t));
 
-    std::vector<int> *hashtab = vert_hashtab[hash];
+    u32_t key[3];
+    memcpy(key, &raw_vert, sizeof(key));
 
-    for (unsigned int i = 0; i < hashtab->size(); i++) {
-        int index = (*hashtab)[i];
+    u32_t hash = QCOM_HashValues(key, 3);
 
-        if (memcmp(&raw_vert, &bsp_vertices[index], sizeof(raw_vert)) == 0) {
-            return index;  // found it!
-        }
+    int index = vert_hash.Find(hash, [&](int other) {
+        return memcmp(&raw_vert, &bsp_vertices[other], sizeof(raw_vert)) == 0;
+    });
+
+    if (index >= 0) {
+        return index;  // found it!
     }
 
     // not found, so add new one...
@@ -412,7 +456,7 @@ u16_t BSP_AddVertex(float x, float y, float z) {
 
     bsp_vertices.push_back(raw_vert);
 
-    hashtab->push_back(new_index);
+    vert_hash.Insert(hash, new_index);
 
     return new_index;
 }
@@ -438,11 +482,11 @@ void BSP_WriteVertices(int lump_num, int max_verts) {
 
 static std::vector<dedge_t> bsp_edges;
 
-static std::map<u32_t, s32_t> bsp_edge_map;
+static index_hash_c edge_hash;
 
 static void BSP_ClearEdges() {
     bsp_edges.clear();
-    bsp_edge_map.clear();
+    edge_hash.Clear();
 }
 
 static void BSP_PrepareEdges() {
@@ -464,24 +508,29 @@ s32_t BSP_AddEdge(u16_t start, u16_t end) {
         flipped = true;
     }
 
-    // find existing edge...
-    u32_t key = (u32_t)start + (u32_t)(end << 16);
-
-    if (bsp_edge_map.find(key) != bsp_edge_map.end()) {
-        return bsp_edge_map[key] * (flipped ? -1 : 1);
-    }
-
-    // not found, so add new one...
     dedge_t raw_edge;
 
     raw_edge.v[0] = LE_U16(start);
     raw_edge.v[1] = LE_U16(end);
 
+    // find existing edge...
+    u32_t key = (u32_t)start + ((u32_t)end << 16);
+    u32_t hash = QCOM_HashValues(&key, 1);
+
+    int index = edge_hash.Find(hash, [&](int other) {
+        return memcmp(&raw_edge, &bsp_edges[other], sizeof(raw_edge)) == 0;
+    });
+
+    if (index >= 0) {
+        return flipped ? -index : index;
+    }
+
+    // not found, so add new one...
     int new_index = (int)bsp_edges.size();
 
     bsp_edges.push_back(raw_edge);
 
-    bsp_edge_map[key] = new_index;
+    edge_hash.Insert(hash, new_index);
 
     return flipped ? -new_index : new_index;
 }
@@ -691,7 +740,7 @@ void BSP_WriteEntities(int lump_num, const char *description) {
 
     if (ob_world) {
         for (PI = ob_world->props.begin(); PI != ob_world->props.end(); PI++) {
-            lump->KeyPair(PI->first.c_str(), "%s", PI->second.c_str());
+            lump->KeyPair(PI->Key().c_str(), "%s", PI->value.c_str());
         }
     }
 
@@ -725,7 +774,7 @@ void BSP_WriteEntities(int lump_num, const char *description) {
 
         // write entity properties
         for (PI = E->props.begin(); PI != E->props.end(); PI++) {
-            lump->KeyPair(PI->first.c_str(), "%s", PI->second.c_str());
+            lump->KeyPair(PI->Key().c_str(), "%s", PI->value.c_str());
         }
 
         // skip origin when same as default value
@@ -72,6 +72,56 @@ class qLump_c {
     void RawPrintf(const char *str);
 };
 
+class index_hash_c {
+    // An open-addressing hash table of indices into an array kept by
+    // the caller (the planes, vertices, etc).  The caller computes the
+    // hash of the whole item, and Find() is given a function to test
+    // if a candidate index matches.  Nothing is allocated per entry.
+
+   private:
+    // index + 1 of each slot, zero when the slot is empty
+    std::vector<u32_t> slots;
+
+    // full hash of each slot, so growing does not need the items
+    std::vector<u32_t> hashes;
+
+    size_t used;
+
+   public:
+    index_hash_c();
+    ~index_hash_c();
+
+    void Clear();
+
+    template <typename MATCH_FUNC>
+    int Find(u32_t hash, MATCH_FUNC match) const {
+        if (slots.empty()) {
+            return -1;
+        }
+
+        size_t mask = slots.size() - 1;
+
+        for (size_t pos = hash & mask;; pos = (pos + 1) & mask) {
+            if (slots[pos] == 0) {
+                return -1;
+            }
+
+            if (hashes[pos] == hash && match((int)slots[pos] - 1)) {
+                return (int)slots[pos] - 1;
+            }
+        }
+    }
+
+    // index must not already be present
+    void Insert(u32_t hash, int index);
+
+   private:
+    void Grow();
+};
+
+// mixes the bits of some 32-bit values into a hash value
+u32_t QCOM_HashValues(const u32_t *values, int count);
+
 /***** VARIABLES ****************/
 
 extern int qk_game;
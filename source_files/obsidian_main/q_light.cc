@@ -26,6 +26,8 @@
 
 #include "q_light.h"
 
+#include <algorithm>
+
 #include "csg_main.h"
 #include "csg_quake.h"
 #include "fmt/core.h"
@@ -35,6 +37,7 @@
 #endif
 #include "headers.h"
 #include "lib_file.h"
+#include "lib_thread.h"
 #include "lib_util.h"
 #include "main.h"
 #include "q_common.h"
@@ -495,11 +498,11 @@ void QLIT_FreeLightmaps() {
 }
 
 static qLightmap_c *QLIT_NewLightmap(int w, int h) {
-    qLightmap_c *lmap = new qLightmap_c(w, h);
-
-    qk_all_lightmaps.push_back(lmap);
+    // NOTE: this may be called from a worker thread, hence the new
+    //       lightmap is added to qk_all_lightmaps[] later on (in the
+    //       same order as the faces) by QLIT_AddLightmap().
 
-    return lmap;
+    return new qLightmap_c(w, h);
 }
 
 static void WriteFlatBlock(int level, int count) {
@@ -574,31 +577,44 @@ typedef struct {
 
 } light_point_t;
 
-// Lighting variables
+#define MAX_LM_SIZE 64
 
-static quake_face_c *lt_face;
+// Lighting variables.
+// there is one of these per worker thread, since faces are lit
+// in parallel (see QLIT_LightAllFaces).
 
-static double lt_plane_normal[3];
-static double lt_plane_dist;
+struct light_context_t {
+    quake_face_c *face;
 
-static quake_bbox_c lt_face_bbox;
+    double plane_normal[3];
+    double plane_dist;
 
-static int lt_W, lt_H;
+    quake_bbox_c face_bbox;
 
-static int lt_current_style;
+    int W, H;
 
-#define MAX_LM_SIZE 64
+    int current_style;
 
-static light_point_t lt_points[MAX_LM_SIZE * 2][MAX_LM_SIZE * 2];
+    // lights which might reach the current face, from light_cells_c.
+    // normal lights are used in the first pass, styled ones later.
+    std::vector<int> normal_lights;
+    std::vector<int> styled_lights;
 
-static int blocklights[MAX_LM_SIZE * 2][MAX_LM_SIZE * 2][3];
+    // statistics
+    size_t light_tests;
+    size_t light_rejects;
 
-static void Q1_CalcFaceStuff(quake_face_c *F) {
-    lt_plane_normal[0] = F->plane.nx;
-    lt_plane_normal[1] = F->plane.ny;
-    lt_plane_normal[2] = F->plane.nz;
+    light_point_t points[MAX_LM_SIZE * 2][MAX_LM_SIZE * 2];
 
-    lt_plane_dist = F->plane.CalcDist();
+    int blocklights[MAX_LM_SIZE * 2][MAX_LM_SIZE * 2][3];
+};
+
+static void Q1_CalcFaceStuff(light_context_t &lt, quake_face_c *F) {
+    lt.plane_normal[0] = F->plane.nx;
+    lt.plane_normal[1] = F->plane.ny;
+    lt.plane_normal[2] = F->plane.nz;
+
+    lt.plane_dist = F->plane.CalcDist();
 
     /* Calc Vectors... */
 
@@ -618,7 +634,7 @@ static void Q1_CalcFaceStuff(quake_face_c *F) {
 
     // calculate a normal to the texture axis.  points can be moved
     // along this without changing their S/T
-    static quake_plane_c texnormal;
+    quake_plane_c texnormal;
 
     texnormal.nx = UV->s[2] * UV->t[1] - UV->s[1] * UV->t[2];
     texnormal.ny = UV->s[0] * UV->t[2] - UV->s[2] * UV->t[0];
@@ -627,9 +643,9 @@ static void Q1_CalcFaceStuff(quake_face_c *F) {
     texnormal.Normalize();
 
     // flip it towards plane normal
-    double distscale = texnormal.nx * lt_plane_normal[0] +
-                       texnormal.ny * lt_plane_normal[1] +
-                       texnormal.nz * lt_plane_normal[2];
+    double distscale = texnormal.nx * lt.plane_normal[0] +
+                       texnormal.ny * lt.plane_normal[1] +
+                       texnormal.nz * lt.plane_normal[2];
 
     if (distscale < 0) {
         distscale = -distscale;
@@ -645,9 +661,9 @@ static void Q1_CalcFaceStuff(quake_face_c *F) {
                         lt_worldtotex[i][1] * lt_worldtotex[i][1] +
                         lt_worldtotex[i][2] * lt_worldtotex[i][2];
 
-        double dist = lt_worldtotex[i][0] * lt_plane_normal[0] +
-                      lt_worldtotex[i][1] * lt_plane_normal[1] +
-                      lt_worldtotex[i][2] * lt_plane_normal[2];
+        double dist = lt_worldtotex[i][0] * lt.plane_normal[0] +
+                      lt_worldtotex[i][1] * lt.plane_normal[1] +
+                      lt_worldtotex[i][2] * lt.plane_normal[2];
 
         dist = dist * distscale / len_sq;
 
@@ -668,9 +684,9 @@ static void Q1_CalcFaceStuff(quake_face_c *F) {
 
     // AJA: I assume the "- 1" here means the sampling points are 1 unit
     //      away from the face.
-    double o_dist = lt_texorg[0] * lt_plane_normal[0] +
-                    lt_texorg[1] * lt_plane_normal[1] +
-                    lt_texorg[2] * lt_plane_normal[2] - lt_plane_dist - 1.0;
+    double o_dist = lt_texorg[0] * lt.plane_normal[0] +
+                    lt_texorg[1] * lt.plane_normal[1] +
+                    lt_texorg[2] * lt.plane_normal[2] - lt.plane_dist - 1.0;
 
     o_dist *= distscale;
 
@@ -701,12 +717,12 @@ static void Q1_CalcFaceStuff(quake_face_c *F) {
     lt_tex_mins[0] = bmin_s;
     lt_tex_mins[1] = bmin_t;
 
-    lt_W = MAX(2, bmax_s - bmin_s + 1);
-    lt_H = MAX(2, bmax_t - bmin_t + 1);
+    lt.W = MAX(2, bmax_s - bmin_s + 1);
+    lt.H = MAX(2, bmax_t - bmin_t + 1);
 
-    /// fprintf(stderr, "FACE %p  EXTENTS %d %d\n", F, lt_W, lt_H);
+    /// fprintf(stderr, "FACE %p  EXTENTS %d %d\n", F, lt.W, lt.H);
 
-    F->lmap = QLIT_NewLightmap(lt_W, lt_H);
+    F->lmap = QLIT_NewLightmap(lt.W, lt.H);
 
     /* Calc Points... */
 
@@ -718,19 +734,19 @@ static void Q1_CalcFaceStuff(quake_face_c *F) {
 
     if (q_light_quality > 0)  // "best" mode
     {
-        s_step = 16 * (lt_W - 1) / (float)(lt_W * 2 - 1);
-        t_step = 16 * (lt_H - 1) / (float)(lt_H * 2 - 1);
+        s_step = 16 * (lt.W - 1) / (float)(lt.W * 2 - 1);
+        t_step = 16 * (lt.H - 1) / (float)(lt.H * 2 - 1);
 
-        lt_W *= 2;
-        lt_H *= 2;
+        lt.W *= 2;
+        lt.H *= 2;
     }
 
-    for (int t = 0; t < lt_H; t++) {
-        for (int s = 0; s < lt_W; s++) {
+    for (int t = 0; t < lt.H; t++) {
+        for (int s = 0; s < lt.W; s++) {
             float us = s_start + s * s_step;
             float ut = t_start + t * t_step;
 
-            light_point_t &P = lt_points[s][t];
+            light_point_t &P = lt.points[s][t];
 
             P.x = lt_texorg[0] + lt_textoworld[0][0] * us +
                   lt_textoworld[1][0] * ut;
@@ -794,7 +810,7 @@ static bool CheckLightPoint(light_point_t &P, quake_face_c *F, double s,
     return !(P.medium == MEDIUM_OFF_FACE || P.medium == MEDIUM_SOLID);
 }
 
-static void Q3_CalcFaceStuff(quake_face_c *F) {
+static void Q3_CalcFaceStuff(light_context_t &lt, quake_face_c *F) {
     float px = F->plane.x;
     float py = F->plane.y;
     float pz = F->plane.z;
@@ -807,11 +823,11 @@ static void Q3_CalcFaceStuff(quake_face_c *F) {
     // [ i.e. vert[i] * N == n_dist, where '*' is dot product ]
     double n_dist = px * nx + py * ny + pz * nz;
 
-    lt_plane_normal[0] = nx;
-    lt_plane_normal[1] = ny;
-    lt_plane_normal[2] = nz;
+    lt.plane_normal[0] = nx;
+    lt.plane_normal[1] = ny;
+    lt.plane_normal[2] = nz;
 
-    lt_plane_dist = F->plane.CalcDist();
+    lt.plane_dist = F->plane.CalcDist();
 
     // compute T vector that basically goes "up" the slope of the
     // face's plane.  If the plane is purely vertical, direction of
@@ -904,15 +920,13 @@ static void Q3_CalcFaceStuff(quake_face_c *F) {
 #endif
 
     // compute size of lightmap
-    lt_W = (int)ceil((max_s - min_s + q3_luxel_size * 0.6) / q3_luxel_size);
-    lt_H = (int)ceil((max_t - min_t + q3_luxel_size * 0.6) / q3_luxel_size);
+    lt.W = (int)ceil((max_s - min_s + q3_luxel_size * 0.6) / q3_luxel_size);
+    lt.H = (int)ceil((max_t - min_t + q3_luxel_size * 0.6) / q3_luxel_size);
 
-    fmt::print(stderr, "LM SIZE: %d x {}\n", lt_W, lt_H);
+    lt.W = CLAMP(1, lt.W, MAX_LM_SIZE);
+    lt.H = CLAMP(1, lt.H, MAX_LM_SIZE);
 
-    lt_W = CLAMP(1, lt_W, MAX_LM_SIZE);
-    lt_H = CLAMP(1, lt_H, MAX_LM_SIZE);
-
-    F->lmap = QLIT_NewLightmap(lt_W, lt_H);
+    F->lmap = QLIT_NewLightmap(lt.W, lt.H);
 
     // compute the UV matrix...
     // [ the offsets in s[3] and t[3] are updated later, when block is allocated
@@ -920,8 +934,8 @@ static void Q3_CalcFaceStuff(quake_face_c *F) {
 
     uv_matrix_c *mat = F->lmap->lm_mat;
 
-    double s3 = (lt_W - 1) / (double)LIGHTMAP_WIDTH;
-    double t3 = (lt_H - 1) / (double)LIGHTMAP_HEIGHT;
+    double s3 = (lt.W - 1) / (double)LIGHTMAP_WIDTH;
+    double t3 = (lt.H - 1) / (double)LIGHTMAP_HEIGHT;
 
     double s_mul = s3 / (max_s - min_s);
     double t_mul = t3 / (max_t - min_t);
@@ -951,31 +965,31 @@ static void Q3_CalcFaceStuff(quake_face_c *F) {
     // create the points...
 
     // nudge amounts
-    double s_nudge = 0.6 / (lt_W + 1);
-    double t_nudge = 0.6 / (lt_H + 1);
+    double s_nudge = 0.6 / (lt.W + 1);
+    double t_nudge = 0.6 / (lt.H + 1);
 
     const float away = 0.5;
 
     if (q_light_quality > 0) {
-        lt_W *= 2;
-        lt_H *= 2;
+        lt.W *= 2;
+        lt.H *= 2;
     }
 
-    for (int py = 0; py < lt_H; py++) {
-        for (int px = 0; px < lt_W; px++) {
-            float ax = (lt_W == 1) ? 0.5 : px / (float)(lt_W - 1);
-            float ay = (lt_H == 1) ? 0.5 : py / (float)(lt_H - 1);
+    for (int py = 0; py < lt.H; py++) {
+        for (int px = 0; px < lt.W; px++) {
+            float ax = (lt.W == 1) ? 0.5 : px / (float)(lt.W - 1);
+            float ay = (lt.H == 1) ? 0.5 : py / (float)(lt.H - 1);
 
             ax = 0.5 + (ax - 0.5) * 0.98;
             ay = 0.5 + (ay - 0.5) * 0.98;
 
-            light_point_t &P = lt_points[px][py];
+            light_point_t &P = lt.points[px][py];
 
             // if the point is off the face or inside a solid brush,
             // try some locations closer to the middle of the face.
             for (int nudge = 0; nudge < 4; nudge++) {
-                double s = (lt_W == 1) ? avg_s : (min_s + (max_s - min_s) * ax);
-                double t = (lt_H == 1) ? avg_t : (min_t + (max_t - min_t) * ay);
+                double s = (lt.W == 1) ? avg_s : (min_s + (max_s - min_s) * ax);
+                double t = (lt.H == 1) ? avg_t : (min_t + (max_t - min_t) * ay);
 
                 if (nudge > 0) {
                     // nudge coordinate towards center of face
@@ -1003,19 +1017,19 @@ static void Q3_CalcFaceStuff(quake_face_c *F) {
     }
 }
 
-static void ClearLightBuffer(int level) {
+static void ClearLightBuffer(light_context_t &lt, int level) {
     level <<= 8;
 
-    for (int s = 0; s < lt_W; s++) {
-        for (int t = 0; t < lt_H; t++) {
+    for (int s = 0; s < lt.W; s++) {
+        for (int t = 0; t < lt.H; t++) {
             for (int c = 0; c < 3; c++) {
-                blocklights[s][t][c] = level;
+                lt.blocklights[s][t][c] = level;
             }
         }
     }
 }
 
-void qLightmap_c::Store() {
+void qLightmap_c::Store(const light_context_t &lt) {
     rgb_color_t *dest = current_pos;
 
     float scale = q_light_scale / 1024.0;
@@ -1028,9 +1042,9 @@ void qLightmap_c::Store() {
 
     for (int t = 0; t < height; t++) {
         for (int s = 0; s < width; s++) {
-            float r = blocklights[s][t][0] * scale;
-            float g = blocklights[s][t][1] * scale;
-            float b = blocklights[s][t][2] * scale;
+            float r = lt.blocklights[s][t][0] * scale;
+            float g = lt.blocklights[s][t][1] * scale;
+            float b = lt.blocklights[s][t][2] * scale;
 
             float ity = MAX(r, MAX(g, b));
 
@@ -1050,56 +1064,80 @@ void qLightmap_c::Store() {
         }
     }
 
+    // for Q3, a lightmap which is not dark gets placed into a
+    // light block later, see Q3_PlaceLightmap().
     if (qk_game >= 3 && isDark()) {
         fmt::print(stderr, "DARK LIGHTMAP !\n");
         offset = 0;
-    } else if (qk_game >= 3) {
-        // this is lousy for memory usage...
-        // [ but some stuff is using samples[], like CalcAverage() ]
+    }
+}
 
-        offset = Q3_AllocLightBlock(width, height, &lx, &ly);
-        SYS_ASSERT(offset >= 0);
+static void Q3_PlaceLightmap(qLightmap_c *lmap) {
+    // this is lousy for memory usage...
+    // [ but some stuff is using samples[], like CalcAverage() ]
 
-        fmt::print(stderr, "LM POSITION: block #{} ({:3} {})\n", offset, lx,
-                   ly);
+    // already handled (dark) ?
+    if (lmap->offset >= 0) {
+        return;
+    }
 
-        double s1 = (lx + 0.5) / (double)LIGHTMAP_WIDTH;
-        double t1 = (ly + 0.5) / (double)LIGHTMAP_HEIGHT;
+    int width = lmap->width;
+    int height = lmap->height;
 
-        lm_mat->s[3] += s1;
-        lm_mat->t[3] += t1;
+    lmap->offset = Q3_AllocLightBlock(width, height, &lmap->lx, &lmap->ly);
+    SYS_ASSERT(lmap->offset >= 0);
 
-        q3_lightmap_block_c *BL = all_q3_light_blocks[offset];
-        SYS_ASSERT(BL);
+    fmt::print(stderr, "LM POSITION: block #{} ({:3} {})\n", lmap->offset,
+               lmap->lx, lmap->ly);
 
-        for (int y = 0; y < height; y++) {
-            for (int x = 0; x < width; x++) {
-                const rgb_color_t col = At(x, y);
+    double s1 = (lmap->lx + 0.5) / (double)LIGHTMAP_WIDTH;
+    double t1 = (lmap->ly + 0.5) / (double)LIGHTMAP_HEIGHT;
 
-                const int bx = lx + x;
-                const int by = ly + y;
+    lmap->lm_mat->s[3] += s1;
+    lmap->lm_mat->t[3] += t1;
 
-                BL->samples[bx][by][0] = RGB_RED(col);
-                BL->samples[bx][by][1] = RGB_GREEN(col);
-                BL->samples[bx][by][2] = RGB_BLUE(col);
-            }
+    q3_lightmap_block_c *BL = all_q3_light_blocks[lmap->offset];
+    SYS_ASSERT(BL);
+
+    // only the first style is stored in the block
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const rgb_color_t col = lmap->samples[y * width + x];
+
+            const int bx = lmap->lx + x;
+            const int by = lmap->ly + y;
+
+            BL->samples[bx][by][0] = RGB_RED(col);
+            BL->samples[bx][by][1] = RGB_GREEN(col);
+            BL->samples[bx][by][2] = RGB_BLUE(col);
         }
     }
 }
 
-static bool Luxel_HasSetNeighbor(int s, int t) {
+static void QLIT_AddLightmap(quake_face_c *F) {
+    // must be called in face order, so that the lightmap lump and
+    // the Q3 light blocks do not depend on the number of threads.
+
+    qk_all_lightmaps.push_back(F->lmap);
+
+    if (qk_game >= 3) {
+        Q3_PlaceLightmap(F->lmap);
+    }
+}
+
+static bool Luxel_HasSetNeighbor(const light_context_t &lt, int s, int t) {
     for (int side = 0; side < 4; side++) {
         int ds = (side == 0) ? -1 : (side == 1) ? +1 : 0;
         int dt = (side == 2) ? -1 : (side == 3) ? +1 : 0;
 
-        if (s + ds < 0 || s + ds >= lt_W) {
+        if (s + ds < 0 || s + ds >= lt.W) {
             continue;
         }
-        if (t + dt < 0 || t + dt >= lt_H) {
+        if (t + dt < 0 || t + dt >= lt.H) {
             continue;
         }
 
-        if (lt_points[s + ds][t + dt].medium < MEDIUM_SOLID) {
+        if (lt.points[s + ds][t + dt].medium < MEDIUM_SOLID) {
             return true;
         }
     }
@@ -1107,7 +1145,8 @@ static bool Luxel_HasSetNeighbor(int s, int t) {
     return false;
 }
 
-static void Luxel_ComputeAverage(int s, int t, bool do_avg) {
+static void Luxel_ComputeAverage(light_context_t &lt, int s, int t,
+                                 bool do_avg) {
     int total = 0;
 
     int sum_r = 0;
@@ -1118,36 +1157,36 @@ static void Luxel_ComputeAverage(int s, int t, bool do_avg) {
         int ds = (side == 0) ? -1 : (side == 1) ? +1 : 0;
         int dt = (side == 2) ? -1 : (side == 3) ? +1 : 0;
 
-        if (s + ds < 0 || s + ds >= lt_W) {
+        if (s + ds < 0 || s + ds >= lt.W) {
             continue;
         }
-        if (t + dt < 0 || t + dt >= lt_H) {
+        if (t + dt < 0 || t + dt >= lt.H) {
             continue;
         }
 
-        if (lt_points[s + ds][t + dt].medium >= MEDIUM_SOLID) {
+        if (lt.points[s + ds][t + dt].medium >= MEDIUM_SOLID) {
             continue;
         }
 
-        if (!do_avg && lt_points[s + ds][t + dt].medium == MEDIUM_AVERAGED) {
+        if (!do_avg && lt.points[s + ds][t + dt].medium == MEDIUM_AVERAGED) {
             continue;
         }
 
-        sum_r += blocklights[s + ds][t + dt][0];
-        sum_g += blocklights[s + ds][t + dt][1];
-        sum_b += blocklights[s + ds][t + dt][2];
+        sum_r += lt.blocklights[s + ds][t + dt][0];
+        sum_g += lt.blocklights[s + ds][t + dt][1];
+        sum_b += lt.blocklights[s + ds][t + dt][2];
 
         total += 1;
     }
 
     if (total > 0) {
-        blocklights[s][t][0] = sum_r / total;
-        blocklights[s][t][1] = sum_g / total;
-        blocklights[s][t][2] = sum_b / total;
+        lt.blocklights[s][t][0] = sum_r / total;
+        lt.blocklights[s][t][1] = sum_g / total;
+        lt.blocklights[s][t][2] = sum_b / total;
     }
 }
 
-static void HandleOffFaceLuxels() {
+static void HandleOffFaceLuxels(light_context_t &lt) {
     // set luxels in blocklights[] which are off the face or
     // underneath a solid brush to the average of nearby luxels.
     //
@@ -1159,16 +1198,16 @@ static void HandleOffFaceLuxels() {
         where.clear();
 
         // find all unset points with at least one set neighbor
-        for (int s = 0; s < lt_W; s++) {
-            for (int t = 0; t < lt_H; t++) {
-                if (lt_points[s][t].medium >= MEDIUM_SOLID &&
-                    Luxel_HasSetNeighbor(s, t)) {
+        for (int s = 0; s < lt.W; s++) {
+            for (int t = 0; t < lt.H; t++) {
+                if (lt.points[s][t].medium >= MEDIUM_SOLID &&
+                    Luxel_HasSetNeighbor(lt, s, t)) {
                     where.push_back((t << 10) + s);
 
                     // this logic means that we ignore AVERAGED neighbors
                     // unless none of them has come from a real light.
-                    Luxel_ComputeAverage(s, t, true /* do_avg */);
-                    Luxel_ComputeAverage(s, t, false);
+                    Luxel_ComputeAverage(lt, s, t, true /* do_avg */);
+                    Luxel_ComputeAverage(lt, s, t, false);
                 }
             }
         }
@@ -1182,27 +1221,27 @@ static void HandleOffFaceLuxels() {
             int s = where[k] & 1023;
             int t = where[k] >> 10;
 
-            lt_points[s][t].medium = MEDIUM_AVERAGED;
+            lt.points[s][t].medium = MEDIUM_AVERAGED;
         }
     }
 }
 
-static void FilterSuperSamples() {
+static void FilterSuperSamples(light_context_t &lt) {
     // the "best" mode visits 4 times as many points as normal,
     // then computes the average of each 2x2 block.
 
-    int W = lt_W / 2;
-    int H = lt_H / 2;
+    int W = lt.W / 2;
+    int H = lt.H / 2;
 
     for (int t = 0; t < H; t++) {
         for (int s = 0; s < W; s++) {
             for (int c = 0; c < 3; c++) {
-                int v = blocklights[s * 2 + 0][t * 2 + 0][c] +
-                        blocklights[s * 2 + 0][t * 2 + 1][c] +
-                        blocklights[s * 2 + 1][t * 2 + 0][c] +
-                        blocklights[s * 2 + 1][t * 2 + 1][c];
+                int v = lt.blocklights[s * 2 + 0][t * 2 + 0][c] +
+                        lt.blocklights[s * 2 + 0][t * 2 + 1][c] +
+                        lt.blocklights[s * 2 + 1][t * 2 + 0][c] +
+                        lt.blocklights[s * 2 + 1][t * 2 + 1][c];
 
-                blocklights[s][t][c] = v >> 2;
+                lt.blocklights[s][t][c] = v >> 2;
             }
         }
     }
@@ -1212,7 +1251,172 @@ static void FilterSuperSamples() {
 
 std::vector<quake_light_t> qk_all_lights;
 
-static void QLIT_FreeLights() { qk_all_lights.clear(); }
+// lights (except suns) are binned into a coarse grid of cells, so that
+// each face only needs to look at the lights which can touch it.
+#define LIGHT_CELL_SIZE 512
+#define LIGHT_CELL_MAX 64
+
+class light_cells_c {
+   public:
+    double origin[3];
+    double size[3];
+    int count[3];
+
+    // lights for each cell, in the same order as qk_all_lights (which
+    // matters for the order styles are added to a lightmap).
+    std::vector<std::vector<int>> normal;
+    std::vector<std::vector<int>> styled;
+
+    // sun lights are not limited by distance
+    std::vector<int> sun_normal;
+    std::vector<int> sun_styled;
+
+   public:
+    light_cells_c() : normal(), styled(), sun_normal(), sun_styled() {
+        double lo[3] = {0, 0, 0};
+        double hi[3] = {0, 0, 0};
+
+        bool first = true;
+
+        for (const quake_light_t &light : qk_all_lights) {
+            if (light.kind == LTK_Sun) {
+                continue;
+            }
+
+            double pos[3] = {light.x, light.y, light.z};
+
+            for (int b = 0; b < 3; b++) {
+                double L = pos[b] - light.radius - 1;
+                double H = pos[b] + light.radius + 1;
+
+                lo[b] = first ? L : std::min(lo[b], L);
+                hi[b] = first ? H : std::max(hi[b], H);
+            }
+
+            first = false;
+        }
+
+        for (int b = 0; b < 3; b++) {
+            origin[b] = lo[b];
+
+            count[b] = (int)ceil((hi[b] - lo[b]) / LIGHT_CELL_SIZE);
+            count[b] = std::max(1, std::min(count[b], LIGHT_CELL_MAX));
+
+            size[b] = std::max(1.0, (hi[b] - lo[b]) / count[b]);
+        }
+
+        normal.resize(count[0] * count[1] * count[2]);
+        styled.resize(normal.size());
+
+        for (int k = 0; k < (int)qk_all_lights.size(); k++) {
+            const quake_light_t &light = qk_all_lights[k];
+
+            if (light.kind == LTK_Sun) {
+                (light.style ? sun_styled : sun_normal).push_back(k);
+                continue;
+            }
+
+            // a bit bigger than the light, to allow for rounding in the
+            // quake_bbox_c::Touches() test done later.
+            double pos[3] = {light.x, light.y, light.z};
+            double lo[3], hi[3];
+
+            for (int b = 0; b < 3; b++) {
+                lo[b] = pos[b] - light.radius - 1;
+                hi[b] = pos[b] + light.radius + 1;
+            }
+
+            int c1[3], c2[3];
+
+            if (!CellRange(lo, hi, c1, c2)) {
+                continue;
+            }
+
+            for (int cz = c1[2]; cz <= c2[2]; cz++) {
+                for (int cy = c1[1]; cy <= c2[1]; cy++) {
+                    for (int cx = c1[0]; cx <= c2[0]; cx++) {
+                        int idx = Index(cx, cy, cz);
+
+                        (light.style ? styled : normal)[idx].push_back(k);
+                    }
+                }
+            }
+        }
+    }
+
+    ~light_cells_c() {}
+
+    inline int Index(int cx, int cy, int cz) const {
+        return (cz * count[1] + cy) * count[0] + cx;
+    }
+
+    // finds the lights which may touch the bounding box, in the same
+    // order as qk_all_lights.
+    void Query(const quake_bbox_c &bbox, std::vector<int> &normal_list,
+               std::vector<int> &styled_list) const {
+        normal_list = sun_normal;
+        styled_list = sun_styled;
+
+        double lo[3] = {bbox.mins[0], bbox.mins[1], bbox.mins[2]};
+        double hi[3] = {bbox.maxs[0], bbox.maxs[1], bbox.maxs[2]};
+
+        int c1[3], c2[3];
+
+        if (CellRange(lo, hi, c1, c2)) {
+            for (int cz = c1[2]; cz <= c2[2]; cz++) {
+                for (int cy = c1[1]; cy <= c2[1]; cy++) {
+                    for (int cx = c1[0]; cx <= c2[0]; cx++) {
+                        int idx = Index(cx, cy, cz);
+
+                        normal_list.insert(normal_list.end(),
+                                           normal[idx].begin(),
+                                           normal[idx].end());
+                        styled_list.insert(styled_list.end(),
+                                           styled[idx].begin(),
+                                           styled[idx].end());
+                    }
+                }
+            }
+        }
+
+        SortUnique(normal_list);
+        SortUnique(styled_list);
+    }
+
+   private:
+    // returns false if the box is completely outside the grid
+    bool CellRange(const double *lo, const double *hi, int *c1,
+                   int *c2) const {
+        for (int b = 0; b < 3; b++) {
+            double a1 = floor((lo[b] - origin[b]) / size[b]);
+            double a2 = floor((hi[b] - origin[b]) / size[b]);
+
+            if (a2 < 0 || a1 >= count[b]) {
+                return false;
+            }
+
+            c1[b] = (int)std::max(a1, 0.0);
+            c2[b] = (int)std::min(a2, count[b] - 1.0);
+        }
+
+        return true;
+    }
+
+    static void SortUnique(std::vector<int> &list) {
+        std::sort(list.begin(), list.end());
+
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+};
+
+static light_cells_c *qk_light_cells;
+
+static void QLIT_FreeLights() {
+    qk_all_lights.clear();
+
+    delete qk_light_cells;
+    qk_light_cells = NULL;
+}
 
 static void QLIT_FindLights() {
     QLIT_FreeLights();
@@ -1254,94 +1458,156 @@ static void QLIT_FindLights() {
 
         qk_all_lights.push_back(light);
     }
+
+    qk_light_cells = new light_cells_c;
+
+    LogPrintf("binned lights into {}x{}x{} cells\n", qk_light_cells->count[0],
+              qk_light_cells->count[1], qk_light_cells->count[2]);
 }
 
-static inline void Bump(int s, int t, int value, rgb_color_t color) {
-    blocklights[s][t][0] += value * RGB_RED(color);
-    blocklights[s][t][1] += value * RGB_GREEN(color);
-    blocklights[s][t][2] += value * RGB_BLUE(color);
+static inline void Bump(light_context_t &lt, int s, int t, int value,
+                        rgb_color_t color) {
+    lt.blocklights[s][t][0] += value * RGB_RED(color);
+    lt.blocklights[s][t][1] += value * RGB_GREEN(color);
+    lt.blocklights[s][t][2] += value * RGB_BLUE(color);
 }
 
-static void QLIT_ProcessLight(qLightmap_c *lmap, quake_light_t &light,
-                              int pass) {
+// luxels are traced in square tiles of this size, so that the rays
+// in a packet are close together.
+#define LUXEL_TILE 4
+
+static_assert(LUXEL_TILE * LUXEL_TILE <= TRACE_PACKET_SIZE);
+
+static bool QLIT_LightPacket(light_context_t &lt, const quake_light_t &light,
+                             const trace_packet_t &packet, const int *luxels) {
+    // luxels[] holds the (s, t) of each ray in the packet.
+    // returns true if any of the luxels can see the light.
+
+    bool results[TRACE_PACKET_SIZE];
+
+    QVIS_TracePacket(packet, results);
+
+    bool hit_it = false;
+
+    for (int i = 0; i < packet.count; i++) {
+        if (!results[i]) {
+            continue;
+        }
+
+        int s = luxels[i * 2 + 0];
+        int t = luxels[i * 2 + 1];
+
+        const light_point_t &P = lt.points[s][t];
+
+        hit_it = true;
+
+        if (light.kind == LTK_Sun) {
+            Bump(lt, s, t, (int)light.level, light.color);
+        } else {
+            float dist = ComputeDist(P.x, P.y, P.z, light.x, light.y, light.z);
+
+            if (dist < light.radius) {
+                int value = light.level * (1.0 - dist / light.radius);
+
+                Bump(lt, s, t, value, light.color);
+            }
+        }
+    }
+
+    return hit_it;
+}
+
+static bool QLIT_ProcessLight(light_context_t &lt, qLightmap_c *lmap,
+                              const quake_light_t &light, int pass) {
+    // returns false if the light was rejected without tracing any rays.
+
     // first pass is normal lights, other passes are for styled lights
     if (pass == 0) {
         if (light.style) {
-            return;
+            return false;
         }
     } else {
         if (light.style == 0) {
-            return;
+            return false;
         }
 
         // skip light if we processed that style in an earlier pass
-        if (lt_current_style < 0 && lmap->hasStyle(light.style)) {
-            return;
+        if (lt.current_style < 0 && lmap->hasStyle(light.style)) {
+            return false;
         }
 
         // skip light unless it matches the current style
-        if (lt_current_style > 0 && light.style != lt_current_style) {
-            return;
+        if (lt.current_style > 0 && light.style != lt.current_style) {
+            return false;
         }
     }
 
     // skip lights which are behind the face
-    float perp = lt_plane_normal[0] * light.x + lt_plane_normal[1] * light.y +
-                 lt_plane_normal[2] * light.z - lt_plane_dist;
+    float perp = lt.plane_normal[0] * light.x + lt.plane_normal[1] * light.y +
+                 lt.plane_normal[2] * light.z - lt.plane_dist;
 
     if (perp <= 0) {
-        return;
+        return false;
     }
 
     // skip lights which are too far away
     if (light.kind == LTK_Sun) {
         if (qk_game < 3) {
-            SYS_ASSERT(lt_face->leaf);
+            SYS_ASSERT(lt.face->leaf);
 
-            if (lt_face->leaf->cluster &&
-                lt_face->leaf->cluster->ambient_dists[AMBIENT_SKY] > 4) {
-                return;
+            if (lt.face->leaf->cluster &&
+                lt.face->leaf->cluster->ambient_dists[AMBIENT_SKY] > 4) {
+                return false;
             }
         }
     } else {
         if (perp > light.radius) {
-            return;
+            return false;
         }
 
-        if (!lt_face_bbox.Touches(light.x, light.y, light.z, light.radius)) {
-            return;
+        if (!lt.face_bbox.Touches(light.x, light.y, light.z, light.radius)) {
+            return false;
         }
     }
 
     bool hit_it = false;
 
-    for (int t = 0; t < lt_H; t++) {
-        for (int s = 0; s < lt_W; s++) {
-            const light_point_t &P = lt_points[s][t];
+    trace_packet_t packet;
+    int luxels[TRACE_PACKET_SIZE * 2];
 
-            // ignore liquids, off-face points and points blocked by solids
-            if (P.medium > MEDIUM_AIR) {
-                continue;
-            }
+    for (int t1 = 0; t1 < lt.H; t1 += LUXEL_TILE) {
+        for (int s1 = 0; s1 < lt.W; s1 += LUXEL_TILE) {
+            packet.count = 0;
 
-            if (!QVIS_TraceRay(P.x, P.y, P.z, light.x, light.y, light.z)) {
-                continue;
-            }
+            for (int t = t1; t < MIN(t1 + LUXEL_TILE, lt.H); t++) {
+                for (int s = s1; s < MIN(s1 + LUXEL_TILE, lt.W); s++) {
+                    const light_point_t &P = lt.points[s][t];
 
-            hit_it = true;
+                    // ignore liquids, off-face points and points blocked
+                    // by solids
+                    if (P.medium > MEDIUM_AIR) {
+                        continue;
+                    }
 
-            if (light.kind == LTK_Sun) {
-                Bump(s, t, (int)light.level, light.color);
-            } else {
-                float dist =
-                    ComputeDist(P.x, P.y, P.z, light.x, light.y, light.z);
+                    int k = packet.count++;
 
-                if (dist < light.radius) {
-                    int value = light.level * (1.0 - dist / light.radius);
+                    packet.x1[k] = P.x;
+                    packet.y1[k] = P.y;
+                    packet.z1[k] = P.z;
 
-                    Bump(s, t, value, light.color);
+                    packet.x2[k] = light.x;
+                    packet.y2[k] = light.y;
+                    packet.z2[k] = light.z;
+
+                    luxels[k * 2 + 0] = s;
+                    luxels[k * 2 + 1] = t;
                 }
             }
+
+            if (packet.count > 0 &&
+                QLIT_LightPacket(lt, light, packet, luxels)) {
+                hit_it = true;
+            }
         }
     }
 
@@ -1349,20 +1615,22 @@ static void QLIT_ProcessLight(qLightmap_c *lmap, quake_light_t &light,
     // touched the face (e.g. when on the other side of a wall).
 
     if (!hit_it) {
-        return;
+        return true;
     }
 
-    if (lt_current_style < 0) {
-        lt_current_style = light.style;
+    if (lt.current_style < 0) {
+        lt.current_style = light.style;
 
         lmap->AddStyle(light.style);
     }
+
+    return true;
 }
 
-static void QLIT_LiquidLighting(qLightmap_c *lmap) {
-    for (int t = 0; t < lt_H; t++) {
-        for (int s = 0; s < lt_W; s++) {
-            const light_point_t &P = lt_points[s][t];
+static void QLIT_LiquidLighting(light_context_t &lt, qLightmap_c *lmap) {
+    for (int t = 0; t < lt.H; t++) {
+        for (int s = 0; s < lt.W; s++) {
+            const light_point_t &P = lt.points[s][t];
 
             if (P.medium >= MEDIUM_WATER && P.medium <= MEDIUM_LAVA) {
                 liquid_coloring_t &LC = (P.medium == MEDIUM_SLIME)  ? q_slime
@@ -1376,20 +1644,20 @@ static void QLIT_LiquidLighting(qLightmap_c *lmap) {
                     (fx + fy) * LC.intensity - P.liquid_depth * LC.dropoff;
 
                 if (level > 0) {
-                    Bump(s, t, level, LC.color);
+                    Bump(lt, s, t, level, LC.color);
                 }
             }
         }
     }
 }
 
-void QLIT_TestingStuff(qLightmap_c *lmap) {
+void QLIT_TestingStuff(const light_context_t &lt, qLightmap_c *lmap) {
     int W = lmap->width;
     int H = lmap->height;
 
     for (int t = 0; t < H; t++) {
         for (int s = 0; s < W; s++) {
-            const light_point_t &P = lt_points[s][t];
+            const light_point_t &P = lt.points[s][t];
 
             int r = 40 + 10 * sin(P.x / 40.0);
             int g = 80 + 40 * sin(P.y / 40.0);
@@ -1407,41 +1675,55 @@ void QLIT_TestingStuff(qLightmap_c *lmap) {
     }
 }
 
-void QLIT_LightFace(quake_face_c *F) {
-    lt_face = F;
+static void QLIT_LightFace(light_context_t &lt, quake_face_c *F) {
+    lt.face = F;
 
-    F->GetBounds(&lt_face_bbox);
+    F->GetBounds(&lt.face_bbox);
 
     if (qk_game < 3) {
-        Q1_CalcFaceStuff(F);
+        Q1_CalcFaceStuff(lt, F);
     } else {
-        Q3_CalcFaceStuff(F);
+        Q3_CalcFaceStuff(lt, F);
     }
 
 #if 0  // DEBUG
-    QLIT_TestingStuff(F->lmap);
+    QLIT_TestingStuff(lt, F->lmap);
     return;
 #endif
 
+    qk_light_cells->Query(lt.face_bbox, lt.normal_lights, lt.styled_lights);
+
     for (int pass = 0; pass < 4; pass++) {
-        lt_current_style = (pass == 0) ? 0 : -1;
+        const std::vector<int> &lights =
+            (pass == 0) ? lt.normal_lights : lt.styled_lights;
+
+        // nothing left to do when no styled lights are nearby
+        if (pass > 0 && lights.empty()) {
+            break;
+        }
+
+        lt.current_style = (pass == 0) ? 0 : -1;
+
+        ClearLightBuffer(lt, pass ? 0 : q_low_light);
 
-        ClearLightBuffer(pass ? 0 : q_low_light);
+        for (int k : lights) {
+            lt.light_tests += 1;
 
-        for (unsigned int i = 0; i < qk_all_lights.size(); i++) {
-            QLIT_ProcessLight(F->lmap, qk_all_lights[i], pass);
+            if (!QLIT_ProcessLight(lt, F->lmap, qk_all_lights[k], pass)) {
+                lt.light_rejects += 1;
+            }
         }
 
         if (pass == 0) {
-            QLIT_LiquidLighting(F->lmap);
+            QLIT_LiquidLighting(lt, F->lmap);
 
-            HandleOffFaceLuxels();
+            HandleOffFaceLuxels(lt);
 
             if (q_light_quality > 0) {
-                FilterSuperSamples();
+                FilterSuperSamples(lt);
             }
 
-            F->lmap->Store();
+            F->lmap->Store(lt);
         }
     }
 }
@@ -1570,6 +1852,7 @@ static void Q3_ProcessLightForGrid(quake_light_t &light, float gx, float gy,
 }
 
 static void Q3_VisitGridPoint(float gx, float gy, float gz,
+                              const std::vector<int> &lights,
                               dlightgrid3_t *out) {
     memset(out, 0, sizeof(dlightgrid3_t));
 
@@ -1636,7 +1919,7 @@ static void Q3_VisitGridPoint(float gx, float gy, float gz,
     std::array<int, 3> best_dir_color;
     std::array<float, 3> best_direction;
 
-    for (unsigned int k = 0; k < qk_all_lights.size(); k++) {
+    for (int k : lights) {
         int r, g, b, ity;
 
         Q3_ProcessLightForGrid(qk_all_lights[k], gx, gy, gz, &r, &g, &b);
@@ -1682,6 +1965,102 @@ static void Q3_VisitGridPoint(float gx, float gy, float gz,
 
 #define LUMP_Q3_LIGHTGRID 15
 
+// grid points are binned into blocks of this many points (along each
+// axis), and each bin knows which lights can reach any of its points.
+#define GRID_BIN_POINTS 4
+
+class grid_light_bins_c {
+   public:
+    int count[3];
+
+    // lights for each bin, in the same order as qk_all_lights (which
+    // matters for picking the strongest light).
+    std::vector<std::vector<int>> lists;
+
+   public:
+    grid_light_bins_c(const float *g_mins, const int *g_count) : lists() {
+        for (int b = 0; b < 3; b++) {
+            count[b] = (g_count[b] + GRID_BIN_POINTS - 1) / GRID_BIN_POINTS;
+        }
+
+        lists.resize(count[0] * count[1] * count[2]);
+
+        for (int bz = 0; bz < count[2]; bz++) {
+            for (int by = 0; by < count[1]; by++) {
+                for (int bx = 0; bx < count[0]; bx++) {
+                    std::vector<int> &list = lists[Index(bx, by, bz)];
+
+                    // bounding box of every spot in the bin, including
+                    // the nudges done by Q3_VisitGridPoint.
+                    int bin[3] = {bx, by, bz};
+
+                    double lo[3];
+                    double hi[3];
+
+                    for (int b = 0; b < 3; b++) {
+                        float block_size = (b < 2) ? 64.0 : 128.0;
+
+                        int first = bin[b] * GRID_BIN_POINTS;
+                        int last = std::min(first + GRID_BIN_POINTS,
+                                            g_count[b]) - 1;
+
+                        lo[b] = g_mins[b] + first * block_size;
+                        hi[b] = g_mins[b] + last * block_size;
+                    }
+
+                    lo[0] -= 18;
+                    lo[1] -= 18;
+                    lo[2] -= 24;
+
+                    hi[0] += 18;
+                    hi[1] += 18;
+                    hi[2] += 36;
+
+                    for (int k = 0; k < (int)qk_all_lights.size(); k++) {
+                        if (CanReach(qk_all_lights[k], lo, hi)) {
+                            list.push_back(k);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    ~grid_light_bins_c() {}
+
+    inline int Index(int bx, int by, int bz) const {
+        return (bz * count[1] + by) * count[0] + bx;
+    }
+
+    const std::vector<int> &ForPoint(int xnum, int ynum, int znum) const {
+        return lists[Index(xnum / GRID_BIN_POINTS, ynum / GRID_BIN_POINTS,
+                           znum / GRID_BIN_POINTS)];
+    }
+
+   private:
+    static bool CanReach(const quake_light_t &light, const double *lo,
+                         const double *hi) {
+        if (light.kind == LTK_Sun) {
+            return true;
+        }
+
+        double pos[3] = {light.x, light.y, light.z};
+        double dist_sq = 0;
+
+        for (int b = 0; b < 3; b++) {
+            double d = std::max(lo[b] - pos[b], std::max(0.0, pos[b] - hi[b]));
+
+            dist_sq += d * d;
+        }
+
+        // a little leeway, so rounding cannot drop a light which
+        // Q3_ProcessLightForGrid would use.
+        double limit = light.radius + 1.0;
+
+        return dist_sq < limit * limit;
+    }
+};
+
 static void Q3_GridLighting() {
     // world mins / maxs
     float w_mins[3];
@@ -1701,28 +2080,50 @@ static void Q3_GridLighting() {
         g_maxs[b] = block_size * floor(w_maxs[b] / block_size);
 
         g_count[b] = (g_maxs[b] - g_mins[b]) / block_size + 1;
+        g_count[b] = MAX(0, g_count[b]);
     }
 
     LogPrintf("grid counts: {} x {} x {}\n", g_count[0], g_count[1],
               g_count[2]);
 
-    qLump_c *lump = BSP_NewLump(LUMP_Q3_LIGHTGRID);
+    const u32_t start_time = TimeGetMillies();
+
+    grid_light_bins_c bins(g_mins, g_count);
 
-    dlightgrid3_t raw_point;
+    // every grid point is independent, so each row of points is done
+    // by a worker thread and stored in its place in the final lump.
+
+    std::vector<dlightgrid3_t> points(g_count[0] * g_count[1] * g_count[2]);
+
+    Thread_ParallelFor(
+        g_count[1] * g_count[2],
+        [&](int row, int /*worker*/) {
+            int ynum = row % g_count[1];
+            int znum = row / g_count[1];
 
-    for (int znum = 0; znum < g_count[2]; znum++) {
-        for (int ynum = 0; ynum < g_count[1]; ynum++) {
             for (int xnum = 0; xnum < g_count[0]; xnum++) {
                 float gx = g_mins[0] + xnum * 64.0;
                 float gy = g_mins[1] + ynum * 64.0;
                 float gz = g_mins[2] + znum * 128.0;
 
-                Q3_VisitGridPoint(gx, gy, gz, &raw_point);
-
-                lump->Append(&raw_point, sizeof(raw_point));
+                Q3_VisitGridPoint(gx, gy, gz, bins.ForPoint(xnum, ynum, znum),
+                                  &points[row * g_count[0] + xnum]);
             }
-        }
-    }
+        },
+        []() {
+#ifndef CONSOLE_ONLY
+            Main::Ticker();
+#endif
+            // the grid must be complete, so there is no cancelling
+            return true;
+        });
+
+    qLump_c *lump = BSP_NewLump(LUMP_Q3_LIGHTGRID);
+
+    lump->Append(points.data(), points.size() * sizeof(dlightgrid3_t));
+
+    LogPrintf("lit {} grid points in {:.2f} seconds\n", points.size(),
+              (TimeGetMillies() - start_time) / 1000.0);
 }
 
 void Q3_InitSharedBlock() {
@@ -1731,6 +2132,78 @@ void Q3_InitSharedBlock() {
     Q3_AllocLightBlock(2, 2, &bx, &by);
 }
 
+// number of lights considered for a face, and how many of those were
+// rejected without needing to trace any rays.
+static size_t qk_light_tests;
+static size_t qk_light_rejects;
+
+static light_context_t *QLIT_NewContext() {
+    light_context_t *lt = new light_context_t;
+
+    lt->light_tests = 0;
+    lt->light_rejects = 0;
+
+    return lt;
+}
+
+static void QLIT_FreeContext(light_context_t *lt) {
+    qk_light_tests += lt->light_tests;
+    qk_light_rejects += lt->light_rejects;
+
+    delete lt;
+}
+
+static void QLIT_LightFacesSerial(const std::vector<quake_face_c *> &faces) {
+    light_context_t *lt = QLIT_NewContext();
+
+    for (unsigned int i = 0; i < faces.size(); i++) {
+        QLIT_LightFace(*lt, faces[i]);
+
+        if ((i + 1) % 400 == 0) {
+#ifndef CONSOLE_ONLY
+            Main::Ticker();
+#endif
+
+            if (main_action >= MAIN_CANCEL) {
+                break;
+            }
+        }
+    }
+
+    QLIT_FreeContext(lt);
+}
+
+static void QLIT_LightFacesParallel(const std::vector<quake_face_c *> &faces,
+                                    int num_workers) {
+    // each face only writes to its own lightmap, and everything else
+    // it reads (brushes, trace nodes, lights) is not modified while
+    // lighting, so faces can be processed in any order.
+
+    LogPrintf("lighting with {} threads\n", num_workers);
+
+    std::vector<light_context_t *> contexts(num_workers);
+
+    for (int w = 0; w < num_workers; w++) {
+        contexts[w] = QLIT_NewContext();
+    }
+
+    Thread_ParallelFor(
+        (int)faces.size(),
+        [&](int index, int worker) {
+            QLIT_LightFace(*contexts[worker], faces[index]);
+        },
+        []() {
+#ifndef CONSOLE_ONLY
+            Main::Ticker();
+#endif
+            return main_action < MAIN_CANCEL;
+        });
+
+    for (int w = 0; w < num_workers; w++) {
+        QLIT_FreeContext(contexts[w]);
+    }
+}
+
 void QLIT_LightAllFaces() {
     LogPrintf("\nLighting World...\n");
 
@@ -1744,11 +2217,10 @@ void QLIT_LightAllFaces() {
 
     QVIS_MakeTraceNodes();
 
-    int lit_faces = 0;
-    int lit_luxels = 0;
-
     // visit all faces, including Q3 detail and map-model faces
 
+    std::vector<quake_face_c *> faces;
+
     for (unsigned int i = 0; i < qk_all_faces.size(); i++) {
         quake_face_c *F = qk_all_faces[i];
 
@@ -1756,27 +2228,46 @@ void QLIT_LightAllFaces() {
             continue;
         }
 
-        QLIT_LightFace(F);
+        faces.push_back(F);
+    }
 
-        lit_faces++;
-        lit_luxels += F->lmap->width * F->lmap->height;
+    const u32_t start_time = TimeGetMillies();
 
-        if (lit_faces % 400 == 0) {
-#ifndef CONSOLE_ONLY
-            Main::Ticker();
-#endif
+    qk_light_tests = 0;
+    qk_light_rejects = 0;
 
-            if (main_action >= MAIN_CANCEL) {
-                break;
-            }
+    int num_workers = Thread_WorkerCount();
+
+    if (num_workers > 1) {
+        QLIT_LightFacesParallel(faces, num_workers);
+    } else {
+        QLIT_LightFacesSerial(faces);
+    }
+
+    int lit_faces = 0;
+    int lit_luxels = 0;
+
+    for (unsigned int i = 0; i < faces.size(); i++) {
+        quake_face_c *F = faces[i];
 
-            // fprintf(stderr, "lit %d faces (of %u)\n", lit_faces,
-            // qk_all_faces.size());
+        // not lit when the user cancelled
+        if (!F->lmap) {
+            continue;
         }
+
+        QLIT_AddLightmap(F);
+
+        lit_faces++;
+        lit_luxels += F->lmap->width * F->lmap->height;
     }
 
-    LogPrintf("lit {} faces (of {}) using {} luxels\n", lit_faces,
-              qk_all_faces.size(), lit_luxels);
+    LogPrintf("lit {} faces (of {}) using {} luxels in {:.2f} seconds\n",
+              lit_faces, qk_all_faces.size(), lit_luxels,
+              (TimeGetMillies() - start_time) / 1000.0);
+
+    LogPrintf("tested {} nearby lights ({} per face), {} rejected\n",
+              qk_light_tests, qk_light_tests / std::max(1, lit_faces),
+              qk_light_rejects);
 
     // for Q3, determine grid lighting
     if (qk_game >= 3) {
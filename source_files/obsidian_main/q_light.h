@@ -32,6 +32,8 @@
 class quake_face_c;
 class uv_matrix_c;
 
+struct light_context_t;
+
 // the maximum size of a face's lightmap in Quake I/II
 constexpr int FLAT_LIGHTMAP_SIZE = 17 * 17;
 
@@ -75,8 +77,8 @@ class qLightmap_c {
     // true if all samples are zero
     bool isDark() const;
 
-    // transfer from blocklights[] array
-    void Store();
+    // transfer from blocklights[] array of the context
+    void Store(const light_context_t &lt);
 
     void Write(qLump_c *lump);
 };
@@ -190,29 +190,22 @@ class infinite_line_c {
     }
 };
 
-#define INF_LINE_HASH_SIZE 1024
-
 static std::vector<infinite_line_c> infinite_lines;
 
-static std::vector<int> *inf_line_hashtab[INF_LINE_HASH_SIZE];
+static index_hash_c inf_line_hash;
 
 static int tjunc_count;
 
 static void TJ_InitHash() {
     infinite_lines.clear();
-
-    memset(inf_line_hashtab, 0, sizeof(inf_line_hashtab));
+    inf_line_hash.Clear();
 
     tjunc_count = 0;
 }
 
 static void TJ_FreeHash() {
     infinite_lines.clear();
-
-    for (unsigned int i = 0; i < INF_LINE_HASH_SIZE; i++) {
-        delete inf_line_hashtab[i];
-        inf_line_hashtab[i] = NULL;
-    }
+    inf_line_hash.Clear();
 }
 
 static infinite_line_c *TJ_HashLookup(const quake_vertex_c &A,
@@ -224,22 +217,13 @@ static infinite_line_c *TJ_HashLookup(const quake_vertex_c &A,
     IL.Set(A, B);
     IL.MakeConsistent();
 
-    int hash = IL.CalcHash() & (INF_LINE_HASH_SIZE - 1);
+    u32_t hash = (u32_t)IL.CalcHash();
 
-    if (!inf_line_hashtab[hash]) {
-        inf_line_hashtab[hash] = new std::vector<int>;
-    }
+    int found = inf_line_hash.Find(
+        hash, [&](int other) { return infinite_lines[other].Match(IL); });
 
-    std::vector<int> *hashtab = inf_line_hashtab[hash];
-
-    for (unsigned int i = 0; i < hashtab->size(); i++) {
-        int index = (*hashtab)[i];
-
-        infinite_line_c *test = &infinite_lines[index];
-
-        if (test->Match(IL)) {
-            return test;
-        }
+    if (found >= 0) {
+        return &infinite_lines[found];
     }
 
     // not found, make new one
@@ -252,7 +236,7 @@ static infinite_line_c *TJ_HashLookup(const quake_vertex_c &A,
 
     infinite_lines.push_back(IL);
 
-    hashtab->push_back(index);
+    inf_line_hash.Insert(hash, index);
 
     return &infinite_lines.back();
 }
@@ -31,12 +31,19 @@
 #include "csg_quake.h"
 #include "headers.h"
 #include "lib_file.h"
+#include "lib_thread.h"
 #include "lib_util.h"
 #include "main.h"
 #include "q_common.h"
 #include "q_light.h"
 #include "vis_buffer.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRACE_USE_SSE2 1
+#endif
+
 //------------------------------------------------------------------------
 //  RAY TRACING
 //------------------------------------------------------------------------
@@ -236,6 +243,275 @@ static int RecursiveTestRay(int nodenum, float x1, float y1, float z1, float x2,
     }
 }
 
+//------------------------------------------------------------------------
+
+// A packet is traced through the nodes together, splitting off the
+// rays which go a different way at each node.  Every ray does exactly
+// the same calculations as RecursiveTestRay(), so the results match.
+
+typedef u32_t trace_mask_t;
+
+static_assert(TRACE_PACKET_SIZE <= 32, "trace_mask_t is too small");
+static_assert(TRACE_PACKET_SIZE % 4 == 0, "packet must be whole SSE vectors");
+
+#ifndef TRACE_PACKET_MIN
+#define TRACE_PACKET_MIN 4
+#endif
+
+static inline int PacketCount(trace_mask_t mask) {
+    mask = mask - ((mask >> 1) & 0x55555555);
+    mask = (mask & 0x33333333) + ((mask >> 2) & 0x33333333);
+    mask = (mask + (mask >> 4)) & 0x0F0F0F0F;
+
+    return (int)((mask * 0x01010101) >> 24);
+}
+
+// comparing floats against these is the same as comparing them (as
+// doubles) against T_EPSILON, which is what RecursiveTestRay() does,
+// since 0.1f is just above 0.1 and -0.1f is just below -0.1.
+#define T_EPSILON_HI ((float)T_EPSILON)
+#define T_EPSILON_LO ((float)-T_EPSILON)
+
+// subtracts the plane distance from both ends of every ray, and gives
+// masks of the rays which are entirely in front, entirely behind, and
+// which start behind the plane.
+static inline void PacketClassify(const float *v1, const float *v2,
+                                  float dist, float *dist1, float *dist2,
+                                  trace_mask_t &front, trace_mask_t &back,
+                                  trace_mask_t &first_back) {
+    front = back = first_back = 0;
+
+#ifdef TRACE_USE_SSE2
+    const __m128 d = _mm_set1_ps(dist);
+    const __m128 lo = _mm_set1_ps(T_EPSILON_LO);
+    const __m128 hi = _mm_set1_ps(T_EPSILON_HI);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (int i = 0; i < TRACE_PACKET_SIZE; i += 4) {
+        __m128 d1 = _mm_sub_ps(_mm_loadu_ps(v1 + i), d);
+        __m128 d2 = _mm_sub_ps(_mm_loadu_ps(v2 + i), d);
+
+        _mm_storeu_ps(dist1 + i, d1);
+        _mm_storeu_ps(dist2 + i, d2);
+
+        __m128 is_front =
+            _mm_and_ps(_mm_cmpgt_ps(d1, lo), _mm_cmpgt_ps(d2, lo));
+        __m128 is_back =
+            _mm_and_ps(_mm_cmplt_ps(d1, hi), _mm_cmplt_ps(d2, hi));
+
+        front |= (trace_mask_t)_mm_movemask_ps(is_front) << i;
+        back |= (trace_mask_t)_mm_movemask_ps(is_back) << i;
+        first_back |= (trace_mask_t)_mm_movemask_ps(_mm_cmplt_ps(d1, zero))
+                      << i;
+    }
+#else
+    for (int i = 0; i < TRACE_PACKET_SIZE; i++) {
+        float d1 = v1[i] - dist;
+        float d2 = v2[i] - dist;
+
+        dist1[i] = d1;
+        dist2[i] = d2;
+
+        bool is_front = (d1 > T_EPSILON_LO) && (d2 > T_EPSILON_LO);
+        bool is_back = (d1 < T_EPSILON_HI) && (d2 < T_EPSILON_HI);
+
+        front |= (trace_mask_t)is_front << i;
+        back |= (trace_mask_t)is_back << i;
+        first_back |= (trace_mask_t)(d1 < 0) << i;
+    }
+#endif
+}
+
+// the rays are cut up in place, so the caller must not rely on the
+// lanes in `mask` afterwards.
+static void PacketTestRays(int nodenum, trace_packet_t &P, trace_mask_t mask,
+                           int *results) {
+    float dist1[TRACE_PACKET_SIZE];
+    float dist2[TRACE_PACKET_SIZE];
+
+    for (;;) {
+        if (nodenum < 0) {
+            for (int i = 0; i < TRACE_PACKET_SIZE; i++) {
+                if (mask & (1u << i)) {
+                    results[i] = nodenum;
+                }
+            }
+            return;
+        }
+
+        // once the rays have spread out, trace them one at a time
+        if (PacketCount(mask) < TRACE_PACKET_MIN) {
+            for (int i = 0; i < TRACE_PACKET_SIZE; i++) {
+                if (mask & (1u << i)) {
+                    results[i] =
+                        RecursiveTestRay(nodenum, P.x1[i], P.y1[i], P.z1[i],
+                                         P.x2[i], P.y2[i], P.z2[i]);
+                }
+            }
+            return;
+        }
+
+        const tnode_t *TN = &trace_nodes[nodenum];
+
+        // all lanes are computed, since that is what vectorizes well.
+        // unused lanes of the packet are zero, not garbage.
+
+        const float *v1;
+        const float *v2;
+
+        switch (TN->type) {
+            case PLANE_X:
+                v1 = P.x1;
+                v2 = P.x2;
+                break;
+
+            case PLANE_Y:
+                v1 = P.y1;
+                v2 = P.y2;
+                break;
+
+            case PLANE_Z:
+                v1 = P.z1;
+                v2 = P.z2;
+                break;
+
+            default: {
+                float nx = TN->normal[0];
+                float ny = TN->normal[1];
+                float nz = TN->normal[2];
+
+                for (int i = 0; i < TRACE_PACKET_SIZE; i++) {
+                    dist1[i] = P.x1[i] * nx + P.y1[i] * ny + P.z1[i] * nz;
+                    dist2[i] = P.x2[i] * nx + P.y2[i] * ny + P.z2[i] * nz;
+                }
+
+                v1 = dist1;
+                v2 = dist2;
+                break;
+            }
+        }
+
+        trace_mask_t front, back, first_back;
+
+        PacketClassify(v1, v2, TN->dist, dist1, dist2, front, back,
+                       first_back);
+
+        front &= mask;
+        back &= mask & ~front;
+
+        trace_mask_t cross = mask & ~(front | back);
+
+        if (cross == 0) {
+            if (back == 0) {
+                nodenum = TN->children[0];
+                continue;
+            }
+
+            if (front == 0) {
+                nodenum = TN->children[1];
+                continue;
+            }
+
+            // the rays do not interact, so the order does not matter
+            PacketTestRays(TN->children[0], P, front, results);
+
+            nodenum = TN->children[1];
+            mask = back;
+            continue;
+        }
+
+        // some rays cross the node plane.  They are cut at the plane,
+        // keeping the front half (from the start) in the packet and
+        // remembering the back half for later.
+
+        float mx[TRACE_PACKET_SIZE];
+        float my[TRACE_PACKET_SIZE];
+        float mz[TRACE_PACKET_SIZE];
+
+        float ex[TRACE_PACKET_SIZE];
+        float ey[TRACE_PACKET_SIZE];
+        float ez[TRACE_PACKET_SIZE];
+
+        for (int i = 0; i < TRACE_PACKET_SIZE; i++) {
+            if (!(cross & (1u << i))) {
+                continue;
+            }
+
+            double frac = dist1[i] / (double)(dist1[i] - dist2[i]);
+
+            mx[i] = P.x1[i] + (P.x2[i] - P.x1[i]) * frac;
+            my[i] = P.y1[i] + (P.y2[i] - P.y1[i]) * frac;
+            mz[i] = P.z1[i] + (P.z2[i] - P.z1[i]) * frac;
+
+            ex[i] = P.x2[i];
+            ey[i] = P.y2[i];
+            ez[i] = P.z2[i];
+
+            P.x2[i] = mx[i];
+            P.y2[i] = my[i];
+            P.z2[i] = mz[i];
+        }
+
+        trace_mask_t cross0 = cross & ~first_back;
+        trace_mask_t cross1 = cross & first_back;
+
+        // [1] the front child, with the front halves of the rays which
+        //     start on the front side.
+        if (front | cross0) {
+            PacketTestRays(TN->children[0], P, front | cross0, results);
+        }
+
+        // [2] the back child, with the front halves of the rays which
+        //     start on the back side, plus the back halves of rays
+        //     which got through step [1].
+        trace_mask_t cross0_ok = 0;
+
+        for (int i = 0; i < TRACE_PACKET_SIZE; i++) {
+            if ((cross0 & (1u << i)) && results[i] == TRACE_EMPTY) {
+                cross0_ok |= 1u << i;
+
+                P.x1[i] = mx[i];
+                P.y1[i] = my[i];
+                P.z1[i] = mz[i];
+
+                P.x2[i] = ex[i];
+                P.y2[i] = ey[i];
+                P.z2[i] = ez[i];
+            }
+        }
+
+        if (back | cross1 | cross0_ok) {
+            PacketTestRays(TN->children[1], P, back | cross1 | cross0_ok,
+                           results);
+        }
+
+        // [3] the front child again, with the back halves of the rays
+        //     which started on the back side and got through step [2].
+        trace_mask_t cross1_ok = 0;
+
+        for (int i = 0; i < TRACE_PACKET_SIZE; i++) {
+            if ((cross1 & (1u << i)) && results[i] == TRACE_EMPTY) {
+                cross1_ok |= 1u << i;
+
+                P.x1[i] = mx[i];
+                P.y1[i] = my[i];
+                P.z1[i] = mz[i];
+
+                P.x2[i] = ex[i];
+                P.y2[i] = ey[i];
+                P.z2[i] = ez[i];
+            }
+        }
+
+        if (cross1_ok == 0) {
+            return;
+        }
+
+        nodenum = TN->children[0];
+        mask = cross1_ok;
+    }
+}
+
 static int RecursiveTestDetail(quake_node_c *N, quake_leaf_c *L, float x1,
                                float y1, float z1, float x2, float y2,
                                float z2) {
@@ -326,6 +602,40 @@ bool QVIS_TraceRay(float x1, float y1, float z1, float x2, float y2, float z2) {
     return true;
 }
 
+void QVIS_TracePacket(const trace_packet_t &packet, bool *results) {
+    SYS_ASSERT(packet.count <= TRACE_PACKET_SIZE);
+
+    trace_packet_t P = packet;
+
+    // clear the unused lanes
+    for (int i = packet.count; i < TRACE_PACKET_SIZE; i++) {
+        P.x1[i] = P.y1[i] = P.z1[i] = 0;
+        P.x2[i] = P.y2[i] = P.z2[i] = 0;
+    }
+
+    int r[TRACE_PACKET_SIZE];
+
+    trace_mask_t mask = (trace_mask_t)((1ull << packet.count) - 1);
+
+    if (mask) {
+        PacketTestRays(0, P, mask, r);
+    }
+
+    for (int i = 0; i < packet.count; i++) {
+        results[i] = (r[i] != TRACE_SOLID);
+
+        // check for detail faces *after* the main trace
+
+        if (results[i]) {
+            int r2 = RecursiveTestDetail(
+                qk_bsp_root, NULL, packet.x1[i], packet.y1[i], packet.z1[i],
+                packet.x2[i], packet.y2[i], packet.z2[i]);
+
+            results[i] = (r2 != TRACE_SOLID);
+        }
+    }
+}
+
 static int RecursiveTestPoint(int nodenum, float x, float y, float z) {
     for (;;) {
         if (nodenum < 0) {
@@ -563,9 +873,6 @@ static void FloodAmbientSounds() {
 
 static qLump_c *q_visibility;
 
-static byte *v_row_buffer;
-static byte *v_compress_buffer;
-
 static int v_row_bits;  // number of leafs or clusters
 static int v_bytes_per_row;
 
@@ -618,22 +925,30 @@ struct vis_statistics_t {
 static vis_statistics_t pvs_stats;
 static vis_statistics_t phs_stats;
 
-static int WriteCompressedRow(bool PHS) {
-    // returns offset for the written data block
-    int visofs = (int)q_visibility->GetSize();
+// the results for one cluster, which are computed separately
+// (possibly in a worker thread) and written out afterwards.
+struct vis_row_t {
+    std::vector<byte> pvs;  // compressed, except for Quake III
+    std::vector<byte> phs;  // compressed, only for Quake II
+
+    float pvs_perc;
+    float phs_perc;
+};
 
-    const byte *src = v_row_buffer;
+static void CompressRow(const byte *src, std::vector<byte> &dest) {
     const byte *s_end = src + v_bytes_per_row;
 
-    byte *dest = v_compress_buffer;
+    // the worst case scenario for compression is 50% larger
+    dest.clear();
+    dest.reserve(2 * v_bytes_per_row);
 
     while (src < s_end) {
         if (*src) {
-            *dest++ = *src++;
+            dest.push_back(*src++);
             continue;
         }
 
-        *dest++ = *src++;
+        dest.push_back(*src++);
 
         byte repeat = 1;
 
@@ -642,39 +957,43 @@ static int WriteCompressedRow(bool PHS) {
             repeat++;
         }
 
-        *dest++ = repeat;
+        dest.push_back(repeat);
     }
+}
 
-    int length = (dest - v_compress_buffer);
+static int WriteCompressedRow(const std::vector<byte> &data, bool PHS) {
+    // returns offset for the written data block
+    int visofs = (int)q_visibility->GetSize();
 
-    q_visibility->Append(v_compress_buffer, length);
+    q_visibility->Append(data.data(), (int)data.size());
 
     if (PHS) {
         phs_stats.uncompressed += v_bytes_per_row;
-        phs_stats.compressed += length;
+        phs_stats.compressed += (int)data.size();
     } else {
         pvs_stats.uncompressed += v_bytes_per_row;
-        pvs_stats.compressed += length;
+        pvs_stats.compressed += (int)data.size();
     }
 
     return visofs;
 }
 
-static void WriteUncompressedRow() {
-    int length = v_bytes_per_row;
-
-    q_visibility->Append(v_row_buffer, length);
+static void WriteUncompressedRow(const std::vector<byte> &data) {
+    q_visibility->Append(data.data(), (int)data.size());
 }
 
-static void CollectRowData(int src_x, int src_y, bool PHS) {
+static float CollectRowData(const Vis_Buffer *visbuf, byte *row, int src_x,
+                            int src_y) {
+    // returns the percentage of the map which is visible.
+
     // initial state : everything visible
-    memset(v_row_buffer, 0xFF, v_bytes_per_row);
+    memset(row, 0xFF, v_bytes_per_row);
 
     unsigned int blocked = 0;  // statistics
 
     for (int cy = 0; cy < cluster_H; cy++) {
         for (int cx = 0; cx < cluster_W; cx++) {
-            if ((cx == src_x && cy == src_y) || qk_visbuf->CanSee(cx, cy)) {
+            if ((cx == src_x && cy == src_y) || visbuf->CanSee(cx, cy)) {
                 continue;
             }
 
@@ -687,7 +1006,7 @@ static void CollectRowData(int src_x, int src_y, bool PHS) {
                 SYS_ASSERT(index >= 0);
                 SYS_ASSERT((index >> 3) < v_bytes_per_row);
 
-                v_row_buffer[index >> 3] &= ~(1 << (index & 7));
+                row[index >> 3] &= ~(1 << (index & 7));
 
                 blocked++;
             } else  // original Quake, data is indexed by leaf number
@@ -706,7 +1025,7 @@ static void CollectRowData(int src_x, int src_y, bool PHS) {
                     SYS_ASSERT(index >= 0);
                     SYS_ASSERT((index >> 3) < v_bytes_per_row);
 
-                    v_row_buffer[index >> 3] &= ~(1 << (index & 7));
+                    row[index >> 3] &= ~(1 << (index & 7));
                 }
             }
         }
@@ -717,77 +1036,168 @@ static void CollectRowData(int src_x, int src_y, bool PHS) {
             src_x, src_y, blocked, blocked * 100.0 / v_row_bits);
 #endif
 
-    // update statistics
-    float perc = (v_row_bits - blocked) * 100.0 / (float)MAX(1, v_row_bits);
+#ifdef DEBUG_INVERT_MAP
+    for (int n = 0; n < v_bytes_per_row; n++) row[n] ^= 0xFF;
+#endif
 
-    if (PHS) {
-        phs_stats.AddValue(perc);
+    return (v_row_bits - blocked) * 100.0 / (float)MAX(1, v_row_bits);
+}
+
+static void ComputeClusterVis(Vis_Buffer *visbuf, byte *row, int cx, int cy,
+                              vis_row_t &R) {
+    // the visbuf and row buffer are used as scratch space, each thread
+    // must have its own.
+
+    visbuf->ClearVis();
+    visbuf->ProcessVis(cx, cy);
+
+    R.pvs_perc = CollectRowData(visbuf, row, cx, cy);
+
+    if (qk_game == 3) {
+        R.pvs.assign(row, row + v_bytes_per_row);
     } else {
-        pvs_stats.AddValue(perc);
+        CompressRow(row, R.pvs);
     }
 
-#ifdef DEBUG_INVERT_MAP
-    for (int n = 0; n < v_bytes_per_row; n++) v_row_buffer[n] ^= 0xFF;
-#endif
+    if (qk_game == 2) {
+        // Quake II's Potentially Hearable Set
+        //
+        // 1. start off with the PVS set
+        // 2. flood fill for a few passes
+        // 3. truncate it based on distance
+
+        visbuf->FloodFill(4);
+        visbuf->Truncate(8);
+
+        R.phs_perc = CollectRowData(visbuf, row, cx, cy);
+
+        CompressRow(row, R.phs);
+    }
 }
 
-static void Build_PVS() {
-    qk_visbuf->SimplifySolid();
+static void WriteClusterVis(qCluster_c *cluster, vis_row_t &R) {
+    if (cluster->leafs.empty()) {
+        if (qk_game == 3) {
+            std::vector<byte> empty_row(v_bytes_per_row, 0);
+            WriteUncompressedRow(empty_row);
+        }
+        return;
+    }
 
-    int done = 0;
+    pvs_stats.AddValue(R.pvs_perc);
 
-    for (int cy = 0; cy < cluster_H; cy++) {
-        for (int cx = 0; cx < cluster_W; cx++) {
-            qCluster_c *cluster = qk_clusters[cy * cluster_W + cx];
+    if (qk_game == 3) {
+        WriteUncompressedRow(R.pvs);
+        cluster->visofs = 1;  // dummy value, unused
+    } else {
+        cluster->visofs = WriteCompressedRow(R.pvs, false);
+    }
 
-            if (cluster->leafs.empty()) {
-                if (qk_game == 3) {
-                    memset(v_row_buffer, 0, v_bytes_per_row);
-                    WriteUncompressedRow();
-                }
+    if (qk_game == 2) {
+        phs_stats.AddValue(R.phs_perc);
 
-                continue;
-            }
+        cluster->hearofs = WriteCompressedRow(R.phs, true);
+    }
+}
 
-            qk_visbuf->ClearVis();
-            qk_visbuf->ProcessVis(cx, cy);
+static void Build_PVS_Serial() {
+    std::vector<byte> row(1 + v_bytes_per_row);
 
-            CollectRowData(cx, cy, false);
+    int done = 0;
 
-            if (qk_game == 3) {
-                WriteUncompressedRow();
-                cluster->visofs = 1;  // dummy value, unused
-            } else {
-                cluster->visofs = WriteCompressedRow(false);
-            }
+    for (int i = 0; i < cluster_W * cluster_H; i++) {
+        qCluster_c *cluster = qk_clusters[i];
 
-            if (qk_game == 2) {
-                // Quake II's Potentially Hearable Set
-                //
-                // 1. start off with the PVS set
-                // 2. flood fill for a few passes
-                // 3. truncate it based on distance
+        vis_row_t R;
 
-                qk_visbuf->FloodFill(4);
-                qk_visbuf->Truncate(8);
+        if (!cluster->leafs.empty()) {
+            ComputeClusterVis(qk_visbuf, row.data(), cluster->cx, cluster->cy,
+                              R);
+        }
 
-                CollectRowData(cx, cy, true);
+        WriteClusterVis(cluster, R);
 
-                cluster->hearofs = WriteCompressedRow(true);
-            }
+        if (cluster->leafs.empty()) {
+            continue;
+        }
 
-            if (done % 80 == 0) {
+        if (done % 80 == 0) {
 #ifndef CONSOLE_ONLY
-                Main::Ticker();
+            Main::Ticker();
 #endif
-                if (main_action >= MAIN_CANCEL) {
-                    return;
-                }
+            if (main_action >= MAIN_CANCEL) {
+                return;
             }
+        }
+
+        done++;
+    }
+}
+
+static void Build_PVS_Parallel(int num_workers) {
+    // each worker gets its own copy of the vis buffer, since ProcessVis()
+    // modifies it.  The rows are kept until all are done, then written
+    // out in cluster order, so the result is identical to the serial
+    // version.
 
-            done++;
+    int num_clusters = cluster_W * cluster_H;
+
+    std::vector<vis_row_t> rows(num_clusters);
+
+    std::vector<int> todo;
+
+    for (int i = 0; i < num_clusters; i++) {
+        if (!qk_clusters[i]->leafs.empty()) {
+            todo.push_back(i);
         }
     }
+
+    std::vector<Vis_Buffer *> visbufs(num_workers);
+    std::vector<std::vector<byte>> row_buffers(num_workers);
+
+    for (int w = 0; w < num_workers; w++) {
+        visbufs[w] = new Vis_Buffer(*qk_visbuf);
+        row_buffers[w].resize(1 + v_bytes_per_row);
+    }
+
+    bool finished = Thread_ParallelFor(
+        (int)todo.size(),
+        [&](int index, int worker) {
+            qCluster_c *cluster = qk_clusters[todo[index]];
+
+            ComputeClusterVis(visbufs[worker], row_buffers[worker].data(),
+                              cluster->cx, cluster->cy, rows[todo[index]]);
+        },
+        []() {
+#ifndef CONSOLE_ONLY
+            Main::Ticker();
+#endif
+            return main_action < MAIN_CANCEL;
+        });
+
+    for (int w = 0; w < num_workers; w++) {
+        delete visbufs[w];
+    }
+
+    if (!finished) {
+        return;
+    }
+
+    for (int i = 0; i < num_clusters; i++) {
+        WriteClusterVis(qk_clusters[i], rows[i]);
+    }
+}
+
+static void Build_PVS() {
+    qk_visbuf->SimplifySolid();
+
+    int num_workers = Thread_WorkerCount();
+
+    if (num_workers > 1) {
+        Build_PVS_Parallel(num_workers);
+    } else {
+        Build_PVS_Serial();
+    }
 }
 
 static void Q2_PrependOffsets(int num_clusters) {
@@ -868,11 +1278,6 @@ void QVIS_Visibility(int lump, int max_size, int numleafs) {
 
     LogPrintf("bits per row: {} --> bytes: {}\n", v_row_bits, v_bytes_per_row);
 
-    v_row_buffer = new byte[1 + v_bytes_per_row];
-
-    // the worst case scenario for compression is 50% larger
-    v_compress_buffer = new byte[1 + 2 * v_bytes_per_row];
-
     q_visibility = BSP_NewLump(lump);
 
     if (qk_game == 3) {
@@ -903,9 +1308,6 @@ void QVIS_Visibility(int lump, int max_size, int numleafs) {
                 "Quake build failure: exceeded VISIBILITY limit\n");
         }
     }
-
-    delete[] v_row_buffer;
-    delete[] v_compress_buffer;
 }
 
 //--- editor settings ---
@@ -75,6 +75,26 @@ void QVIS_FreeTraceNodes();
 // returns true if OK, false if blocked
 bool QVIS_TraceRay(float x1, float y1, float z1, float x2, float y2, float z2);
 
+#define TRACE_PACKET_SIZE 16
+
+struct trace_packet_t {
+    // the rays are stored as separate arrays of each coordinate, which
+    // lets the compiler test a node plane against all of them at once.
+    int count;
+
+    float x1[TRACE_PACKET_SIZE];
+    float y1[TRACE_PACKET_SIZE];
+    float z1[TRACE_PACKET_SIZE];
+
+    float x2[TRACE_PACKET_SIZE];
+    float y2[TRACE_PACKET_SIZE];
+    float z2[TRACE_PACKET_SIZE];
+};
+
+// traces a group of rays (best when they are close together), giving
+// the same result for each one as QVIS_TraceRay().
+void QVIS_TracePacket(const trace_packet_t &packet, bool *results);
+
 // returns true if point is in air, false for solid or sky
 bool QVIS_TracePoint(float x, float y, float z);
 
@@ -31,6 +31,8 @@
 #include "sys_xoshiro.h"
 #include "m_lua.h"
 #include "lib_util.h"
+#include "lib_pool.h"
+#include <algorithm>
 #include <assert.h>
 #include <cstdlib>
 #include <string.h>
@@ -53,45 +55,36 @@ extern int current_level_number;
 extern int global_verbosity;    /* Oooh, a global variable! */
 extern boolean ok_to_roll;  /* Stop breaking -seed...   */
 
+/* The geometry of all the levels made since the last FreeLevel() */
+/* (secret levels included) comes from these pools, and is freed  */
+/* all at once rather than piece by piece.                        */
+static thread_local object_pool_c<vertex> vertex_pool("slump vertexes");
+static thread_local object_pool_c<linedef> linedef_pool("slump linedefs");
+static thread_local object_pool_c<sidedef> sidedef_pool("slump sidedefs");
+static thread_local object_pool_c<sector> sector_pool("slump sectors");
+static thread_local object_pool_c<thing> thing_pool("slump things");
+static thread_local object_pool_c<grid_entry> grid_entry_pool("slump grid");
+
 /* Free up all the allocated structures associated with the */
 /* level, so we can start on a new one without burning too  */
 /* much memory.                                             */
 void FreeLevel(level *l)
 {
-  linedef *ld, *ldn;
-  sidedef *sd, *sdn;
-  vertex *v, *vn;
-  thing *t, *tn;
-  sector *s, *sn;
   link *link, *linkn;
   style *style, *stylen;
   arena *arena, *arenan;
   gate *gate, *gaten;
 
-  for (ld=l->linedef_anchor;ld;ld=ldn) {
-    ldn = ld->next;
-    free(ld);
-  }
+  vertex_pool.Release();
+  linedef_pool.Release();
+  sidedef_pool.Release();
+  sector_pool.Release();
+  thing_pool.Release();
+  grid_entry_pool.Release();
   l->linedef_anchor = NULL;
-  for (sd=l->sidedef_anchor;sd;sd=sdn) {
-    sdn = sd->next;
-    free(sd);
-  }
   l->sidedef_anchor = NULL;
-  for (v=l->vertex_anchor;v;v=vn) {
-    vn = v->next;
-    free(v);
-  }
   l->vertex_anchor = NULL;
-  for (t=l->thing_anchor;t;t=tn) {
-    tn = t->next;
-    free(t);
-  }
   l->thing_anchor = NULL;
-  for (s=l->sector_anchor;s;s=sn) {
-    sn = s->next;
-    free(s);
-  }
   l->sector_anchor = NULL;
   for (link=l->link_anchor;link;link=linkn)  {
     linkn = link->next;
@@ -137,8 +130,127 @@ short new_key(level *l)
   } else return 0;
 }
 
+/* The grid slot for the square gx,gy (in 1 << GRID_SHIFT units) */
+static int grid_slot(int gx, int gy)
+{
+  return (gy & (GRID_SIZE-1)) * GRID_SIZE + (gx & (GRID_SIZE-1));
+}
+
+/* The squares covering min..max along one axis, or all of them */
+/* if that's enough to wrap around the grid.                    */
+static void grid_range(int min, int max, int *first, int *last)
+{
+  *first = min >> GRID_SHIFT;
+  *last = max >> GRID_SHIFT;
+  if (*last - *first >= GRID_SIZE) {
+    *first = 0;
+    *last = GRID_SIZE - 1;
+  }
+}
+
+static void grid_add_vertex(level *l, vertex *v)
+{
+  int slot = grid_slot(v->x >> GRID_SHIFT, v->y >> GRID_SHIFT);
+
+  v->grid_next = l->vertex_grid[slot];
+  l->vertex_grid[slot] = v;
+}
+
+static void grid_remove_vertex(level *l, vertex *v)
+{
+  vertex **p;
+
+  p = &(l->vertex_grid[grid_slot(v->x >> GRID_SHIFT, v->y >> GRID_SHIFT)]);
+  for (;*p;p=&((*p)->grid_next)) {
+    if (*p==v) {
+      *p = v->grid_next;
+      break;
+    }
+  }
+}
+
+/* A linedef goes in every square its bounding box touches */
+static void grid_add_linedef(level *l, linedef *ld)
+{
+  int fx, lx, fy, ly, gx, gy, slot;
+  grid_entry *e;
+
+  grid_range(std::min(ld->from->x,ld->to->x),std::max(ld->from->x,ld->to->x),
+             &fx,&lx);
+  grid_range(std::min(ld->from->y,ld->to->y),std::max(ld->from->y,ld->to->y),
+             &fy,&ly);
+  for (gy=fy;gy<=ly;gy++) {
+    for (gx=fx;gx<=lx;gx++) {
+      slot = grid_slot(gx,gy);
+      e = (grid_entry *)grid_entry_pool.Alloc();
+      e->ld = ld;
+      e->next = l->linedef_grid[slot];
+      l->linedef_grid[slot] = e;
+    }
+  }
+}
+
+static void grid_remove_linedef(level *l, linedef *ld)
+{
+  int fx, lx, fy, ly, gx, gy;
+  grid_entry **p, *e;
+
+  grid_range(std::min(ld->from->x,ld->to->x),std::max(ld->from->x,ld->to->x),
+             &fx,&lx);
+  grid_range(std::min(ld->from->y,ld->to->y),std::max(ld->from->y,ld->to->y),
+             &fy,&ly);
+  for (gy=fy;gy<=ly;gy++) {
+    for (gx=fx;gx<=lx;gx++) {
+      for (p=&(l->linedef_grid[grid_slot(gx,gy)]);*p;p=&((*p)->next)) {
+        if ((*p)->ld==ld) {
+          e = *p;
+          *p = e->next;
+          grid_entry_pool.Free(e);
+          break;
+        }
+      }
+    }
+  }
+}
+
+/* Put a linedef on the lists of its from and to vertexes.  Those */
+/* are kept newest first like l->linedef_anchor, so walking one   */
+/* visits linedefs in the same order a walk of them all would.    */
+static void link_linedef_ends(linedef *ld)
+{
+  linedef **p;
+
+  for (p=&(ld->from->from_anchor);*p;p=&((*p)->from_next))
+    if ((*p)->serial < ld->serial) break;
+  ld->from_next = *p;
+  *p = ld;
+  for (p=&(ld->to->to_anchor);*p;p=&((*p)->to_next))
+    if ((*p)->serial < ld->serial) break;
+  ld->to_next = *p;
+  *p = ld;
+}
+
+static void unlink_linedef_ends(linedef *ld)
+{
+  linedef **p;
+
+  for (p=&(ld->from->from_anchor);*p;p=&((*p)->from_next)) {
+    if (*p==ld) {
+      *p = ld->from_next;
+      break;
+    }
+  }
+  for (p=&(ld->to->to_anchor);*p;p=&((*p)->to_next)) {
+    if (*p==ld) {
+      *p = ld->to_next;
+      break;
+    }
+  }
+}
+
 /* Remove a vertex from the level.  Frees the memory, but */
-/* doesn't do anything about linedefs nor nothin'.        */
+/* doesn't do anything about linedefs nor nothin', so any */
+/* linedefs using it must be deleted first.               */
 void delete_vertex(level *l, vertex *v)
 {
   vertex *v1;
@@ -153,7 +265,8 @@ void delete_vertex(level *l, vertex *v)
       }
     }
   }
-  free(v);  /* oh, that'll help a lot, eh? */
+  grid_remove_vertex(l,v);
+  vertex_pool.Free(v);  /* oh, that'll help a lot, eh? */
 }
 
 /* Add a vertex to the given level at the given place.  Return it. */
@@ -161,15 +274,38 @@ vertex *new_vertex(level *l,int x,int y)
 {
   vertex *answer;
 
-  answer = (vertex *)malloc(sizeof(*answer));
+  answer = (vertex *)vertex_pool.Alloc();
   answer->x = x;
   answer->y = y;
   answer->marked = 0;
+  answer->from_anchor = NULL;
+  answer->to_anchor = NULL;
   answer->next = l->vertex_anchor;
   l->vertex_anchor = answer;
+  grid_add_vertex(l,answer);
   return answer;
 }
 
+/* Move an existing vertex, keeping the grid right for it and */
+/* for the linedefs using it.  Never just change v->x or v->y. */
+void move_vertex(level *l, vertex *v, int x, int y)
+{
+  linedef *ld;
+
+  for (ld=v->from_anchor;ld;ld=ld->from_next)
+    grid_remove_linedef(l,ld);
+  for (ld=v->to_anchor;ld;ld=ld->to_next)
+    if (ld->from!=v) grid_remove_linedef(l,ld);
+  grid_remove_vertex(l,v);
+  v->x = x;
+  v->y = y;
+  grid_add_vertex(l,v);
+  for (ld=v->from_anchor;ld;ld=ld->from_next)
+    grid_add_linedef(l,ld);
+  for (ld=v->to_anchor;ld;ld=ld->to_next)
+    if (ld->from!=v) grid_add_linedef(l,ld);
+}
+
 /* Remove a linedef from the level.  Frees the memory, but */
 /* doesn't do anything about sidedefs nor nothin'.         */
 void delete_linedef(level *l, linedef *ld)
@@ -186,7 +322,9 @@ void delete_linedef(level *l, linedef *ld)
       }
     }
   }
-  free(ld);  /* ooohhh, look, he freed something! */
+  grid_remove_linedef(l,ld);
+  unlink_linedef_ends(ld);
+  linedef_pool.Free(ld);  /* ooohhh, look, he freed something! */
 }
 
 /* Add a linedef to the given level between the given vertexes.  No  */
@@ -195,7 +333,7 @@ linedef *new_linedef(level *l,vertex *from,vertex *to)
 {
   linedef *answer;
 
-  answer = (linedef *)malloc(sizeof(*answer));
+  answer = (linedef *)linedef_pool.Alloc();
   answer->from = from;
   answer->to = to;
   answer->flags = 0;
@@ -205,12 +343,62 @@ linedef *new_linedef(level *l,vertex *from,vertex *to)
   answer->right = NULL;
   answer->group_next = NULL;
   answer->group_previous = NULL;
+  answer->serial = ++(l->last_linedef_serial);
   answer->next = l->linedef_anchor;
   answer->marked = 0;
   l->linedef_anchor = answer;
+  link_linedef_ends(answer);
+  grid_add_linedef(l,answer);
   return answer;
 }
 
+/* Point an existing linedef at new vertexes.  Like move_vertex(), */
+/* use this rather than changing ld->from or ld->to directly.      */
+void set_linedef_ends(level *l, linedef *ld, vertex *from, vertex *to)
+{
+  grid_remove_linedef(l,ld);
+  unlink_linedef_ends(ld);
+  ld->from = from;
+  ld->to = to;
+  link_linedef_ends(ld);
+  grid_add_linedef(l,ld);
+}
+
+/* Does any linedef cross a side of the quadrilateral 1-2-3-4?  If */
+/* <unmarked_only>, linedefs with a marked vertex don't count.     */
+boolean quad_crosses_linedef(level *l, int x1, int y1, int x2, int y2,
+                             int x3, int y3, int x4, int y4,
+                             boolean unmarked_only)
+{
+  int fx, lx, fy, ly, gx, gy;
+  grid_entry *e;
+  linedef *ld;
+
+  /* Anything crossing a side has to overlap the enclosing rectangle */
+  grid_range(std::min(std::min(x1,x2),std::min(x3,x4)),
+             std::max(std::max(x1,x2),std::max(x3,x4)),&fx,&lx);
+  grid_range(std::min(std::min(y1,y2),std::min(y3,y4)),
+             std::max(std::max(y1,y2),std::max(y3,y4)),&fy,&ly);
+  for (gy=fy;gy<=ly;gy++) {
+    for (gx=fx;gx<=lx;gx++) {
+      for (e=l->linedef_grid[grid_slot(gx,gy)];e;e=e->next) {
+        ld = e->ld;
+        if (unmarked_only)
+          if ((ld->to->marked) || (ld->from->marked)) continue;
+        if (intersects(x1,y1,x2,y2,ld->from->x,ld->from->y,ld->to->x,ld->to->y))
+          return 1;
+        if (intersects(x2,y2,x3,y3,ld->from->x,ld->from->y,ld->to->x,ld->to->y))
+          return 1;
+        if (intersects(x3,y3,x4,y4,ld->from->x,ld->from->y,ld->to->x,ld->to->y))
+          return 1;
+        if (intersects(x4,y4,x1,y1,ld->from->x,ld->from->y,ld->to->x,ld->to->y))
+          return 1;
+      }
+    }
+  }
+  return 0;
+}
+
 /* Return a new sector for the given level */
 sector *new_sector(level *l,short fh, short ch, flat *ft, flat *ct)
 {
@@ -218,7 +406,7 @@ sector *new_sector(level *l,short fh, short ch, flat *ft, flat *ct)
 
   if ((ft==NULL) || (ct==NULL))
     announce(WARNING,"Null flat in new_sector.");
-  answer = (sector *)malloc(sizeof(*answer));
+  answer = (sector *)sector_pool.Alloc();
   answer->floor_height = fh;
   answer->ceiling_height = ch;
   answer->floor_flat = ft;
@@ -257,7 +445,7 @@ sidedef *new_sidedef(level *l, sector *s, config *c)
   sidedef *answer;
 
   if (s==NULL) announce(SLUMP_ERROR,"Null sector passed to new_sidedef!");
-  answer = (sidedef *)malloc(sizeof(*answer));
+  answer = (sidedef *)sidedef_pool.Alloc();
   answer->x_offset = 0;
   answer->x_misalign = 0;
   answer->y_offset = 0;
@@ -283,7 +471,7 @@ thing *new_thing(level *l, int x, int y, short angle, short type,
   if (type==ID_LAMP2) announce(VERBOSE,"Lamp2");
   if (type==ID_TLAMP2) announce(VERBOSE,"Tlamp2");
   if (type==ID_LAMP) announce(VERBOSE,"Lamp");
-  answer = (thing *)malloc(sizeof(*answer));
+  answer = (thing *)thing_pool.Alloc();
   answer->x = (short)x;
   answer->y = (short)y;
   answer->angle = angle;
@@ -828,7 +1016,7 @@ linedef *split_linedef(level *l, linedef *ld, int len, config *c)
 
   v = new_vertex(l,ld->from->x+dx,ld->from->y+dy);
   answer = new_linedef(l,v,ld->to);
-  ld->to = v;
+  set_linedef_ends(l,ld,ld->from,v);
   answer->flags = ld->flags;
   answer->type = ld->type;
   answer->tag = ld->tag;
@@ -919,12 +1107,17 @@ linedef *flip_linedef(linedef *ld)
   v = ld->from;
   sd = ld->left;
 
+  /* The bounding box doesn't change, so the grid is still right */
+  unlink_linedef_ends(ld);
+
   ld->from = ld->to;
   ld->left = ld->right;
 
   ld->to = v;
   ld->right = sd;
 
+  link_linedef_ends(ld);
+
   return ld;
 }
 
@@ -2055,21 +2248,20 @@ void global_align_forward(level *l, linedef *ld)
   int newoff;
 
   v = ld->to;
-  for (ld2=l->linedef_anchor;ld2;ld2=ld2->next) {
-    if (ld2->from==v)
-      if (common_texture(ld->right,ld2->right)) {
-        newoff = ld->right->x_offset + linelen(ld);
-        newoff = newoff % 256;
-        if (newoff<0) newoff += 256;
-        if (ld2->marked==0) {
-          ld2->right->x_offset = newoff;
-          ld2->marked = 1;
-          global_align_linedef(l,ld2);
-        } else {
-          if (ld2->right->x_offset!=newoff)
-            ld->f_misaligned = 1;
-        }
-      }  /* end if common texture */
+  for (ld2=v->from_anchor;ld2;ld2=ld2->from_next) {
+    if (common_texture(ld->right,ld2->right)) {
+      newoff = ld->right->x_offset + linelen(ld);
+      newoff = newoff % 256;
+      if (newoff<0) newoff += 256;
+      if (ld2->marked==0) {
+        ld2->right->x_offset = newoff;
+        ld2->marked = 1;
+        global_align_linedef(l,ld2);
+      } else {
+        if (ld2->right->x_offset!=newoff)
+          ld->f_misaligned = 1;
+      }
+    }  /* end if common texture */
   }  /* end for ld2 */
 }
 
@@ -2080,21 +2272,20 @@ void global_align_backward(level *l, linedef *ld)
   int newoff;
 
   v = ld->from;
-  for (ld2=l->linedef_anchor;ld2;ld2=ld2->next) {
-    if (ld2->to==v)
-      if (common_texture(ld->right,ld2->right)) {
-        newoff = ld->right->x_offset - linelen(ld2);
-        newoff = newoff % 256;
-        if (newoff<0) newoff += 256;
-        if (ld2->marked==0) {
-          ld2->right->x_offset = newoff;
-          ld2->marked = 1;
-          global_align_linedef(l,ld2);
-        } else {
-          if (ld2->right->x_offset!=newoff)
-            ld->b_misaligned = 1;
-        }
-      }  /* end if common texture */
+  for (ld2=v->to_anchor;ld2;ld2=ld2->to_next) {
+    if (common_texture(ld->right,ld2->right)) {
+      newoff = ld->right->x_offset - linelen(ld2);
+      newoff = newoff % 256;
+      if (newoff<0) newoff += 256;
+      if (ld2->marked==0) {
+        ld2->right->x_offset = newoff;
+        ld2->marked = 1;
+        global_align_linedef(l,ld2);
+      } else {
+        if (ld2->right->x_offset!=newoff)
+          ld->b_misaligned = 1;
+      }
+    }  /* end if common texture */
   }  /* end for ld2 */
 }
 
@@ -2306,12 +2497,11 @@ linedef *make_parallel(level *l,linedef *ld,int depth,linedef *old)
   point_from(ld->from->x, ld->from->y, ld->to->x, ld->to->y,
              LEFT_TURN,depth,&x,&y);
   if (old) {
-    old->to->x = x;     /* Assumes no one else is using */
-    old->to->y = y;     /* these vertexes.  OK?         */
+    move_vertex(l,old->to,x,y);   /* Assumes no one else is using */
+                                  /* these vertexes.  OK?         */
     x += ld->from->x - ld->to->x;
     y += ld->from->y - ld->to->y;
-    old->from->x = x;
-    old->from->y = y;
+    move_vertex(l,old->from,x,y);
     return old;
   } else {
     v1 = new_vertex(l,x,y);
@@ -2505,9 +2695,9 @@ boolean empty_rectangle(level *l, int x1, int y1, int x2, int y2,
                                   int x3, int y3, int x4, int y4)
 {
   int minx, maxx, miny, maxy;
+  int fx, lx, fy, ly, gx, gy;
   vertex *v;
   sector *s;
-  linedef *ld;
 
   /* Find the enclosing rectangle of these points */
   if (x1>x2) {
@@ -2544,10 +2734,16 @@ boolean empty_rectangle(level *l, int x1, int y1, int x2, int y2,
 
   /* Look at all unmarked vertexes, see if any */
   /* are within the enclosing rectangle.       */
-  for (v=l->vertex_anchor;v;v=v->next) {
-    if (v->marked==0)
-      if ( ( (v->x <= maxx) && (v->x >= minx) ) &&
-           ( (v->y <= maxy) && (v->y >= miny) ) ) return 0;
+  grid_range(minx,maxx,&fx,&lx);
+  grid_range(miny,maxy,&fy,&ly);
+  for (gy=fy;gy<=ly;gy++) {
+    for (gx=fx;gx<=lx;gx++) {
+      for (v=l->vertex_grid[grid_slot(gx,gy)];v;v=v->grid_next) {
+        if (v->marked==0)
+          if ( ( (v->x <= maxx) && (v->x >= minx) ) &&
+               ( (v->y <= maxy) && (v->y >= miny) ) ) return 0;
+      }
+    }
   }
 
   /* Now look at all sectors, see if any of these four */
@@ -2570,19 +2766,8 @@ boolean empty_rectangle(level *l, int x1, int y1, int x2, int y2,
   /* any of the four implied boundary lines.  Doesn't assume */
   /* axis-parallel lines, for a change!  Does assume there are */
   /* only four sides, though.  Need true polygons. */
-  for (ld=l->linedef_anchor;ld;ld=ld->next) {
-    if (ld->to->marked==0)
-      if (ld->from->marked==0) {
-        if (intersects(x1,y1,x2,y2,ld->from->x,ld->from->y,ld->to->x,ld->to->y))
-          return 0;
-        if (intersects(x2,y2,x3,y3,ld->from->x,ld->from->y,ld->to->x,ld->to->y))
-          return 0;
-        if (intersects(x3,y3,x4,y4,ld->from->x,ld->from->y,ld->to->x,ld->to->y))
-          return 0;
-        if (intersects(x4,y4,x1,y1,ld->from->x,ld->from->y,ld->to->x,ld->to->y))
-          return 0;
-      }
-  }
+  if (quad_crosses_linedef(l,x1,y1,x2,y2,x3,y3,x4,y4,SLUMP_TRUE))
+    return 0;
 
   return 1;
 }
@@ -3638,19 +3823,19 @@ boolean make_decroom(level *l,linedef *ldf1,linedef *ldf2,config *c)
     lt1 = split_linedef(l,ldnew1,8,c);    /* 8's should vary */
     ldnew1->right->psector = ldf1->right->psector;
     ldnew1->right->y_offset = ldf1->right->y_offset;
-    ldf1->from = ldnew1->to;
+    set_linedef_ends(l,ldf1,ldnew1->to,ldf1->to);
     lt2 = split_linedef(l,ldnew2,8,c);
     ldnew2->right->psector = ldf2->right->psector;
     ldnew2->right->y_offset = ldf2->right->y_offset;
-    ldf2->from = ldnew2->to;
+    set_linedef_ends(l,ldf2,ldnew2->to,ldf2->to);
     lt2 = split_linedef(l,lt2,len-16,c);
     lt2->right->psector = ldf1->right->psector;
     lt2->right->y_offset = ldf1->right->y_offset;
-    ldf1->to = lt2->from;
+    set_linedef_ends(l,ldf1,ldf1->from,lt2->from);
     lt1 = split_linedef(l,lt1,len-16,c);
     lt1->right->psector = ldf2->right->psector;
     lt1->right->y_offset = ldf2->right->y_offset;
-    ldf2->to = lt1->from;
+    set_linedef_ends(l,ldf2,ldf2->from,lt1->from);
   }
 
   place_plants(l,48,newsec,c);    /* Put in some plants for decor */
@@ -5495,10 +5680,9 @@ short death_room(level *l,linedef *ld,style *ThisStyle,config *c)
   ldnew = make_linkto(l,ld,gatelink,ThisStyle,c,NULL);
   if (ldnew==NULL) return 0;
   for (;linelen(ldnew)<320;) {
-    ldnew->to->x = ldnew->from->x + 2 *
-      (ldnew->to->x - ldnew->from->x);
-    ldnew->to->y = ldnew->from->y + 2 *
-      (ldnew->to->y - ldnew->from->y);
+    move_vertex(l,ldnew->to,
+      ldnew->from->x + 2 * (ldnew->to->x - ldnew->from->x),
+      ldnew->from->y + 2 * (ldnew->to->y - ldnew->from->y));
   }
   newsector = generate_room_outline(l,ldnew,ThisStyle,SLUMP_FALSE,c);
   newsector->pstyle = ThisStyle;
@@ -6357,10 +6541,8 @@ linedef *make_linkto(level *l,linedef *ld,link *ThisLink, style *ThisStyle,
     }
     if (newsize< 256 * l->hugeness) newsize = 256 * l->hugeness;
     if (old) {
-      old->from->x = minx;
-      old->to->x = minx;
-      old->from->y = newsize/2;
-      old->to->y = 0-newsize/2;
+      move_vertex(l,old->from,minx,newsize/2);
+      move_vertex(l,old->to,minx,0-newsize/2);
       ldnew = old;
     } else {
       v = new_vertex(l,minx,newsize/2);
@@ -6915,20 +7097,20 @@ void make_lightstrip(level *l, linedef *ld,style *ThisStyle,int ll,int depth,
   /* avoid colliding with orthogonal doors and stuff, if we're */
   /* not gonna do a full area check.  Use rather silly shortening */
   if (ldnew->to->x>ldnew->from->x) {
-    ldnew->to->x-=2;
-    ldnew->from->x+=2;
+    move_vertex(l,ldnew->to,ldnew->to->x-2,ldnew->to->y);
+    move_vertex(l,ldnew->from,ldnew->from->x+2,ldnew->from->y);
   }
   if (ldnew->to->x<ldnew->from->x) {
-    ldnew->to->x+=2;
-    ldnew->from->x-=2;
+    move_vertex(l,ldnew->to,ldnew->to->x+2,ldnew->to->y);
+    move_vertex(l,ldnew->from,ldnew->from->x-2,ldnew->from->y);
   }
   if (ldnew->to->y>ldnew->from->y) {
-    ldnew->to->y-=2;
-    ldnew->from->y+=2;
+    move_vertex(l,ldnew->to,ldnew->to->x,ldnew->to->y-2);
+    move_vertex(l,ldnew->from,ldnew->from->x,ldnew->from->y+2);
   }
   if (ldnew->to->y<ldnew->from->y) {
-    ldnew->to->y+=2;
-    ldnew->from->y-=2;
+    move_vertex(l,ldnew->to,ldnew->to->x,ldnew->to->y+2);
+    move_vertex(l,ldnew->from,ldnew->from->x,ldnew->from->y-2);
   }
   ldnew->right->middle_texture = ThisStyle->walllight;
   /* Sometimes use bottom of lights. */
@@ -6993,14 +7175,12 @@ void swell_linedef(level *l,linedef *ld,style *ThisStyle,config *c,
   if (sno==3) point_from(ldnew1->from->x,ldnew1->from->y,
                          ldnew1->to->x,ldnew1->to->y,
                          LEFT_TURN,sdepth,&newx2,&newy2);
-  ld->to->x = newx1;
-  ld->to->y = newy1;
+  move_vertex(l,ld->to,newx1,newy1);
   sprintf(logstring,"Swol to (%d,%d)-(%d,%d)...\n",ld->from->x,ld->from->y,
     ld->to->x,ld->to->y);
   announce(VERBOSE,logstring);
   if (sno==3) {
-    ldnew1->to->x = newx2;
-    ldnew1->to->y = newy2;
+    move_vertex(l,ldnew1->to,newx2,newy2);
     sprintf(logstring,"    and (%d,%d)-(%d,%d)...\n",ldnew1->from->x,ldnew1->from->y,
       ldnew1->to->x,ldnew1->to->y);
     announce(VERBOSE,logstring);
@@ -10546,7 +10726,6 @@ boolean do_new_pillar(level *l,sector *oldsector,sector *innersec,texture *t1,
   int minx, miny, maxx, maxy, tx, ty;
   thing *t;
   vertex *v;
-  linedef *ld;
   texture *tm;
 
   /* Initialize the 64-enclosing range */
@@ -10590,16 +10769,8 @@ boolean do_new_pillar(level *l,sector *oldsector,sector *innersec,texture *t1,
   if (minx>=maxx-15) return SLUMP_FALSE;
   if (miny>=maxy-15) return SLUMP_FALSE;
   /* See if the result has any nasty intersections */
-  for (ld=l->linedef_anchor;ld;ld=ld->next) {
-    if (intersects(minx,miny,minx,maxy,ld->from->x,ld->from->y,ld->to->x,ld->to->y))
-      return SLUMP_FALSE;
-    if (intersects(minx,maxy,maxx,maxy,ld->from->x,ld->from->y,ld->to->x,ld->to->y))
-      return SLUMP_FALSE;
-    if (intersects(maxx,maxy,maxx,miny,ld->from->x,ld->from->y,ld->to->x,ld->to->y))
-      return SLUMP_FALSE;
-    if (intersects(maxx,miny,minx,miny,ld->from->x,ld->from->y,ld->to->x,ld->to->y))
-      return SLUMP_FALSE;
-  }
+  if (quad_crosses_linedef(l,minx,miny,minx,maxy,maxx,maxy,maxx,miny,SLUMP_FALSE))
+    return SLUMP_FALSE;
   /* If we made it this far, we found room! */
   /* Now decide how much to use (i.e. should sometimes shrink/narrow here) */
   /* and finally make the pillar (or whatever!) */
@@ -11012,7 +11183,7 @@ void make_extroom(level *l, sector *oldsector, haa *haa,
   texture *t1;
   link *ThisLink;
   sector *hisec, *losec;
-  vertex *v;
+  vertex *v, *v1, *v2;
   boolean outtex = rollpercent(70);
 
   fenceh = 96;  /* Should vary */
@@ -11032,9 +11203,11 @@ void make_extroom(level *l, sector *oldsector, haa *haa,
       if (empty_left_side(l,newldf,depth)) break;
       depth -= 64;
       if (depth<128) {
-        delete_vertex(l,newldf->from);
-        delete_vertex(l,newldf->to);
+        v1 = newldf->from;
+        v2 = newldf->to;
         delete_linedef(l,newldf);
+        delete_vertex(l,v1);
+        delete_vertex(l,v2);
         return;   /* How'd that happen? */
       }
     }
@@ -12147,6 +12320,7 @@ linedef *make_next_room(level *l,sector *oldsector,boolean radical,config *c,
                          linedef **ldf, link **ThisLink, quest *ThisQuest)
 {
   linedef *newldf;
+  vertex *v1, *v2;
   int i, tries;
   boolean try_reduction;
   sector *newsector;
@@ -12205,9 +12379,11 @@ linedef *make_next_room(level *l,sector *oldsector,boolean radical,config *c,
   }  /* end with and without reduction */
   if (newsector==NULL) {
     if (newldf) {  /* Avoid engine crashes! */
-      delete_vertex(l,newldf->from);
-      delete_vertex(l,newldf->to);
+      v1 = newldf->from;
+      v2 = newldf->to;
       delete_linedef(l,newldf);
+      delete_vertex(l,v1);
+      delete_vertex(l,v2);
     }
     newldf = NULL;
   }
@@ -12261,6 +12437,9 @@ void empty_level(level *l, config *c)
    l->link_anchor = NULL;
    l->arena_anchor = NULL;
    l->gate_anchor = NULL;
+   l->last_linedef_serial = 0;
+   memset(l->vertex_grid,0,sizeof(l->vertex_grid));
+   memset(l->linedef_grid,0,sizeof(l->linedef_grid));
    l->used_red = SLUMP_FALSE;
    l->used_blue = SLUMP_FALSE;
    l->used_yellow = SLUMP_FALSE;
@@ -55,6 +55,12 @@ typedef unsigned char boolean;
 #define LEVEL_MAX_BARS (30)
 #define LEVEL_MAX_CRUSHERS (2)
 
+/* The vertexes and linedefs of a level are indexed in a grid of  */
+/* 256-unit squares (1 << GRID_SHIFT); squares a multiple of      */
+/* GRID_SIZE apart share a slot, so the level can be any size.    */
+#define GRID_SHIFT (8)
+#define GRID_SIZE (64)
+
 #define TLMPSIZE(rows,columns) ((rows+9)*columns + 8)
 
 typedef unsigned char byte;
@@ -446,6 +452,9 @@ typedef struct s_vertex {
   short y;
   short number;
   boolean marked;
+  struct s_linedef *from_anchor;   /* Linedefs starting here */
+  struct s_linedef *to_anchor;     /* Linedefs ending here */
+  struct s_vertex *grid_next;      /* Others in the same grid square */
   struct s_vertex *next;
 } vertex, *pvertex;
 
@@ -477,6 +486,9 @@ struct s_linedef {
   boolean b_misaligned;
   struct s_linedef *group_next;         /* Used during texture-alignment */
   struct s_linedef *group_previous;     /* A group gets aligned together */
+  int serial;                           /* Order of creation */
+  struct s_linedef *from_next;          /* Same from vertex, older */
+  struct s_linedef *to_next;            /* Same to vertex, older */
   struct s_linedef *next;
 };   /* linedef and plinedef defined above; gcc chokes if we do it again! */
 
@@ -667,6 +679,12 @@ typedef struct s_arena {
   struct s_arena *next;
 } arena, *parena;
 
+/* One linedef in one square of the level's linedef grid */
+typedef struct s_grid_entry {
+  linedef *ld;
+  struct s_grid_entry *next;
+} grid_entry, *pgrid_entry;
+
 typedef struct s_level {
   thing *thing_anchor;
   sector *sector_anchor;
@@ -729,6 +747,10 @@ typedef struct s_level {
   link *link_anchor;
   gate *gate_anchor;
   arena *arena_anchor;
+  /* Spatial index, maintained by new_vertex(), move_vertex() etc */
+  int last_linedef_serial;
+  vertex *vertex_grid[GRID_SIZE*GRID_SIZE];
+  grid_entry *linedef_grid[GRID_SIZE*GRID_SIZE];
 } level, *plevel;
 
 /* The config is the static architectural knowledge and stuff. */
@@ -848,6 +870,11 @@ sector *generate_room_outline(level *l,linedef *ld,style *ThisStyle,
 int lengthsquared(linedef *ld);
 int distancesquared(int x1, int y1, int x2, int y2);
 int infinity_norm(int x1, int y1, int x2, int y2);
+boolean intersects(int XA, int YA, int XB, int YB,
+                   int XC, int YC, int XD, int YD);
+boolean quad_crosses_linedef(level *l, int x1, int y1, int x2, int y2,
+                             int x3, int y3, int x4, int y4,
+                             boolean unmarked_only);
 boolean empty_rectangle(level *l,int x1, int y1, int x2, int y2,
                                  int x3, int y3, int x4, int y4);
 boolean empty_left_side(level *l, linedef *ld, int sdepth);
@@ -26,6 +26,14 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "lib_thread.h"
 #include "nodebuild.h"
 #include "templates.h"
 #include "zdbsp.h"
@@ -33,6 +41,20 @@
 #define Printf printf
 #define STACK_ARGS
 
+// Splitters are scored on several threads when there are at least this
+// many (splitter, seg) pairs to check.  Smaller sets are not worth it.
+#define PARALLEL_SPLITTER_WORK 200000
+
+// Heuristic() classifies this many segs against a splitter at once.
+#define CLASSIFY_BATCH 16
+
+// The splitter for the back half of a split is chosen by the splitter
+// queue when it has at least PARALLEL_SUBTREE_MIN segs. Sets with more
+// than PARALLEL_SUBTREE_MAX segs are left to the main thread, which
+// scores them on all the worker threads.
+#define PARALLEL_SUBTREE_MIN 128
+#define PARALLEL_SUBTREE_MAX 1024
+
 #if 0
 #define D(x) x
 #else
@@ -41,10 +63,164 @@
     } while (0)
 #endif
 
+// Choosing a splitter only reads a copy of the set, so it can be done
+// on another thread while the main thread keeps building the tree.
+// When a set is split, the back half is not looked at again until the
+// whole subtree of the front half is built, so the queue picks its
+// splitter in the meantime. The main thread still builds every node,
+// in the usual order, so the nodes, segs and vertices get the same
+// numbers as when there is only one thread.
+
+struct FNodeBuilder::FSplitterJob {
+    enum { QUEUED, RUNNING, DONE };
+
+    FSegSet Segs;  // copy of the set when it was queued
+    unsigned int Count;
+    int State;
+
+    bool Found;
+    node_t Node;
+    DWORD SplitSeg;
+};
+
+class FNodeBuilder::FSplitterQueue {
+   public:
+    FSplitterQueue(const FNodeBuilder &builder, int threads);
+    ~FSplitterQueue();
+
+    void Submit(FSplitterJob *job);
+
+    // Waits for a job to be done. If no thread has started on it yet, it
+    // is taken off the queue instead and false is returned.
+    bool Finish(FSplitterJob *job);
+
+   private:
+    const FNodeBuilder &Builder;
+
+    std::mutex Lock;
+    std::condition_variable Wake;  // a job was queued, or we are stopping
+    std::condition_variable Done;  // a job was finished
+
+    std::vector<FSplitterJob *> Pending;
+    std::vector<FSplitterJob *> Unfinished;  // submitted, Finish() not called
+    std::vector<std::thread> Threads;
+    bool Stopping;
+
+    void WorkerMain();
+};
+
+FNodeBuilder::FSplitterQueue::FSplitterQueue(const FNodeBuilder &builder,
+                                             int threads)
+    : Builder(builder), Stopping(false) {
+    for (int i = 0; i < threads; ++i) {
+        Threads.emplace_back(&FSplitterQueue::WorkerMain, this);
+    }
+}
+
+FNodeBuilder::FSplitterQueue::~FSplitterQueue() {
+    {
+        std::lock_guard<std::mutex> guard(Lock);
+        Stopping = true;
+    }
+    Wake.notify_all();
+
+    for (std::thread &thread : Threads) {
+        thread.join();
+    }
+
+    // only left over when the build was abandoned by an exception
+    for (FSplitterJob *job : Unfinished) {
+        delete job;
+    }
+}
+
+void FNodeBuilder::FSplitterQueue::Submit(FSplitterJob *job) {
+    job->State = FSplitterJob::QUEUED;
+
+    {
+        std::lock_guard<std::mutex> guard(Lock);
+        Pending.push_back(job);
+        Unfinished.push_back(job);
+    }
+    Wake.notify_one();
+}
+
+bool FNodeBuilder::FSplitterQueue::Finish(FSplitterJob *job) {
+    std::unique_lock<std::mutex> guard(Lock);
+
+    Unfinished.erase(std::find(Unfinished.begin(), Unfinished.end(), job));
+
+    if (job->State == FSplitterJob::QUEUED) {
+        Pending.erase(std::find(Pending.begin(), Pending.end(), job));
+        return false;
+    }
+
+    while (job->State != FSplitterJob::DONE) {
+        Done.wait(guard);
+    }
+    return true;
+}
+
+void FNodeBuilder::FSplitterQueue::WorkerMain() {
+    FSplitterWork work;
+
+    work.PlaneChecked.Resize(Builder.SplitWork.PlaneChecked.Size());
+    work.Parallel = false;
+
+    std::unique_lock<std::mutex> guard(Lock);
+
+    for (;;) {
+        while (!Stopping && Pending.empty()) {
+            Wake.wait(guard);
+        }
+        if (Stopping) {
+            break;
+        }
+
+        // The newest job is the one the main thread will need first.
+        FSplitterJob *job = Pending.back();
+        Pending.pop_back();
+        job->State = FSplitterJob::RUNNING;
+
+        guard.unlock();
+        job->Found = Builder.ChooseSplitter(job->Segs, job->Count, job->Node,
+                                            job->SplitSeg, work);
+        guard.lock();
+
+        job->State = FSplitterJob::DONE;
+        Done.notify_all();
+    }
+}
+
+static bool SameSegSet(const FSegSet &a, const FSegSet &b) {
+    unsigned int count = a.Seg.Size();
+
+    if (b.Seg.Size() != count) {
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+    return memcmp(&a.Seg[0], &b.Seg[0], count * sizeof(DWORD)) == 0 &&
+           memcmp(&a.X1[0], &b.X1[0], count * sizeof(double)) == 0 &&
+           memcmp(&a.Y1[0], &b.Y1[0], count * sizeof(double)) == 0 &&
+           memcmp(&a.X2[0], &b.X2[0], count * sizeof(double)) == 0 &&
+           memcmp(&a.Y2[0], &b.Y2[0], count * sizeof(double)) == 0 &&
+           memcmp(&a.LoopNum[0], &b.LoopNum[0], count * sizeof(int)) == 0 &&
+           memcmp(&a.PlaneNum[0], &b.PlaneNum[0], count * sizeof(int)) == 0 &&
+           memcmp(&a.Flags[0], &b.Flags[0], count) == 0;
+}
+
 FNodeBuilder::FNodeBuilder(FLevel &level, TArray<FPolyStart> &polyspots,
                            TArray<FPolyStart> &anchors, const char *name,
-                           bool makeGLnodes)
-    : Level(level), SegsStuffed(0), MapName(name) {
+                           bool makeGLnodes, const FBuildOptions &opts)
+    : SplitQueue(NULL),
+      Level(level),
+      SegsStuffed(0),
+      MapName(name),
+      MaxSegs(opts.MaxSegs),
+      SplitCost(opts.SplitCost),
+      AAPreference(opts.AAPreference) {
     VertexMap =
         new FVertexMap(*this, Level.MinX, Level.MinY, Level.MaxX, Level.MaxY);
     GLNodes = makeGLnodes;
@@ -67,39 +243,76 @@ void FNodeBuilder::BuildTree() {
     fprintf(stderr, "   BSP:   0.0%%\r");
     HackSeg = DWORD_MAX;
     HackMate = DWORD_MAX;
-    CreateNode(0, Segs.Size(), bbox);
+
+    // When several maps are built at once, each one already has a thread.
+    SplitWork.Parallel = !Thread_IsWorker() && Thread_WorkerCount() > 1;
+
+    // Bad maps are reported by throwing, so the queue must be able to
+    // stop and join its threads while the exception unwinds.
+    std::unique_ptr<FSplitterQueue> queue;
+
+    if (SplitWork.Parallel) {
+        queue = std::make_unique<FSplitterQueue>(*this,
+                                                 Thread_WorkerCount() - 1);
+    }
+
+    SplitQueue = queue.get();
+
+    CreateNode(0, Segs.Size(), bbox, NULL);
+
+    SplitQueue = NULL;
+    queue.reset();
+
     CreateSubsectorsForReal();
     fprintf(stderr, "   BSP: 100.0%%\n");
 }
 
-DWORD FNodeBuilder::CreateNode(DWORD set, unsigned int count, fixed_t bbox[4]) {
+// job is the splitter queue's work on this set, or NULL.
+
+DWORD FNodeBuilder::CreateNode(DWORD set, unsigned int count, fixed_t bbox[4],
+                               FSplitterJob *job) {
     node_t node;
-    int skip, selstat;
     DWORD splitseg;
+    bool found;
+
+    GatherSet(set, SplitSet);
+
+    // The queue's answer is only good if the set is still the same. It
+    // changes when one of its segs was split as the partner of a seg in
+    // the subtree that was built in the meantime.
+    if (job != NULL && SplitQueue->Finish(job) &&
+        SameSegSet(job->Segs, SplitSet)) {
+        found = job->Found;
+        node = job->Node;
+        splitseg = job->SplitSeg;
+    } else {
+        found = ChooseSplitter(SplitSet, count, node, splitseg, SplitWork);
+    }
 
-    // When building GL nodes, count may not be an exact count of the number of
-    // segs in this set. That's okay, because we just use it to get a skip
-    // count, so an estimate is fine.
-    skip = int(count / MaxSegs);
+    delete job;
 
-    if ((selstat = SelectSplitter(set, node, splitseg, skip, true)) > 0 ||
-        (skip > 0 &&
-         (selstat = SelectSplitter(set, node, splitseg, 1, true)) > 0) ||
-        (selstat < 0 &&
-         (SelectSplitter(set, node, splitseg, skip, false) > 0 ||
-          (skip > 0 && SelectSplitter(set, node, splitseg, 1, false)))) ||
-        CheckSubsector(set, node, splitseg)) {
+    if (found || CheckSubsector(set, node, splitseg)) {
         // Create a normal node
         DWORD set1, set2;
         unsigned int count1, count2;
+        FSplitterJob *job2 = NULL;
 
         SplitSegs(set, node, splitseg, set1, set2, count1, count2);
         D(PrintSet(1, set1));
         D(Printf("(%d,%d) delta (%d,%d) from seg %d\n", node.x >> 16,
                  node.y >> 16, node.dx >> 16, node.dy >> 16, splitseg));
         D(PrintSet(2, set2));
-        node.intchildren[0] = CreateNode(set1, count1, node.bbox[0]);
-        node.intchildren[1] = CreateNode(set2, count2, node.bbox[1]);
+
+        if (SplitQueue != NULL && count2 >= PARALLEL_SUBTREE_MIN &&
+            count2 <= PARALLEL_SUBTREE_MAX) {
+            job2 = new FSplitterJob;
+            job2->Count = count2;
+            GatherSet(set2, job2->Segs);
+            SplitQueue->Submit(job2);
+        }
+
+        node.intchildren[0] = CreateNode(set1, count1, node.bbox[0], NULL);
+        node.intchildren[1] = CreateNode(set2, count2, node.bbox[1], job2);
         bbox[BOXTOP] = MAX(node.bbox[0][BOXTOP], node.bbox[1][BOXTOP]);
         bbox[BOXBOTTOM] = MIN(node.bbox[0][BOXBOTTOM], node.bbox[1][BOXBOTTOM]);
         bbox[BOXLEFT] = MIN(node.bbox[0][BOXLEFT], node.bbox[1][BOXLEFT]);
@@ -376,6 +589,28 @@ bool FNodeBuilder::ShoveSegBehind(DWORD set, node_t &node, DWORD seg,
     return Heuristic(node, set, false) > 0;
 }
 
+// Tries the splitters of a set, from the most to the least choosy, and
+// returns true if one was found. When building GL nodes, count may not be
+// an exact count of the number of segs in this set. That's okay, because
+// we just use it to get a skip count, so an estimate is fine.
+
+bool FNodeBuilder::ChooseSplitter(const FSegSet &segs, unsigned int count,
+                                  node_t &node, DWORD &splitseg,
+                                  FSplitterWork &work) const {
+    int skip, selstat;
+
+    skip = int(count / MaxSegs);
+
+    return (selstat = SelectSplitter(segs, node, splitseg, skip, true,
+                                     work)) > 0 ||
+           (skip > 0 && (selstat = SelectSplitter(segs, node, splitseg, 1,
+                                                  true, work)) > 0) ||
+           (selstat < 0 &&
+            (SelectSplitter(segs, node, splitseg, skip, false, work) > 0 ||
+             (skip > 0 &&
+              SelectSplitter(segs, node, splitseg, 1, false, work))));
+}
+
 // Splitters are chosen to coincide with segs in the given set. To reduce the
 // number of segs that need to be considered as splitters, segs are grouped into
 // according to the planes that they lie on. Because one seg on the plane is
@@ -383,75 +618,157 @@ bool FNodeBuilder::ShoveSegBehind(DWORD set, node_t &node, DWORD seg,
 // from each unique plane needs to be considered as a splitter. A result of 0
 // means this set is a convex region. A result of -1 means that there were
 // possible splitters, but they all split segs we want to keep intact.
-int FNodeBuilder::SelectSplitter(DWORD set, node_t &node, DWORD &splitseg,
-                                 int step, bool nosplit) {
+int FNodeBuilder::SelectSplitter(const FSegSet &segs, node_t &node,
+                                 DWORD &splitseg, int step, bool nosplit,
+                                 FSplitterWork &work) const {
     int stepleft;
     int bestvalue;
-    DWORD bestseg;
-    DWORD seg;
+    unsigned int best;
+    unsigned int i;
+    unsigned int count = segs.Seg.Size();
     bool nosplitters = false;
 
     bestvalue = 0;
-    bestseg = DWORD_MAX;
+    best = count;
 
-    seg = set;
     stepleft = 0;
 
-    memset(&PlaneChecked[0], 0, PlaneChecked.Size());
+    memset(&work.PlaneChecked[0], 0, work.PlaneChecked.Size());
+    work.Candidates.Clear();
 
-    D(printf("Processing set %d\n", set));
-
-    while (seg != DWORD_MAX) {
-        FPrivSeg *pseg = &Segs[seg];
+    D(printf("Processing set %d\n", segs.Seg[0]));
 
+    for (i = 0; i < count; ++i) {
         if (--stepleft <= 0) {
-            int l = pseg->planenum >> 3;
-            int r = 1 << (pseg->planenum & 7);
+            int l = segs.PlaneNum[i] >> 3;
+            int r = 1 << (segs.PlaneNum[i] & 7);
 
-            if (l < 0 || (PlaneChecked[l] & r) == 0) {
+            if (l < 0 || (work.PlaneChecked[l] & r) == 0) {
                 if (l >= 0) {
-                    PlaneChecked[l] |= r;
+                    work.PlaneChecked[l] |= r;
                 }
 
                 stepleft = step;
-                SetNodeFromSeg(node, pseg);
+                work.Candidates.Push(i);
+            }
+        }
+    }
 
-                int value = Heuristic(node, set, nosplit);
+    // Scoring a splitter does not modify anything, so that can be done
+    // in parallel. Picking the best one is done here, in seg order, so the
+    // result is the same as when they are all scored one at a time.
+    ScoreSplitters(segs, nosplit, work);
 
-                D(Printf("Seg %5d, ld %d (%5d,%5d)-(%5d,%5d) scores %d\n", seg,
-                         Segs[seg].linedef, node.x >> 16, node.y >> 16,
-                         (node.x + node.dx) >> 16, (node.y + node.dy) >> 16,
-                         value));
+    for (unsigned int c = 0; c < work.Candidates.Size(); ++c) {
+        int value = work.Scores[c];
 
-                if (value > bestvalue) {
-                    bestvalue = value;
-                    bestseg = seg;
-                } else if (value < 0) {
-                    nosplitters = true;
-                }
-            } else {
-                pseg = pseg;
-            }
-        }
+        i = work.Candidates[c];
 
-        seg = pseg->next;
+        D(Printf("Seg %5d scores %d\n", segs.Seg[i], value));
+
+        if (value > bestvalue) {
+            bestvalue = value;
+            best = i;
+        } else if (value < 0) {
+            nosplitters = true;
+        }
     }
 
-    if (bestseg == DWORD_MAX) {  // No lines split any others into two sets, so
-                                 // this is a convex region.
-        D(Printf("set %d, step %d, nosplit %d has no good splitter (%d)\n", set,
-                 step, nosplit, nosplitters));
+    if (best == count) {  // No lines split any others into two sets, so
+                          // this is a convex region.
+        D(Printf("set %d, step %d, nosplit %d has no good splitter (%d)\n",
+                 segs.Seg[0], step, nosplit, nosplitters));
         return nosplitters ? -1 : 0;
     }
 
-    D(Printf("split seg %u in set %u, score %d, step %d, nosplit %d\n", bestseg,
-             set, bestvalue, step, nosplit));
+    D(Printf("split seg %u in set %u, score %d, step %d, nosplit %d\n",
+             segs.Seg[best], segs.Seg[0], bestvalue, step, nosplit));
 
-    splitseg = bestseg;
-    SetNodeFromSeg(node, &Segs[bestseg]);
+    splitseg = segs.Seg[best];
+    SetNodeFromSet(node, segs, best);
     return 1;
 }
 
+// Copies the segs of a set into segs, in the same order as the links.
+void FNodeBuilder::GatherSet(DWORD set, FSegSet &segs) {
+    unsigned int count = 0;
+
+    for (DWORD i = set; i != DWORD_MAX; i = Segs[i].next) {
+        count++;
+    }
+
+    segs.Seg.Resize(count);
+    segs.X1.Resize(count);
+    segs.Y1.Resize(count);
+    segs.X2.Resize(count);
+    segs.Y2.Resize(count);
+    segs.LoopNum.Resize(count);
+    segs.PlaneNum.Resize(count);
+    segs.Flags.Resize(count);
+
+    for (unsigned int j = 0; j < count; ++j) {
+        const FPrivSeg *seg = &Segs[set];
+        const FPrivVert *v1 = &Vertices[seg->v1];
+        const FPrivVert *v2 = &Vertices[seg->v2];
+        BYTE flags = 0;
+
+        if (seg->linedef != -1) {
+            flags |= SEGSET_REAL;
+            if (seg->frontsector == seg->backsector) {
+                flags |= SEGSET_SPECIAL;
+            }
+        }
+
+        segs.Seg[j] = set;
+        segs.X1[j] = double(v1->x);
+        segs.Y1[j] = double(v1->y);
+        segs.X2[j] = double(v2->x);
+        segs.Y2[j] = double(v2->y);
+        segs.LoopNum[j] = seg->loopnum;
+        segs.PlaneNum[j] = seg->planenum;
+        segs.Flags[j] = flags;
+
+        set = seg->next;
+    }
+}
+
+// Fills work.Scores with the Heuristic() value of every seg in
+// work.Candidates. Big sets are spread over the worker threads, unless
+// this map is already being built on a worker thread (i.e. several maps
+// are being built at once), since that would only oversubscribe the CPU.
+// Splitters are never chosen for the seg forced behind by ShoveSegBehind().
+void FNodeBuilder::ScoreSplitters(const FSegSet &segs, bool nosplit,
+                                  FSplitterWork &work) const {
+    unsigned int count = work.Candidates.Size();
+
+    work.Scores.Resize(count);
+
+    double amount = double(count) * double(segs.Seg.Size());
+
+    if (count < 2 || amount < PARALLEL_SPLITTER_WORK || !work.Parallel) {
+        for (unsigned int i = 0; i < count; ++i) {
+            node_t node;
+            SetNodeFromSet(node, segs, work.Candidates[i]);
+            work.Scores[i] = Heuristic(node, segs, nosplit, DWORD_MAX,
+                                       work.Touched, work.Colinear);
+        }
+        return;
+    }
+
+    // every worker needs its own scratch lists
+    int num_workers = Thread_WorkerCount();
+
+    std::vector<TArray<int>> touched(num_workers);
+    std::vector<TArray<int>> colinear(num_workers);
+
+    Thread_ParallelFor((int)count, [&](int index, int worker) {
+        node_t node;
+        SetNodeFromSet(node, segs, work.Candidates[index]);
+        work.Scores[index] = Heuristic(node, segs, nosplit, DWORD_MAX,
+                                       touched[worker], colinear[worker]);
+    });
+}
+
 // Given a splitter (node), returns a score based on how "good" the resulting
 // split in a set of segs is. Higher scores are better. -1 means this splitter
 // splits something it shouldn't and will only be returned if honorNoSplit is
@@ -459,31 +776,52 @@ int FNodeBuilder::SelectSplitter(DWORD set, node_t &node, DWORD &splitseg,
 // in the set.
 
 int FNodeBuilder::Heuristic(node_t &node, DWORD set, bool honorNoSplit) {
+    GatherSet(set, SplitSet);
+    return Heuristic(node, SplitSet, honorNoSplit, HackSeg, SplitWork.Touched,
+                     SplitWork.Colinear);
+}
+
+int FNodeBuilder::Heuristic(node_t &node, const FSegSet &segs,
+                            bool honorNoSplit, DWORD hackseg,
+                            TArray<int> &touched, TArray<int> &colinear) const {
     // Set the initial score above 0 so that near vertex anti-weighting is less
     // likely to produce a negative score.
     int score = 1000000;
-    int segsInSet = 0;
+    unsigned int total = segs.Seg.Size();
+    int segsInSet = total;
     int counts[2] = {0, 0};
     int realSegs[2] = {0, 0};
     int specialSegs[2] = {0, 0};
-    DWORD i = set;
-    int sidev[2];
+    int sides[CLASSIFY_BATCH];
+    int sidevs[CLASSIFY_BATCH][2];
+    int *sidev = sidevs[0];
     int side;
     bool splitter = false;
     unsigned int max, m2, p, q;
     double frac;
 
-    Touched.Clear();
-    Colinear.Clear();
+    touched.Clear();
+    colinear.Clear();
+
+    for (unsigned int j = 0; j < total; ++j) {
+        // segs are classified a batch at a time
+        unsigned int b = j % CLASSIFY_BATCH;
+
+        if (b == 0) {
+            ClassifyLines(node, segs, j,
+                          MIN(total - j, (unsigned int)CLASSIFY_BATCH), sides,
+                          sidevs);
+        }
 
-    while (i != DWORD_MAX) {
-        const FPrivSeg *test = &Segs[i];
+        DWORD i = segs.Seg[j];
+        int loopnum = segs.LoopNum[j];
+        BYTE flags = segs.Flags[j];
 
-        if (HackSeg == i) {
+        if (hackseg == i) {
             side = 1;
         } else {
-            side = ClassifyLine(node, &Vertices[test->v1], &Vertices[test->v2],
-                                sidev);
+            side = sides[b];
+            sidev = sidevs[b];
         }
 
         switch (side) {
@@ -494,48 +832,43 @@ int FNodeBuilder::Heuristic(node_t &node, DWORD set, bool honorNoSplit) {
                 // reject it if there is another nosplit seg from the same
                 // sector at this vertex. Note that a line that lies exactly on
                 // top of the splitter is okay.
-                if (test->loopnum && honorNoSplit &&
+                if (loopnum && honorNoSplit &&
                     (sidev[0] == 0 || sidev[1] == 0)) {
                     if ((sidev[0] | sidev[1]) != 0) {
-                        max = Touched.Size();
+                        max = touched.Size();
                         for (p = 0; p < max; ++p) {
-                            if (Touched[p] == test->loopnum) {
+                            if (touched[p] == loopnum) {
                                 break;
                             }
                         }
                         if (p == max) {
-                            Touched.Push(test->loopnum);
+                            touched.Push(loopnum);
                         }
                     } else {
-                        max = Colinear.Size();
+                        max = colinear.Size();
                         for (p = 0; p < max; ++p) {
-                            if (Colinear[p] == test->loopnum) {
+                            if (colinear[p] == loopnum) {
                                 break;
                             }
                         }
                         if (p == max) {
-                            Colinear.Push(test->loopnum);
+                            colinear.Push(loopnum);
                         }
                     }
                 }
 
+                // Add some weight to the score for unsplit lines. Minisegs
+                // don't count quite as much for nosplitting. Real segs and
+                // minisegs are well mixed, so this is done without branching.
                 counts[side]++;
-                if (test->linedef != -1) {
-                    realSegs[side]++;
-                    if (test->frontsector == test->backsector) {
-                        specialSegs[side]++;
-                    }
-                    // Add some weight to the score for unsplit lines
-                    score += SplitCost;
-                } else {
-                    // Minisegs don't count quite as much for nosplitting
-                    score += SplitCost / 4;
-                }
+                realSegs[side] += flags & SEGSET_REAL;
+                specialSegs[side] += (flags & SEGSET_SPECIAL) >> 1;
+                score += (flags & SEGSET_REAL) ? SplitCost : SplitCost / 4;
                 break;
 
             default:  // Seg is cut by the partition
                 // If we are not allowed to split this seg, reject this splitter
-                if (test->loopnum) {
+                if (loopnum) {
                     if (honorNoSplit) {
                         D(Printf("Splits seg %d\n", i));
                         return -1;
@@ -545,23 +878,23 @@ int FNodeBuilder::Heuristic(node_t &node, DWORD set, bool honorNoSplit) {
                 }
 
                 // Splitters that are too close to a vertex are bad.
-                frac = InterceptVector(node, *test);
+                frac = InterceptVector(node, segs, j);
                 if (frac < 0.001 || frac > 0.999) {
-                    FPrivVert *v1 = &Vertices[test->v1];
-                    FPrivVert *v2 = &Vertices[test->v2];
-                    double x = v1->x, y = v1->y;
-                    x += frac * (v2->x - x);
-                    y += frac * (v2->y - y);
-                    if (fabs(x - v1->x) < VERTEX_EPSILON + 1 &&
-                        fabs(y - v1->y) < VERTEX_EPSILON + 1) {
+                    double x1 = segs.X1[j], y1 = segs.Y1[j];
+                    double x2 = segs.X2[j], y2 = segs.Y2[j];
+                    double x = x1, y = y1;
+                    x += frac * (x2 - x);
+                    y += frac * (y2 - y);
+                    if (fabs(x - x1) < VERTEX_EPSILON + 1 &&
+                        fabs(y - y1) < VERTEX_EPSILON + 1) {
                         D(
                             Printf("Splitter will produce same start vertex as "
                                    "seg %d\n",
                                    i));
                         return -1;
                     }
-                    if (fabs(x - v2->x) < VERTEX_EPSILON + 1 &&
-                        fabs(y - v2->y) < VERTEX_EPSILON + 1) {
+                    if (fabs(x - x2) < VERTEX_EPSILON + 1 &&
+                        fabs(y - y2) < VERTEX_EPSILON + 1) {
                         D(Printf(
                             "Splitter will produce same end vertex as seg %d\n",
                             i));
@@ -580,19 +913,16 @@ int FNodeBuilder::Heuristic(node_t &node, DWORD set, bool honorNoSplit) {
 
                 counts[0]++;
                 counts[1]++;
-                if (test->linedef != -1) {
+                if (flags & SEGSET_REAL) {
                     realSegs[0]++;
                     realSegs[1]++;
-                    if (test->frontsector == test->backsector) {
+                    if (flags & SEGSET_SPECIAL) {
                         specialSegs[0]++;
                         specialSegs[1]++;
                     }
                 }
                 break;
         }
-
-        segsInSet++;
-        i = test->next;
     }
 
     // If this line is outside all the others, return a special score
@@ -625,8 +955,8 @@ int FNodeBuilder::Heuristic(node_t &node, DWORD set, bool honorNoSplit) {
     // crosses the vertex of another seg of that sector must be crossing the
     // container's corner and does not actually split the container.
 
-    max = Touched.Size();
-    m2 = Colinear.Size();
+    max = touched.Size();
+    m2 = colinear.Size();
 
     // If honorNoSplit is false, then both these lists will be empty.
 
@@ -637,9 +967,9 @@ int FNodeBuilder::Heuristic(node_t &node, DWORD set, bool honorNoSplit) {
     }
 
     for (p = 0; p < max; ++p) {
-        int look = Touched[p];
+        int look = touched[p];
         for (q = 0; q < m2; ++q) {
-            if (look == Colinear[q]) {
+            if (look == colinear[q]) {
                 break;
             }
         }
@@ -840,6 +1170,23 @@ void FNodeBuilder::SetNodeFromSeg(node_t &node, const FPrivSeg *pseg) const {
     }
 }
 
+// Same as SetNodeFromSeg(), for the seg at index in a copied set.
+void FNodeBuilder::SetNodeFromSet(node_t &node, const FSegSet &segs,
+                                  unsigned int index) const {
+    if (segs.PlaneNum[index] >= 0) {
+        FSimpleLine *pline = &Planes[segs.PlaneNum[index]];
+        node.x = pline->x;
+        node.y = pline->y;
+        node.dx = pline->dx;
+        node.dy = pline->dy;
+    } else {
+        node.x = fixed_t(segs.X1[index]);
+        node.y = fixed_t(segs.Y1[index]);
+        node.dx = fixed_t(segs.X2[index]) - node.x;
+        node.dy = fixed_t(segs.Y2[index]) - node.y;
+    }
+}
+
 DWORD FNodeBuilder::SplitSeg(DWORD segnum, int splitvert, int v1InFront) {
     double dx, dy;
     FPrivSeg newseg;
@@ -947,6 +1294,26 @@ double FNodeBuilder::InterceptVector(const node_t &splitter,
     return num / den;
 }
 
+double FNodeBuilder::InterceptVector(const node_t &splitter,
+                                     const FSegSet &segs, unsigned int index) {
+    double v2x = segs.X1[index];
+    double v2y = segs.Y1[index];
+    double v2dx = segs.X2[index] - v2x;
+    double v2dy = segs.Y2[index] - v2y;
+    double v1dx = (double)splitter.dx;
+    double v1dy = (double)splitter.dy;
+
+    double den = v1dy * v2dx - v1dx * v2dy;
+
+    if (den == 0.0) return 0;  // parallel
+
+    double v1x = (double)splitter.x;
+    double v1y = (double)splitter.y;
+
+    double num = (v1x - v2x) * v1dy + (v2y - v1y) * v1dx;
+    return num / den;
+}
+
 void FNodeBuilder::PrintSet(int l, DWORD set) {
     Printf("set %d:\n", l);
     for (; set != DWORD_MAX; set = Segs[set].next) {
@@ -53,6 +53,23 @@ struct FSimpleVert {
     fixed_t x, y;
 };
 
+// A set of segs copied into flat arrays, so that splitters can be scored
+// without following the seg links and looking up vertices for every test.
+// The endpoints are stored as separate coordinate arrays, which lets
+// ClassifyLines() test several segs at a time.
+enum {
+    SEGSET_REAL = 1,     // seg comes from a linedef (i.e. not a miniseg)
+    SEGSET_SPECIAL = 2,  // real seg with the same sector on both sides
+};
+
+struct FSegSet {
+    TArray<DWORD> Seg;
+    TArray<double> X1, Y1, X2, Y2;
+    TArray<int> LoopNum;
+    TArray<int> PlaneNum;
+    TArray<BYTE> Flags;
+};
+
 extern "C" {
 int ClassifyLine2(node_t &node, const FSimpleVert *v1, const FSimpleVert *v2,
                   int sidev[2]);
@@ -69,6 +86,11 @@ int __declspec(noinline)
 #endif
 }
 
+// Same as ClassifyLine2() for count segs of a set starting at first.
+// The results go in side[] and sidev[].
+void ClassifyLines(const node_t &node, const FSegSet &segs, unsigned int first,
+                   unsigned int count, int *side, int (*sidev)[2]);
+
 class FNodeBuilder {
     struct FPrivSeg {
         int v1, v2;
@@ -154,7 +176,7 @@ class FNodeBuilder {
 
     FNodeBuilder(FLevel &level, TArray<FPolyStart> &polyspots,
                  TArray<FPolyStart> &anchors, const char *name,
-                 bool makeGLnodes);
+                 bool makeGLnodes, const FBuildOptions &opts);
     ~FNodeBuilder();
 
     void GetVertices(WideVertex *&verts, int &count);
@@ -179,13 +201,26 @@ class FNodeBuilder {
     TArray<FPrivSeg> Segs;
     TArray<FPrivVert> Vertices;
     TArray<USegPtr> SegList;
-    TArray<BYTE> PlaneChecked;
     TArray<FSimpleLine> Planes;
     size_t InitialVertices;  // Number of vertices in a map that are connected
                              // to linedefs
 
-    TArray<int> Touched;   // Loops a splitter touches on a vertex
-    TArray<int> Colinear;  // Loops with edges colinear to a splitter
+    // Scratch space for choosing a splitter. Each thread of the splitter
+    // queue has its own.
+    struct FSplitterWork {
+        TArray<BYTE> PlaneChecked;
+        TArray<unsigned int> Candidates;  // Segs to try (index in the set)
+        TArray<int> Scores;    // Heuristic() value of each candidate
+        TArray<int> Touched;   // Loops a splitter touches on a vertex
+        TArray<int> Colinear;  // Loops with edges colinear to a splitter
+        bool Parallel;         // Big sets may be scored on worker threads
+    };
+    struct FSplitterJob;
+    class FSplitterQueue;
+
+    FSplitterWork SplitWork;
+    FSegSet SplitSet;              // The set splitters are chosen from
+    FSplitterQueue *SplitQueue;    // Chooses splitters for later subtrees
     FEventTree Events;     // Vertices intersected by the current splitter
     TArray<FSplitSharer>
         SplitSharers;  // Segs collinear with the current splitter
@@ -199,6 +234,11 @@ class FNodeBuilder {
     int SegsStuffed;
     const char *MapName;
 
+    // Splitter selection tuning, from FBuildOptions
+    int MaxSegs;
+    int SplitCost;
+    int AAPreference;
+
     void FindUsedVertices(WideVertex *vertices, int max);
     void BuildTree();
     void MakeSegsFromSides();
@@ -209,19 +249,28 @@ class FNodeBuilder {
     bool GetPolyExtents(int polynum, fixed_t bbox[4]);
     int MarkLoop(DWORD firstseg, int loopnum);
     void AddSegToBBox(fixed_t bbox[4], const FPrivSeg *seg);
-    DWORD CreateNode(DWORD set, unsigned int count, fixed_t bbox[4]);
+    DWORD CreateNode(DWORD set, unsigned int count, fixed_t bbox[4],
+                     FSplitterJob *job);
     DWORD CreateSubsector(DWORD set, fixed_t bbox[4]);
     void CreateSubsectorsForReal();
     bool CheckSubsector(DWORD set, node_t &node, DWORD &splitseg);
     bool CheckSubsectorOverlappingSegs(DWORD set, node_t &node,
                                        DWORD &splitseg);
     bool ShoveSegBehind(DWORD set, node_t &node, DWORD seg, DWORD mate);
-    int SelectSplitter(DWORD set, node_t &node, DWORD &splitseg, int step,
-                       bool nosplit);
+    bool ChooseSplitter(const FSegSet &segs, unsigned int count, node_t &node,
+                        DWORD &splitseg, FSplitterWork &work) const;
+    int SelectSplitter(const FSegSet &segs, node_t &node, DWORD &splitseg,
+                       int step, bool nosplit, FSplitterWork &work) const;
     void SplitSegs(DWORD set, node_t &node, DWORD splitseg, DWORD &outset0,
                    DWORD &outset1, unsigned int &count0, unsigned int &count1);
     DWORD SplitSeg(DWORD segnum, int splitvert, int v1InFront);
+    void GatherSet(DWORD set, FSegSet &segs);
+    void ScoreSplitters(const FSegSet &segs, bool nosplit,
+                        FSplitterWork &work) const;
     int Heuristic(node_t &node, DWORD set, bool honorNoSplit);
+    int Heuristic(node_t &node, const FSegSet &segs, bool honorNoSplit,
+                  DWORD hackseg, TArray<int> &touched,
+                  TArray<int> &colinear) const;
 
     // Returns:
     //	0 = seg is in front
@@ -241,6 +290,8 @@ class FNodeBuilder {
     void RemoveSegFromVert2(DWORD segnum, int vertnum);
     DWORD AddMiniseg(int v1, int v2, DWORD partner, DWORD seg1, DWORD splitseg);
     void SetNodeFromSeg(node_t &node, const FPrivSeg *pseg) const;
+    void SetNodeFromSet(node_t &node, const FSegSet &segs,
+                        unsigned int index) const;
 
     int RemoveMinisegs(MapNodeEx *nodes, TArray<MapSegEx> &segs,
                        MapSubsectorEx *subs, int node, short bbox[4]);
@@ -257,6 +308,8 @@ class FNodeBuilder {
     static int SortSegs(const void *a, const void *b);
 
     double InterceptVector(const node_t &splitter, const FPrivSeg &seg);
+    static double InterceptVector(const node_t &splitter, const FSegSet &segs,
+                                  unsigned int index);
 
     void PrintSet(int l, DWORD set);
     void DumpNodes(MapNodeEx *outNodes, int nodeCount);
@@ -298,6 +351,97 @@ inline int FNodeBuilder::PointOnSide(int x, int y, int x1, int y1, int dx,
     return s_num > 0.0 ? -1 : 1;
 }
 
+// The part of ClassifyLine2() after the distances of the seg's endpoints
+// from the splitter (s_num1 and s_num2) are known. segdx and segdy are
+// the direction of the seg, for when it lies on the splitter.
+inline int ClassifySides(const node_t &node, double s_num1, double s_num2,
+                         double segdx, double segdy, int sidev[2]) {
+    const double far_enough = 17179869184.f;  // 4<<32
+
+    int nears = 0;
+
+    if (s_num1 <= -far_enough) {
+        if (s_num2 <= -far_enough) {
+            sidev[0] = sidev[1] = 1;
+            return 1;
+        }
+        if (s_num2 >= far_enough) {
+            sidev[0] = 1;
+            sidev[1] = -1;
+            return -1;
+        }
+        nears = 1;
+    } else if (s_num1 >= far_enough) {
+        if (s_num2 >= far_enough) {
+            sidev[0] = sidev[1] = -1;
+            return 0;
+        }
+        if (s_num2 <= -far_enough) {
+            sidev[0] = -1;
+            sidev[1] = 1;
+            return -1;
+        }
+        nears = 1;
+    } else {
+        nears = 2 | int(fabs(s_num2) < far_enough);
+    }
+
+    if (nears) {
+        double d_dx = double(node.dx);
+        double d_dy = double(node.dy);
+        double l = 1.f / (d_dx * d_dx + d_dy * d_dy);
+        if (nears & 2) {
+            double dist = s_num1 * s_num1 * l;
+            if (dist < SIDE_EPSILON * SIDE_EPSILON) {
+                sidev[0] = 0;
+            } else {
+                sidev[0] = s_num1 > 0.0 ? -1 : 1;
+            }
+        } else {
+            sidev[0] = s_num1 > 0.0 ? -1 : 1;
+        }
+        if (nears & 1) {
+            double dist = s_num2 * s_num2 * l;
+            if (dist < SIDE_EPSILON * SIDE_EPSILON) {
+                sidev[1] = 0;
+            } else {
+                sidev[1] = s_num2 > 0.0 ? -1 : 1;
+            }
+        } else {
+            sidev[1] = s_num2 > 0.0 ? -1 : 1;
+        }
+    } else {
+        sidev[0] = s_num1 > 0.0 ? -1 : 1;
+        sidev[1] = s_num2 > 0.0 ? -1 : 1;
+    }
+
+    if ((sidev[0] | sidev[1]) ==
+        0) {  // seg is coplanar with the splitter, so use its orientation to
+              // determine which child it ends up in. If it faces the same
+              // direction as the splitter, it goes in front. Otherwise, it goes
+              // in back.
+
+        if (node.dx != 0) {
+            if ((node.dx > 0 && segdx > 0) || (node.dx < 0 && segdx < 0)) {
+                return 0;
+            } else {
+                return 1;
+            }
+        } else {
+            if ((node.dy > 0 && segdy > 0) || (node.dy < 0 && segdy < 0)) {
+                return 0;
+            } else {
+                return 1;
+            }
+        }
+    } else if (sidev[0] <= 0 && sidev[1] <= 0) {
+        return 0;
+    } else if (sidev[0] >= 0 && sidev[1] >= 0) {
+        return 1;
+    }
+    return -1;
+}
+
 inline int FNodeBuilder::ClassifyLine(node_t &node, const FPrivVert *v1,
                                       const FPrivVert *v2, int sidev[2]) {
     return ClassifyLine2(node, v1, v2, sidev);
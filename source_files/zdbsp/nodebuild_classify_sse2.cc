@@ -0,0 +1,107 @@
+/*
+    Determine what side of a splitter a whole run of segs lies on.
+    Copyright (C) 2002-2006 Randy Heit
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include "nodebuild.h"
+#include "zdbsp.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLASSIFY_USE_SSE2
+#endif
+
+#define FAR_ENOUGH 17179869184.f  // 4<<32
+
+// The distances are worked out exactly like ClassifyLine2() does, just two
+// segs at a time, so the results are the same. Most segs lie well away
+// from the splitter on one side, and those are settled right here; the
+// rest go through the full test in ClassifySides().
+void ClassifyLines(const node_t &node, const FSegSet &segs, unsigned int first,
+                   unsigned int count, int *side, int (*sidev)[2]) {
+    const double d_x1 = double(node.x);
+    const double d_y1 = double(node.y);
+    const double d_dx = double(node.dx);
+    const double d_dy = double(node.dy);
+
+    const double *x1 = &segs.X1[first];
+    const double *y1 = &segs.Y1[first];
+    const double *x2 = &segs.X2[first];
+    const double *y2 = &segs.Y2[first];
+
+    unsigned int i = 0;
+
+#ifdef CLASSIFY_USE_SSE2
+    const __m128d nx = _mm_set1_pd(d_x1);
+    const __m128d ny = _mm_set1_pd(d_y1);
+    const __m128d ndx = _mm_set1_pd(d_dx);
+    const __m128d ndy = _mm_set1_pd(d_dy);
+    const __m128d far_pos = _mm_set1_pd(FAR_ENOUGH);
+    const __m128d far_neg = _mm_set1_pd(-FAR_ENOUGH);
+
+    for (; i + 2 <= count; i += 2) {
+        __m128d num1 =
+            _mm_sub_pd(_mm_mul_pd(_mm_sub_pd(ny, _mm_loadu_pd(y1 + i)), ndx),
+                       _mm_mul_pd(_mm_sub_pd(nx, _mm_loadu_pd(x1 + i)), ndy));
+        __m128d num2 =
+            _mm_sub_pd(_mm_mul_pd(_mm_sub_pd(ny, _mm_loadu_pd(y2 + i)), ndx),
+                       _mm_mul_pd(_mm_sub_pd(nx, _mm_loadu_pd(x2 + i)), ndy));
+
+        int back = _mm_movemask_pd(_mm_and_pd(_mm_cmple_pd(num1, far_neg),
+                                              _mm_cmple_pd(num2, far_neg)));
+        int front = _mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(num1, far_pos),
+                                               _mm_cmpge_pd(num2, far_pos)));
+
+        // segs that are far away on one side just need the side copied
+        for (int k = 0; k < 2; k++) {
+            int in_back = (back >> k) & 1;
+
+            side[i + k] = in_back;
+            sidev[i + k][0] = sidev[i + k][1] = in_back * 2 - 1;
+        }
+
+        int nears = ~(back | front) & 3;
+
+        if (nears != 0) {
+            double s_num1[2], s_num2[2];
+
+            _mm_storeu_pd(s_num1, num1);
+            _mm_storeu_pd(s_num2, num2);
+
+            for (int k = 0; k < 2; k++) {
+                if (nears & (1 << k)) {
+                    unsigned int j = i + k;
+
+                    side[j] =
+                        ClassifySides(node, s_num1[k], s_num2[k], x2[j] - x1[j],
+                                      y2[j] - y1[j], sidev[j]);
+                }
+            }
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        double s_num1 = (d_y1 - y1[i]) * d_dx - (d_x1 - x1[i]) * d_dy;
+        double s_num2 = (d_y1 - y2[i]) * d_dx - (d_x1 - x2[i]) * d_dy;
+
+        side[i] = ClassifySides(node, s_num1, s_num2, x2[i] - x1[i],
+                                y2[i] - y1[i], sidev[i]);
+    }
+}
@@ -213,7 +213,7 @@ void FNodeBuilder::GroupSegPlanes() {
 
     D(printf("%d planes from %d segs\n", planenum, Segs.Size()));
 
-    PlaneChecked.Reserve((planenum + 7) / 8);
+    SplitWork.PlaneChecked.Reserve((planenum + 7) / 8);
 }
 
 // Find "loops" of segs surrounding polyobject's origin. Note that a
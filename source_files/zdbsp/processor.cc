@@ -51,8 +51,13 @@ FLevel::~FLevel() {
     if (OrgSectorMap) delete[] OrgSectorMap;
 }
 
-FProcessor::FProcessor(FWadReader &inwad, int lump) : Wad(inwad), Lump(lump) {
-    printf("----%s----\n", Wad.LumpName(Lump));
+FProcessor::FProcessor(FWadReader &inwad, int lump, const FBuildOptions &opts,
+                       const Doom::udmf_level_t *udmf)
+    : Wad(inwad), Lump(lump), UDMFSource(udmf), Opts(opts) {
+    strncpy(MapName, Wad.LumpName(Lump), 8);
+    MapName[8] = 0;
+
+    printf("----%s----\n", MapName);
 
     isUDMF = Wad.isUDMF(lump);
 
@@ -74,12 +79,12 @@ FProcessor::FProcessor(FWadReader &inwad, int lump) : Wad(inwad), Lump(lump) {
     } else {
         // Removing extra vertices is done by the node builder.
         Level.RemoveExtraLines();
-        if (!NoPrune) {
+        if (!Opts.NoPrune) {
             Level.RemoveExtraSides();
             Level.RemoveExtraSectors();
         }
 
-        if (BuildNodes) {
+        if (Opts.BuildNodes) {
             GetPolySpots();
         }
 
@@ -408,7 +413,7 @@ void FLevel::RemoveExtraSectors() {
 }
 
 void FProcessor::GetPolySpots() {
-    if (Extended && CheckPolyobjs) {
+    if (Extended && Opts.CheckPolyobjs) {
         int spot1, spot2, anchor, i;
 
         // Determine if this is a Hexen map by looking for things of type 3000
@@ -495,21 +500,21 @@ void FProcessor::Write(FWadWriter &out) {
     }
 #endif
 
-    if (BuildNodes) {
+    if (Opts.BuildNodes) {
         FNodeBuilder *builder = NULL;
 
         // ZDoom's UDMF spec requires compressed GL nodes.
         // No other UDMF spec has defined anything regarding nodes yet.
         if (isUDMF) {
-            BuildGLNodes = true;
-            ConformNodes = false;
-            GLOnly = true;
-            CompressGLNodes = true;
+            Opts.BuildGLNodes = true;
+            Opts.ConformNodes = false;
+            Opts.GLOnly = true;
+            Opts.CompressGLNodes = true;
         }
 
         try {
             builder = new FNodeBuilder(Level, PolyStarts, PolyAnchors,
-                                       Wad.LumpName(Lump), BuildGLNodes);
+                                       MapName, Opts.BuildGLNodes, Opts);
             if (builder == NULL) {
                 throw std::runtime_error(
                     "   Not enough memory to build nodes!");
@@ -518,7 +523,7 @@ void FProcessor::Write(FWadWriter &out) {
             delete[] Level.Vertices;
             builder->GetVertices(Level.Vertices, Level.NumVertices);
 
-            if (ConformNodes) {
+            if (Opts.ConformNodes) {
                 // When the nodes are "conformed", the normal and GL nodes use
                 // the same basic information. This creates normal nodes that
                 // are less "good" than possible, but it makes it easier to
@@ -532,19 +537,19 @@ void FProcessor::Write(FWadWriter &out) {
                                     Level.GLSegs, Level.NumGLSegs,
                                     Level.GLSubsectors, Level.NumGLSubsectors);
             } else {
-                if (BuildGLNodes) {
+                if (Opts.BuildGLNodes) {
                     builder->GetVertices(Level.GLVertices, Level.NumGLVertices);
                     builder->GetGLNodes(Level.GLNodes, Level.NumGLNodes,
                                         Level.GLSegs, Level.NumGLSegs,
                                         Level.GLSubsectors,
                                         Level.NumGLSubsectors);
 
-                    if (!GLOnly) {
+                    if (!Opts.GLOnly) {
                         // Now repeat the process to obtain regular nodes
                         delete builder;
                         builder =
                             new FNodeBuilder(Level, PolyStarts, PolyAnchors,
-                                             Wad.LumpName(Lump), false);
+                                             MapName, false, Opts);
                         if (builder == NULL) {
                             throw std::runtime_error(
                                 "   Not enough memory to build regular nodes!");
@@ -553,7 +558,7 @@ void FProcessor::Write(FWadWriter &out) {
                         builder->GetVertices(Level.Vertices, Level.NumVertices);
                     }
                 }
-                if (!GLOnly) {
+                if (!Opts.GLOnly) {
                     builder->GetNodes(Level.Nodes, Level.NumNodes, Level.Segs,
                                       Level.NumSegs, Level.Subsectors,
                                       Level.NumSubsectors);
@@ -578,7 +583,7 @@ void FProcessor::Write(FWadWriter &out) {
         Level.RejectSize = (Level.NumSectors() * Level.NumSectors() + 7) / 8;
         Level.Reject = NULL;
 
-        switch (RejectMode) {
+        switch (Opts.RejectMode) {
             case ERM_Rebuild_NoGL: {
                 FRejectBuilderNoGL reject(Level);
                 Level.Reject = reject.GetReject();
@@ -626,17 +631,17 @@ void FProcessor::Write(FWadWriter &out) {
 
     if (!isUDMF) {
         if (Level.GLNodes != NULL) {
-            gl5 = V5GLNodes || (Level.NumGLVertices > 32767) ||
+            gl5 = Opts.V5GLNodes || (Level.NumGLVertices > 32767) ||
                   (Level.NumGLSegs > 65534) || (Level.NumGLNodes > 32767) ||
                   (Level.NumGLSubsectors > 32767);
-            compressGL = CompressGLNodes || (Level.NumVertices > 32767);
+            compressGL = Opts.CompressGLNodes || (Level.NumVertices > 32767);
         } else {
             compressGL = false;
         }
 
         // If the GL nodes are compressed, then the regular nodes must also be
         // compressed.
-        compress = CompressNodes || compressGL || (Level.NumVertices > 65535) ||
+        compress = Opts.CompressNodes || compressGL || (Level.NumVertices > 65535) ||
                    (Level.NumSegs > 65535) || (Level.NumSubsectors > 32767) ||
                    (Level.NumNodes > 32767);
 
@@ -645,10 +650,10 @@ void FProcessor::Write(FWadWriter &out) {
         WriteLines(out);
         WriteSides(out);
         WriteVertices(
-            out, compress || GLOnly ? Level.NumOrgVerts : Level.NumVertices);
-        if (BuildNodes) {
+            out, compress || Opts.GLOnly ? Level.NumOrgVerts : Level.NumVertices);
+        if (Opts.BuildNodes) {
             if (!compress) {
-                if (!GLOnly) {
+                if (!Opts.GLOnly) {
                     WriteSegs(out);
                     WriteSSectors(out);
                     WriteNodes(out);
@@ -660,15 +665,15 @@ void FProcessor::Write(FWadWriter &out) {
             } else {
                 out.CreateLabel("SEGS");
                 if (compressGL) {
-                    if (ForceCompression)
+                    if (Opts.ForceCompression)
                         WriteGLBSPZ(out, "SSECTORS");
                     else
                         WriteGLBSPX(out, "SSECTORS");
                 } else {
                     out.CreateLabel("SSECTORS");
                 }
-                if (!GLOnly) {
-                    if (ForceCompression)
+                if (!Opts.GLOnly) {
+                    if (Opts.ForceCompression)
                         WriteBSPZ(out, "NODES");
                     else
                         WriteBSPX(out, "NODES");
@@ -1011,7 +1016,7 @@ void FProcessor::WriteNodes5(FWadWriter &out, const char *name,
 }
 
 void FProcessor::WriteBlockmap(FWadWriter &out) {
-    if (BlockmapMode == EBM_Create0) {
+    if (Opts.BlockmapMode == EBM_Create0) {
         out.CreateLabel("BLOCKMAP");
         return;
     }
@@ -1051,7 +1056,7 @@ void FProcessor::WriteBlockmap(FWadWriter &out) {
 }
 
 void FProcessor::WriteReject(FWadWriter &out) {
-    if (RejectMode == ERM_Create0 || Level.Reject == NULL) {
+    if (Opts.RejectMode == ERM_Create0 || Level.Reject == NULL) {
         out.CreateLabel("REJECT");
     } else {
         out.WriteLump("REJECT", Level.Reject, Level.RejectSize);
@@ -1168,7 +1173,7 @@ void FProcessor::WriteGLNodes(FWadWriter &out, bool v5) {
 void FProcessor::WriteBSPZ(FWadWriter &out, const char *label) {
     ZLibOut zout(out);
 
-    if (!CompressNodes) {
+    if (!Opts.CompressNodes) {
         printf("   Nodes are so big that compression has been forced.\n");
     }
 
@@ -1186,7 +1191,7 @@ void FProcessor::WriteGLBSPZ(FWadWriter &out, const char *label) {
     bool fracsplitters = CheckForFracSplitters(Level.GLNodes, Level.NumGLNodes);
     int nodever;
 
-    if (!CompressGLNodes) {
+    if (!Opts.CompressGLNodes) {
         printf("   GL Nodes are so big that compression has been forced.\n");
     }
 
@@ -1274,7 +1279,7 @@ void FProcessor::WriteNodesZ(ZLibOut &out, const MapNodeEx *nodes, int numnodes,
 }
 
 void FProcessor::WriteBSPX(FWadWriter &out, const char *label) {
-    if (!CompressNodes) {
+    if (!Opts.CompressNodes) {
         printf("   Nodes are so big that extended format has been forced.\n");
     }
 
@@ -1291,7 +1296,7 @@ void FProcessor::WriteGLBSPX(FWadWriter &out, const char *label) {
     bool fracsplitters = CheckForFracSplitters(Level.GLNodes, Level.NumGLNodes);
     int nodever;
 
-    if (!CompressGLNodes) {
+    if (!Opts.CompressGLNodes) {
         printf(
             "   GL Nodes are so big that extended format has been forced.\n");
     }
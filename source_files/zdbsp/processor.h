@@ -15,6 +15,10 @@
 #include "zdwad.h"
 #include "miniz.h"
 
+namespace Doom {
+struct udmf_level_t;
+}
+
 class ZLibOut {
    public:
     ZLibOut(FWadWriter &out);
@@ -38,7 +42,10 @@ class ZLibOut {
 
 class FProcessor {
    public:
-    FProcessor(FWadReader &inwad, int lump);
+    // 'udmf' holds the objects of a UDMF map built by Obsidian, which
+    // are used instead of parsing its TEXTMAP lump.  May be NULL.
+    FProcessor(FWadReader &inwad, int lump, const FBuildOptions &opts,
+               const Doom::udmf_level_t *udmf = NULL);
 
     void Write(FWadWriter &out);
 
@@ -118,6 +125,7 @@ class FProcessor {
     void ParseVertex(WideVertex *vt, IntVertex *vtp);
     void ParseMapProperties();
     void ParseTextMap(int lump);
+    void LoadTextMap(const Doom::udmf_level_t &udmf);
 
     void WriteProps(FWadWriter &out, TArray<UDMFKey> &props);
     void WriteIntProp(FWadWriter &out, const char *key, int value);
@@ -139,6 +147,10 @@ class FProcessor {
 
     FWadReader &Wad;
     int Lump;
+    const Doom::udmf_level_t *UDMFSource;
+    char MapName[9];
+
+    FBuildOptions Opts;
 };
 
 #ifdef WIN32
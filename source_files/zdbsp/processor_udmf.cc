@@ -20,6 +20,12 @@
 
 #include <float.h>
 
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "fmt/format.h"
+#include "g_doom.h"
 #include "processor.h"
 #include "sc_man.h"
 
@@ -327,13 +333,208 @@ void FProcessor::ParseTextMap(int lump) {
     delete[] buffer;
 }
 
+//===========================================================================
+//
+// Takes the fields of a UDMF map built by Obsidian.  Does the same as the
+// Parse functions above, minus the tokenizing: the values still have to
+// be stored as text, since that is how the TEXTMAP gets written out.
+//
+//===========================================================================
+
+class FUDMFLoader : public Doom::udmf_fields_c {
+   public:
+    FUDMFLoader(FLevel &level, bool &extended, TArray<WideVertex> &vertices)
+        : Level(level),
+          Extended(extended),
+          Vertices(vertices),
+          Kind(GLOBAL),
+          props(&level.props) {}
+
+    void Block(const char *kind) {
+        if (!strcmp(kind, "thing")) {
+            Kind = THING;
+            th = &Level.Things[Level.Things.Reserve(1)];
+            props = &th->props;
+        } else if (!strcmp(kind, "linedef")) {
+            Kind = LINEDEF;
+            ld = &Level.Lines[Level.Lines.Reserve(1)];
+            ld->v1 = ld->v2 = ld->sidenum[0] = ld->sidenum[1] = NO_INDEX;
+            ld->special = 0;
+            props = &ld->props;
+        } else if (!strcmp(kind, "sidedef")) {
+            Kind = SIDEDEF;
+            sd = &Level.Sides[Level.Sides.Reserve(1)];
+            sd->sector = NO_INDEX;
+            props = &sd->props;
+        } else if (!strcmp(kind, "sector")) {
+            Kind = SECTOR;
+            IntSector *sec = &Level.Sectors[Level.Sectors.Reserve(1)];
+            props = &sec->props;
+        } else if (!strcmp(kind, "vertex")) {
+            Kind = VERTEX;
+            vt = &Vertices[Vertices.Reserve(1)];
+            vt->index = Vertices.Size();
+            vt->x = vt->y = 0;
+            props = &Level.VertexProps[Level.VertexProps.Reserve(1)].props;
+        } else {
+            throw std::runtime_error("Unknown UDMF block type.");
+        }
+    }
+
+    void EndBlock() {}
+
+    void IntField(const char *key, int value) {
+        Field(key, fmt::format_int(value).c_str(), value);
+    }
+
+    void FloatField(const char *key, double value) {
+        // unlike sprintf, this does not depend on the locale
+        char buffer[64];
+        *fmt::format_to_n(buffer, sizeof(buffer) - 1, "{:f}", value).out = 0;
+        Field(key, buffer, value);
+    }
+
+    void BoolField(const char *key, bool value) {
+        Field(key, value ? "true" : "false", NAN);
+    }
+
+    void StringField(const char *key, const std::string &value) {
+        if (Kind == GLOBAL && !strcasecmp(key, "namespace")) {
+            // all unknown namespaces are assumed to be standard.
+            Extended = !strcasecmp(value.c_str(), "ZDoom") ||
+                       !strcasecmp(value.c_str(), "Hexen") ||
+                       !strcasecmp(value.c_str(), "Vavoom");
+        }
+
+        // the parser keeps the quotes too
+        std::string quoted = "\"" + value + "\"";
+
+        Field(key, quoted.c_str(), NAN);
+    }
+
+   private:
+    enum { GLOBAL, THING, LINEDEF, SIDEDEF, SECTOR, VERTEX };
+
+    // 'number' is NAN when the value is not a number
+    void Field(const char *key, const char *value, double number) {
+        switch (Kind) {
+            case THING:
+                if (!strcasecmp(key, "x")) {
+                    th->x = CheckFixed(key, number);
+                } else if (!strcasecmp(key, "y")) {
+                    th->y = CheckFixed(key, number);
+                } else if (!strcasecmp(key, "angle")) {
+                    th->angle = (short)CheckInt(key, number);
+                } else if (!strcasecmp(key, "type")) {
+                    th->type = (short)CheckInt(key, number);
+                }
+                break;
+
+            case LINEDEF:
+                // vertices and sides are not stored in props
+                if (!strcasecmp(key, "v1")) {
+                    ld->v1 = CheckInt(key, number);
+                    return;
+                } else if (!strcasecmp(key, "v2")) {
+                    ld->v2 = CheckInt(key, number);
+                    return;
+                } else if (!strcasecmp(key, "sidefront")) {
+                    ld->sidenum[0] = CheckInt(key, number);
+                    return;
+                } else if (!strcasecmp(key, "sideback")) {
+                    ld->sidenum[1] = CheckInt(key, number);
+                    return;
+                } else if (Extended && !strcasecmp(key, "special")) {
+                    ld->special = CheckInt(key, number);
+                } else if (Extended && !strcasecmp(key, "arg0")) {
+                    ld->args[0] = CheckInt(key, number);
+                }
+                break;
+
+            case SIDEDEF:
+                if (!strcasecmp(key, "sector")) {
+                    sd->sector = CheckInt(key, number);
+                    return;  // do not store in props
+                }
+                break;
+
+            case VERTEX:
+                if (!strcasecmp(key, "x")) {
+                    vt->x = CheckFixed(key, number);
+                } else if (!strcasecmp(key, "y")) {
+                    vt->y = CheckFixed(key, number);
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        // keys are string literals, only the value needs a copy
+        UDMFKey k = {key, stbuf.Copy(value)};
+        props->Push(k);
+    }
+
+    static int CheckInt(const char *key, double number) {
+        if (std::isnan(number)) {
+            throw std::runtime_error(
+                std::string("Integer value expected for key '") + key + "'");
+        }
+        return (int)number;
+    }
+
+    static fixed_t CheckFixed(const char *key, double number) {
+        if (std::isnan(number)) {
+            throw std::runtime_error(
+                std::string("Floating point value expected for key '") + key +
+                "'");
+        }
+        if (number < -32768 || number > 32767) {
+            throw std::runtime_error(
+                std::string("Fixed point value is out of range for key '") +
+                key + "'");
+        }
+        return xs_Fix<16>::ToFix(number);
+    }
+
+    FLevel &Level;
+    bool &Extended;
+    TArray<WideVertex> &Vertices;
+
+    int Kind;
+    TArray<UDMFKey> *props;  // where the current block's keys go
+
+    IntThing *th;
+    IntLineDef *ld;
+    IntSideDef *sd;
+    WideVertex *vt;
+};
+
+void FProcessor::LoadTextMap(const Doom::udmf_level_t &udmf) {
+    TArray<WideVertex> Vertices;
+
+    FUDMFLoader loader(Level, Extended, Vertices);
+
+    Doom::UDMF_Visit(udmf, loader);
+
+    Level.Vertices = new WideVertex[Vertices.Size()];
+    Level.NumVertices = Vertices.Size();
+    memcpy(Level.Vertices, &Vertices[0], Vertices.Size() * sizeof(WideVertex));
+}
+
 //===========================================================================
 //
 // parse an UDMF map
 //
 //===========================================================================
 
-void FProcessor::LoadUDMF() { ParseTextMap(Lump + 1); }
+void FProcessor::LoadUDMF() {
+    if (UDMFSource != NULL) {
+        LoadTextMap(*UDMFSource);
+    } else {
+        ParseTextMap(Lump + 1);
+    }
+}
 
 //===========================================================================
 //
@@ -373,7 +574,7 @@ void FProcessor::WriteIntProp(FWadWriter &out, const char *key, int value) {
 
 void FProcessor::WriteThingUDMF(FWadWriter &out, IntThing *th, int num) {
     out.AddToLump("thing", 5);
-    if (WriteComments) {
+    if (Opts.WriteComments) {
         char buffer[32];
         int len = sprintf(buffer, " // %d", num);
         out.AddToLump(buffer, len);
@@ -391,7 +592,7 @@ void FProcessor::WriteThingUDMF(FWadWriter &out, IntThing *th, int num) {
 
 void FProcessor::WriteLinedefUDMF(FWadWriter &out, IntLineDef *ld, int num) {
     out.AddToLump("linedef", 7);
-    if (WriteComments) {
+    if (Opts.WriteComments) {
         char buffer[32];
         int len = sprintf(buffer, " // %d", num);
         out.AddToLump(buffer, len);
@@ -415,7 +616,7 @@ void FProcessor::WriteLinedefUDMF(FWadWriter &out, IntLineDef *ld, int num) {
 
 void FProcessor::WriteSidedefUDMF(FWadWriter &out, IntSideDef *sd, int num) {
     out.AddToLump("sidedef", 7);
-    if (WriteComments) {
+    if (Opts.WriteComments) {
         char buffer[32];
         int len = sprintf(buffer, " // %d", num);
         out.AddToLump(buffer, len);
@@ -434,7 +635,7 @@ void FProcessor::WriteSidedefUDMF(FWadWriter &out, IntSideDef *sd, int num) {
 
 void FProcessor::WriteSectorUDMF(FWadWriter &out, IntSector *sec, int num) {
     out.AddToLump("sector", 6);
-    if (WriteComments) {
+    if (Opts.WriteComments) {
         char buffer[32];
         int len = sprintf(buffer, " // %d", num);
         out.AddToLump(buffer, len);
@@ -452,7 +653,7 @@ void FProcessor::WriteSectorUDMF(FWadWriter &out, IntSector *sec, int num) {
 
 void FProcessor::WriteVertexUDMF(FWadWriter &out, IntVertex *vt, int num) {
     out.AddToLump("vertex", 6);
-    if (WriteComments) {
+    if (Opts.WriteComments) {
         char buffer[32];
         int len = sprintf(buffer, " // %d", num);
         out.AddToLump(buffer, len);
@@ -506,7 +707,7 @@ void FProcessor::WriteTextMap(FWadWriter &out) {
 void FProcessor::WriteUDMF(FWadWriter &out) {
     out.CopyLump(Wad, Lump);
     WriteTextMap(out);
-    if (ForceCompression)
+    if (Opts.ForceCompression)
         WriteGLBSPZ(out, "ZNODES");
     else
         WriteGLBSPX(out, "ZNODES");
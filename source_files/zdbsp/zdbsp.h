@@ -29,18 +29,29 @@ enum ERejectMode {
     ERM_Rebuild_NoGL
 };
 
+// Settings for a node building run. Every FProcessor keeps its own copy,
+// so that several maps can be built at the same time.
+struct FBuildOptions {
+    bool BuildNodes = true;
+    bool BuildGLNodes = false;
+    bool ConformNodes = false;
+    bool GLOnly = false;
+    bool WriteComments = false;
+    bool NoPrune = false;
+    EBlockmapMode BlockmapMode = EBM_Rebuild;
+    ERejectMode RejectMode = ERM_DontTouch;
+    int MaxSegs = 64;
+    int SplitCost = 8;
+    int AAPreference = 16;
+    bool CheckPolyobjs = true;
+    bool CompressNodes = true;
+    bool CompressGLNodes = true;
+    bool ForceCompression = false;
+    bool V5GLNodes = false;
+};
+
 extern const char *Map;
-extern std::filesystem::path OutName;
-extern bool BuildNodes, BuildGLNodes, ConformNodes, GLOnly, WriteComments;
-extern bool NoPrune;
-extern EBlockmapMode BlockmapMode;
-extern ERejectMode RejectMode;
-extern int MaxSegs;
-extern int SplitCost;
-extern int AAPreference;
-extern bool CheckPolyobjs;
 extern bool ShowMap;
-extern bool CompressNodes, CompressGLNodes, ForceCompression, V5GLNodes;
 
 #define FIXED_MAX INT_MAX
 #define FIXED_MIN INT_MIN
@@ -57,12 +57,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <atomic>
+#include <exception>
 #include <filesystem>
+#include <memory>
+#include <vector>
 
 #include "processor.h"
 #include "zdwad.h"
 #include "zdbsp.h"
 
+#include "lib_thread.h"
 #include "lib_util.h"
 #include "g_doom.h"
 
@@ -74,6 +79,13 @@
 
 // TYPES -------------------------------------------------------------------
 
+struct FMapJob {
+    int Lump;
+    FProcessor *Builder;
+    std::string Output;  // a WAD holding just this map's lumps
+    std::exception_ptr Error;
+};
+
 // EXTERNAL FUNCTION PROTOTYPES --------------------------------------------
 
 // PUBLIC FUNCTION PROTOTYPES ----------------------------------------------
@@ -85,80 +97,75 @@ static void ShowVersion();
 // PUBLIC DATA DEFINITIONS -------------------------------------------------
 
 const char *Map = NULL;
-std::filesystem::path OutName = "tmp.wad";
-bool BuildNodes = true;
-bool BuildGLNodes = false;
-bool ConformNodes = false;
-bool NoPrune = false;
-EBlockmapMode BlockmapMode = EBM_Rebuild;
-ERejectMode RejectMode = ERM_DontTouch;
-bool WriteComments = false;
-int MaxSegs = 64;
-int SplitCost = 8;
-int AAPreference = 16;
-bool CheckPolyobjs = true;
 bool ShowMap = false;
 bool ShowWarnings = true;
 bool NoTiming = false;
-bool CompressNodes = true;
-bool CompressGLNodes = true;
-bool ForceCompression = false;
-bool GLOnly = false;
-bool V5GLNodes = false;
 
 // CODE --------------------------------------------------------------------
 
-int zdmain(std::filesystem::path filename, std::string current_port, bool UDMF_mode, bool build_reject, int num_maps) {
+//==========================================================================
+//
+// IsMapToBuild
+//
+//==========================================================================
+
+static bool IsMapToBuild(FWadReader &inwad, int lump) {
+    return inwad.IsMap(lump) &&
+           (!Map || strcasecmp(inwad.LumpName(lump), Map) == 0);
+}
+
+int zdmain(const void *wad_data, size_t wad_length, std::filesystem::path out_filename, std::string *out_buffer, std::string current_port, bool UDMF_mode, bool build_reject, int num_maps) {
+
+    Doom::Send_Prog_Nodes(0, num_maps);
 
-    int node_progress = 0;
-    Doom::Send_Prog_Nodes(node_progress, num_maps);
+    FBuildOptions opts;
 
     if (StringCaseCmp(current_port, "limit_enforcing") == 0 || StringCaseCmp(current_port, "limit_removing") == 0 ||
             StringCaseCmp(current_port, "boom") == 0) {
-            BuildGLNodes = false;
-            GLOnly = false;
+            opts.BuildGLNodes = false;
+            opts.GLOnly = false;
             if (build_reject) {
-                RejectMode = ERM_Rebuild_NoGL;
+                opts.RejectMode = ERM_Rebuild_NoGL;
             } else {
-                RejectMode = ERM_CreateZeroes;
+                opts.RejectMode = ERM_CreateZeroes;
             }
-            CheckPolyobjs = false;
-            CompressNodes = false;
-            CompressGLNodes = false;
-            ForceCompression = false;
+            opts.CheckPolyobjs = false;
+            opts.CompressNodes = false;
+            opts.CompressGLNodes = false;
+            opts.ForceCompression = false;
         } else if (StringCaseCmp(current_port, "prboom") == 0) {
-            BuildGLNodes = false;
-            GLOnly = false;
+            opts.BuildGLNodes = false;
+            opts.GLOnly = false;
             if (build_reject) {
-                RejectMode = ERM_Rebuild_NoGL;
+                opts.RejectMode = ERM_Rebuild_NoGL;
             } else {
-                RejectMode = ERM_CreateZeroes;
+                opts.RejectMode = ERM_CreateZeroes;
             }
-            CheckPolyobjs = false;
-            CompressNodes = true;
-            CompressGLNodes = false;
-            ForceCompression = false;
+            opts.CheckPolyobjs = false;
+            opts.CompressNodes = true;
+            opts.CompressGLNodes = false;
+            opts.ForceCompression = false;
         } else if (StringCaseCmp(current_port, "eternity") == 0) {
             if (UDMF_mode) {
-                BuildGLNodes = true;
-                GLOnly = true;
+                opts.BuildGLNodes = true;
+                opts.GLOnly = true;
             } else {
-                BuildGLNodes = false;
-                GLOnly = false;
+                opts.BuildGLNodes = false;
+                opts.GLOnly = false;
             }
-            RejectMode = ERM_DontTouch;
-            CheckPolyobjs = true;
-            CompressNodes = true;
-            CompressGLNodes = false;
-            ForceCompression = false;
+            opts.RejectMode = ERM_DontTouch;
+            opts.CheckPolyobjs = true;
+            opts.CompressNodes = true;
+            opts.CompressGLNodes = false;
+            opts.ForceCompression = false;
         } else { // ZDoom is the only choice left, so customize for it
-            BuildGLNodes = true;
-            GLOnly = true;
-            RejectMode = ERM_DontTouch;
-            CheckPolyobjs = true;
-            CompressNodes = true;
-            CompressGLNodes = true;
-            ForceCompression = true;
+            opts.BuildGLNodes = true;
+            opts.GLOnly = true;
+            opts.RejectMode = ERM_DontTouch;
+            opts.CheckPolyobjs = true;
+            opts.CompressNodes = true;
+            opts.CompressGLNodes = true;
+            opts.ForceCompression = true;
         }
 
     ShowVersion();
@@ -166,27 +173,105 @@ int zdmain(std::filesystem::path filename, std::string current_port, bool UDMF_m
     try {
         START_COUNTER(t1a, t1b, t1c)
 
-        if (std::filesystem::exists(OutName)) { std::filesystem::remove(OutName); }
-        FWadReader inwad(filename);
-        FWadWriter outwad(OutName, inwad.IsIWAD());
+        // the input WAD is never written to disk, and the output is
+        // written once, either to the final file or into memory.
+        FWadReader inwad((const BYTE *)wad_data, wad_length);
+        std::unique_ptr<FWadWriter> outwad_ptr;
+
+        if (out_buffer != NULL) {
+            outwad_ptr.reset(new FWadWriter(out_buffer, inwad.IsIWAD()));
+        } else {
+            outwad_ptr.reset(new FWadWriter(out_filename, inwad.IsIWAD()));
+        }
+
+        FWadWriter &outwad = *outwad_ptr;
 
-        int lump = 0;
         int max = inwad.NumLumps();
 
-        while (lump < max) {
-            if (inwad.IsMap(lump) &&
-                (!Map || strcasecmp(inwad.LumpName(lump), Map) == 0)) {
+        // first pass: load every map.  this is done here since the UDMF
+        // parser is not thread-safe, but it is cheap compared to the node
+        // building which follows.  UDMF maps built by Obsidian are not
+        // parsed at all, their objects are taken directly.
+        std::vector<FMapJob> jobs;
+
+        for (int lump = 0; lump < max;) {
+            if (IsMapToBuild(inwad, lump)) {
                 Doom::Send_Prog_Step(inwad.LumpName(lump));
-                START_COUNTER(t2a, t2b, t2c)
-                FProcessor builder(inwad, lump);
-                builder.Write(outwad);
-                END_COUNTER(t2a, t2b, t2c, "   %.3f seconds.\n")
-                node_progress += 1;
-                Doom::Send_Prog_Nodes(node_progress, num_maps);
+
+                FMapJob job;
+                job.Lump = lump;
+                job.Builder = new FProcessor(
+                    inwad, lump, opts,
+                    UDMF_mode ? Doom::UDMF_FindLevel(inwad.LumpName(lump))
+                              : NULL);
+                jobs.push_back(job);
+
+                lump = inwad.LumpAfterMap(lump);
+            } else {
+                ++lump;
+            }
+        }
+
+        // second pass: build the nodes for every map in parallel.  each
+        // map is written into its own in-memory WAD.
+        std::atomic<int> node_progress(0);
+
+        Thread_ParallelFor(
+            (int)jobs.size(),
+            [&](int index, int worker) {
+                FMapJob &job = jobs[index];
+
+                try {
+                    START_COUNTER(t2a, t2b, t2c)
+                    FWadWriter mapwad(&job.Output, inwad.IsIWAD());
+                    job.Builder->Write(mapwad);
+                    mapwad.Close();
+                    END_COUNTER(t2a, t2b, t2c, "   %.3f seconds.\n")
+                } catch (...) {
+                    job.Error = std::current_exception();
+                }
+
+                delete job.Builder;
+                job.Builder = NULL;
+
+                node_progress++;
+            },
+            [&]() {
+                Doom::Send_Prog_Nodes(node_progress.load(), num_maps);
+                return true;
+            });
+
+        Doom::Send_Prog_Nodes(node_progress.load(), num_maps);
+
+        for (FMapJob &job : jobs) {
+            if (job.Error) {
+                std::rethrow_exception(job.Error);
+            }
+        }
+
+        // final pass: write everything out in the original order.
+        unsigned int next_job = 0;
+
+        for (int lump = 0; lump < max;) {
+            if (IsMapToBuild(inwad, lump)) {
+                FMapJob &job = jobs[next_job++];
+
+                FWadReader mapwad((const BYTE *)job.Output.data(),
+                                  job.Output.size());
+
+                for (int i = 0; i < mapwad.NumLumps(); ++i) {
+                    outwad.CopyLump(mapwad, i);
+                }
+
+                mapwad.Close();
+
+                job.Output.clear();
+                job.Output.shrink_to_fit();
+
                 lump = inwad.LumpAfterMap(lump);
             } else if (inwad.IsGLNodes(lump)) {
                 // Ignore GL nodes from the input for any maps we process.
-                if (BuildNodes &&
+                if (opts.BuildNodes &&
                     (Map == NULL ||
                      strcasecmp(inwad.LumpName(lump) + 3, Map) == 0)) {
                     lump = inwad.SkipGLNodes(lump);
@@ -203,8 +288,6 @@ int zdmain(std::filesystem::path filename, std::string current_port, bool UDMF_m
 
         outwad.Close();
         inwad.Close();
-		std::filesystem::remove(filename);			
-        std::filesystem::rename(OutName, filename);
 
         END_COUNTER(t1a, t1b, t1c, "\nTotal time: %.3f seconds.\n");
 
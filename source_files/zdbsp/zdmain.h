@@ -1,2 +1,4 @@
 
-int zdmain(std::filesystem::path filename, std::string current_port, bool UDMF_mode, bool build_reject, int num_maps);
+// builds the nodes for every map in the WAD image 'wad_data'.  the result
+// is written to 'out_filename', or into 'out_buffer' when that is non-NULL.
+int zdmain(const void *wad_data, size_t wad_length, std::filesystem::path out_filename, std::string *out_buffer, std::string current_port, bool UDMF_mode, bool build_reject, int num_maps);
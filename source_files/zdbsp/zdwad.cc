@@ -41,7 +41,8 @@ static const bool MapLumpRequired[12] = {
 static const char GLLumpNames[5][9] = {"GL_VERT", "GL_SEGS", "GL_SSECT",
                                        "GL_NODES", "GL_PVS"};
 
-FWadReader::FWadReader(std::filesystem::path filename) : Lumps(NULL) {
+FWadReader::FWadReader(std::filesystem::path filename)
+    : Lumps(NULL), MemData(NULL), MemLength(0) {
     File.open(filename, std::ios::binary);
     
     if (!File.is_open()) {
@@ -53,26 +54,53 @@ FWadReader::FWadReader(std::filesystem::path filename) : Lumps(NULL) {
         throw std::runtime_error("Error reading WAD header");
     }
 
+    ReadDirectory();
+}
+
+FWadReader::FWadReader(const BYTE *data, size_t length)
+    : Lumps(NULL), MemData(data), MemLength(length) {
+    if (length < sizeof(Header)) {
+        throw std::runtime_error("Error reading WAD header");
+    }
+
+    memcpy(&Header, data, sizeof(Header));
+
+    ReadDirectory();
+}
+
+void FWadReader::ReadDirectory() {
     if (Header.Magic[0] != 'P' && Header.Magic[0] != 'I' &&
         Header.Magic[1] != 'W' && Header.Magic[2] != 'A' &&
         Header.Magic[3] != 'D') {
-        File.close();
+        if (File.is_open()) File.close();
         throw std::runtime_error("Input file is not a wad");
     }
 
     Header.NumLumps = LittleLong(Header.NumLumps);
     Header.Directory = LittleLong(Header.Directory);
 
-    File.seekg(Header.Directory);
-    if (File.tellg() != Header.Directory) {
-        throw std::runtime_error("Could not read wad directory");
-    }
+    if (MemData != NULL) {
+        if ((size_t)Header.Directory + Header.NumLumps * sizeof(*Lumps) >
+            MemLength) {
+            throw std::runtime_error("Could not read wad directory");
+        }
+
+        Lumps = new WadLump[Header.NumLumps];
+
+        memcpy(Lumps, MemData + Header.Directory,
+               Header.NumLumps * sizeof(*Lumps));
+    } else {
+        File.seekg(Header.Directory);
+        if (File.tellg() != Header.Directory) {
+            throw std::runtime_error("Could not read wad directory");
+        }
 
-    Lumps = new WadLump[Header.NumLumps];
+        Lumps = new WadLump[Header.NumLumps];
 
-    File.read(reinterpret_cast<char *>(Lumps), Header.NumLumps * sizeof(*Lumps));
-    if (File.gcount() != Header.NumLumps * sizeof(*Lumps)) {
-        throw std::runtime_error("Problem reading lumps");
+        File.read(reinterpret_cast<char *>(Lumps), Header.NumLumps * sizeof(*Lumps));
+        if (File.gcount() != Header.NumLumps * sizeof(*Lumps)) {
+            throw std::runtime_error("Problem reading lumps");
+        }
     }
 
     for (int i = 0; i < Header.NumLumps; ++i) {
@@ -262,19 +290,30 @@ int FWadReader::LumpAfterMap(int i) const {
 }
 
 const char *FWadReader::LumpName(int lump) {
-    static char name[9];
+    // per-thread, since maps may be built in parallel
+    thread_local char name[9];
     strncpy(name, Lumps[lump].Name, 8);
     name[8] = 0;
     return name;
 }
 
-FWadWriter::FWadWriter(std::filesystem::path filename, bool iwad) {
+FWadWriter::FWadWriter(std::filesystem::path filename, bool iwad)
+    : Out(&File), MemOut(NULL) {
 
     File.open(filename, std::ios::binary);
     if (!File.is_open()) {
         throw std::runtime_error("Could not open output file");
     }
 
+    WriteHeader(iwad);
+}
+
+FWadWriter::FWadWriter(std::string *membuf, bool iwad)
+    : Out(&Mem), MemOut(membuf) {
+    WriteHeader(iwad);
+}
+
+void FWadWriter::WriteHeader(bool iwad) {
     WadHeader head;
 
     if (iwad) {
@@ -286,34 +325,40 @@ FWadWriter::FWadWriter(std::filesystem::path filename, bool iwad) {
     head.Magic[2] = 'A';
     head.Magic[3] = 'D';
 
-    File.write(reinterpret_cast<char *>(&head), sizeof(head));
-    File << std::flush;
-
+    Out->write(reinterpret_cast<char *>(&head), sizeof(head));
 }
 
 FWadWriter::~FWadWriter() { }
 
 void FWadWriter::Close() {
-    if (File.is_open()) {
-        int32_t head[2];
+    if (Out == NULL) {
+        return;
+    }
+
+    int32_t head[2];
 
-        head[0] = LittleLong(Lumps.Size());
-        head[1] = LittleLong(File.tellp());
+    head[0] = LittleLong(Lumps.Size());
+    head[1] = LittleLong(Out->tellp());
 
-        File.write(reinterpret_cast<char *>(&Lumps[0]), sizeof(WadLump) * Lumps.Size());
-        File << std::flush;
-        File.seekp(4);
-        File.write(reinterpret_cast<char *>(head), 8);
-        File << std::flush;
+    Out->write(reinterpret_cast<char *>(&Lumps[0]), sizeof(WadLump) * Lumps.Size());
+    Out->seekp(4);
+    Out->write(reinterpret_cast<char *>(head), 8);
+
+    if (MemOut != NULL) {
+        *MemOut = Mem.str();
+        Mem.str("");
+    } else {
         File.close();
     }
+
+    Out = NULL;
 }
 
 void FWadWriter::CreateLabel(const char *name) {
     WadLump lump;
 
     strncpy(lump.Name, name, 8);
-    lump.FilePos = LittleLong(File.tellp());
+    lump.FilePos = LittleLong(Out->tellp());
     lump.Size = 0;
     Lumps.Push(lump);
 }
@@ -322,12 +367,11 @@ void FWadWriter::WriteLump(const char *name, const void *data, int len) {
     WadLump lump;
 
     strncpy(lump.Name, name, 8);
-    lump.FilePos = LittleLong(File.tellp());
+    lump.FilePos = LittleLong(Out->tellp());
     lump.Size = LittleLong(len);
     Lumps.Push(lump);
 
-    File.write(reinterpret_cast<const char *>(data), len);
-    File << std::flush;
+    Out->write(reinterpret_cast<const char *>(data), len);
 }
 
 void FWadWriter::CopyLump(FWadReader &wad, int lump) {
@@ -344,8 +388,7 @@ void FWadWriter::CopyLump(FWadReader &wad, int lump) {
 void FWadWriter::StartWritingLump(const char *name) { CreateLabel(name); }
 
 void FWadWriter::AddToLump(const void *data, int len) {
-    File.write(reinterpret_cast<const char *>(data), len);
-    File << std::flush;
+    Out->write(reinterpret_cast<const char *>(data), len);
     Lumps[Lumps.Size() - 1].Size += len;
 }
 
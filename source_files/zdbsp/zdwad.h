@@ -9,6 +9,8 @@
 #include <string.h>
 #include <filesystem>
 #include <fstream>
+#include <sstream>
+#include <string>
 
 #include "tarray.h"
 #include "zdbsp.h"
@@ -29,6 +31,9 @@ struct WadLump {
 class FWadReader {
    public:
     FWadReader(std::filesystem::path filename);
+    // read from a complete WAD image in memory, which must stay valid
+    // for the lifetime of the reader
+    FWadReader(const BYTE *data, size_t length);
     ~FWadReader();
 
     bool IsIWAD() const;
@@ -52,9 +57,13 @@ class FWadReader {
     friend void ReadLump(FWadReader &wad, int index, T *&data, int &size);
 
    private:
+    void ReadDirectory();
+
     WadHeader Header;
     WadLump *Lumps;
     std::ifstream File;
+    const BYTE *MemData;
+    size_t MemLength;
 };
 
 template <class T>
@@ -64,6 +73,16 @@ void ReadLump(FWadReader &wad, int index, T *&data, int &size) {
         size = 0;
         return;
     }
+    if (wad.MemData != NULL) {
+        size_t pos = (size_t)wad.Lumps[index].FilePos;
+        if (pos + wad.Lumps[index].Size > wad.MemLength) {
+            throw std::runtime_error("Lump is past end of wad");
+        }
+        size = wad.Lumps[index].Size / sizeof(T);
+        data = new T[size];
+        memcpy(data, wad.MemData + pos, size * sizeof(T));
+        return;
+    }
     wad.File.seekg(wad.Lumps[index].FilePos);
     if (wad.File.tellg() != wad.Lumps[index].FilePos) {
         throw std::runtime_error("Failed to seek");        
@@ -85,6 +104,9 @@ void ReadMapLump(FWadReader &wad, const char *name, int index, T *&data,
 class FWadWriter {
    public:
     FWadWriter(std::filesystem::path filename, bool iwad);
+    // write into memory, the finished WAD is stored in 'membuf'
+    // when Close() is called
+    FWadWriter(std::string *membuf, bool iwad);
     ~FWadWriter();
 
     void CreateLabel(const char *name);
@@ -103,8 +125,13 @@ class FWadWriter {
     FWadWriter &operator<<(fixed_t);
 
    private:
+    void WriteHeader(bool iwad);
+
     TArray<WadLump> Lumps;
     std::ofstream File;
+    std::ostringstream Mem;
+    std::ostream *Out;
+    std::string *MemOut;
 };
 
 #ifdef _MSC_VER